@@ -1,46 +1,1183 @@
 /*
  * Brute-Force Attack on DES
- * This program attempts to brute-force the DES encryption key by trying all
- * possible 56-bit keys to find one that correctly decrypts a known ciphertext.
+ * This program searches the 56-bit DES key space for the key that encrypts a
+ * known CBC message (known IV) to its ciphertext; each block gives one known
+ * plaintext/ciphertext pair. The key space is cut into chunks that worker threads pull from
+ * their own range and steal from each other once it runs dry. Progress (keys
+ * per second and time left) is printed every second, the untried ranges are
+ * written to a checkpoint file so an interrupted search can be resumed, and
+ * every thread stops as soon as one of them finds the key.
+ *
+ * Usage: brute_force [--key HEX] [--bits N] [--prefix HEX] [--threads N]
+ *                    [--pairs N] [--complement] [--checkpoint FILE]
+ *                    [--interval SEC] [--resume] [--bench]
+ *        brute_force --coordinator ADDR [--lease CHUNKS] [--lease-timeout SEC] [...]
+ *        brute_force --worker ADDR [--threads N]
+ *
+ * --bits limits the search to the low N bits of the 56-bit key index, with the
+ * upper bits fixed by --prefix (by default taken from the demo key, i.e. the
+ * attacker is assumed to know them). --bits 56 is the full key space.
+ *
+ * The scalar path walks each chunk in Gray-code order (des_key_enum_*), so consecutive
+ * keys differ in one bit and round keys are patched instead of rebuilt; the bitsliced
+ * kernels expand their own key slices and take keys straight from the index. Each
+ * trial runs 14 rounds and rejects the key S-box by S-box in round 15 (des_key_test_*;
+ * the AVX2 and AVX-512 kernels run all 16 rounds, which is faster there); survivors
+ * are checked against all --pairs known blocks.
+ * --complement adds a chosen plaintext, the complement of the first block, so
+ * every trial also tests the complemented key and the full search covers only
+ * half the key space. --bench compares trial rates of the different paths.
+ *
+ * With --coordinator the search is spread over worker processes (see Distributed
+ * Mode below); ADDR is host:port for TCP or unix:/path for a Unix socket. POSIX only.
  */
 
- #include "des.h"
- #include <stdio.h>
- #include <stdint.h>
- #include <string.h>
- 
- #define KNOWN_PLAINTEXT "HELLO123"
- 
- void brute_force_des(uint8_t *ciphertext, uint8_t *iv) {
-     uint8_t decrypted[8];
-     uint64_t key;
-     
-     printf("Starting brute-force attack...\n");
-     
-     for (key = 0; key < (1ULL << 56); key++) {
-         uint8_t temp_iv[8];
-         memcpy(temp_iv, iv, 8);
-         
-         memcpy(decrypted, ciphertext, 8);
-         des_cbc_decrypt(decrypted, 8, key, temp_iv);
-         
-         if (memcmp(decrypted, KNOWN_PLAINTEXT, 8) == 0) {
-             printf("Key found: %016llX\n", key);
-             return;
-         }
-     }
-     printf("Key not found (unlikely).\n");
- }
- 
- int main() {
-     uint8_t iv[8] = {0};
-     uint64_t test_key = 0x133457799BBCDFF1;
-     uint8_t plaintext[8] = KNOWN_PLAINTEXT;
-     uint8_t ciphertext[8];
-     
-     des_cbc_encrypt(plaintext, 8, test_key, iv);
-     
-     brute_force_des(ciphertext, iv);
-     
-     return 0;
- }
\ No newline at end of file
+#include "des.h"
+#include "des_tool.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define KNOWN_PLAINTEXT "HELLO123"
+#define KNOWN_MESSAGE KNOWN_PLAINTEXT "GOODBYE!KNOWNTXTBLOCK#4!"  // Blocks of known plaintext
+#define MAX_PAIRS 4
+
+#define CHUNK_BITS 20          // Keys per chunk: the unit of work handed out and checkpointed
+#define BATCH_KEYS 4096        // Keys per trial batch; the stop flag is checked between batches
+#define MAX_WORKERS 256
+#define NO_CHUNK UINT64_MAX
+#define CHECKPOINT_MAGIC "DES-BRUTE-FORCE-CHECKPOINT 1"
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} ChunkRange;
+
+typedef struct {
+    uint64_t next;          // Chunks still owned by this worker: [next, end)
+    uint64_t end;
+    uint64_t current;       // Chunk being searched, or NO_CHUNK
+    atomic_uint_fast64_t current_tested;  // Keys of current already counted in tested
+    pthread_t thread;
+    int index;
+} Worker;
+
+static struct {
+    // Problem
+    DES_KeyTest test;       // Known pairs; the first block is P ^ IV, the block fed to DES
+    uint64_t prefix;        // Fixed upper bits of the key index
+    int bits;               // Free low bits of the key index
+    int chunk_bits;
+
+    // Work distribution; one lock covers every worker's range so a checkpoint
+    // snapshot never misses a range that is being stolen
+    pthread_mutex_t lock;
+    Worker workers[MAX_WORKERS];
+    int worker_count;
+    ChunkRange *pending;    // Ranges not yet claimed (checkpoint backlog, lease)
+    size_t pending_count;
+    size_t pending_capacity;
+    int use_backlog;        // The backlog is the whole job (resumed or leased), even when empty
+
+    // Progress and termination
+    atomic_uint_fast64_t tested;
+    uint64_t tested_before; // Keys tested by earlier runs (from the checkpoint)
+    atomic_int stop;
+    atomic_int finished;    // Workers that have exited
+    atomic_int found;
+    uint64_t found_key;
+} search = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int signo) {
+    (void)signo;
+    interrupted = 1;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// ================================
+//      Key Space
+// ================================
+
+static uint64_t chunk_count(void) {
+    return 1ULL << (search.bits - search.chunk_bits);
+}
+
+// ================================
+//      Work Distribution
+// ================================
+
+// Hands the calling worker its next chunk: from its own range first, then from the
+// checkpoint backlog, then by stealing the back half of the fullest other range
+static uint64_t take_chunk(Worker *self) {
+    uint64_t chunk = NO_CHUNK;
+
+    pthread_mutex_lock(&search.lock);
+    self->current = NO_CHUNK;
+    atomic_store(&self->current_tested, 0);
+    if (self->next < self->end) {
+        chunk = self->next++;
+    } else if (search.pending_count > 0) {
+        ChunkRange range = search.pending[--search.pending_count];
+        chunk = range.start;
+        self->next = range.start + 1;
+        self->end = range.end;
+    } else {
+        Worker *victim = NULL;
+        for (int i = 0; i < search.worker_count; i++) {
+            Worker *w = &search.workers[i];
+            if (w != self && w->end > w->next &&
+                (!victim || w->end - w->next > victim->end - victim->next)) {
+                victim = w;
+            }
+        }
+        if (victim) {
+            uint64_t half = (victim->end - victim->next + 1) / 2;
+            victim->end -= half;
+            chunk = victim->end;
+            self->next = chunk + 1;
+            self->end = chunk + half;
+        }
+    }
+    self->current = chunk;
+    pthread_mutex_unlock(&search.lock);
+    return chunk;
+}
+
+// Records a matching key and tells every worker to stop
+static void report_key(uint64_t key) {
+    if (!atomic_exchange(&search.found, 1)) {
+        search.found_key = key;
+    }
+    atomic_store(&search.stop, 1);
+}
+
+// Tries one batch of keys, indices first .. first + count - 1. The scalar kernel instead
+// tests the next count steps of the enumerator's walk (the same chunk in Gray-code order)
+// with the patched round keys; the bitsliced kernels expand each key themselves, so they
+// take the keys straight from the indices and patching would be wasted work.
+static void search_batch(const DES_KeyTest *test, DES_KeyEnumerator *keys_enum, uint64_t first,
+                         size_t count, int scalar) {
+    uint64_t keys[BATCH_KEYS];
+    uint64_t found[4];
+
+    if (scalar) {
+        for (size_t i = 0; i < count; i++) {
+            int result = des_key_test_schedule(test, &keys_enum->round_keys);
+            if (result & 1) report_key(keys_enum->key);
+            if (result & 2) report_key(~keys_enum->key);
+            des_key_enum_next(keys_enum);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = des_key_from_index(first + i);
+    }
+    size_t hits = des_key_test_batch(test, keys, count, found, 4);
+    for (size_t i = 0; i < hits && i < 4; i++) report_key(found[i]);
+}
+
+static void *search_worker(void *arg) {
+    Worker *self = arg;
+    uint64_t chunk_keys = 1ULL << search.chunk_bits;
+    int scalar = des_get_kernel() == DES_KERNEL_SCALAR;
+    uint64_t chunk;
+
+    while (!atomic_load(&search.stop) && (chunk = take_chunk(self)) != NO_CHUNK) {
+        DES_KeyEnumerator keys_enum;
+        uint64_t base = (search.prefix << search.bits) | (chunk << search.chunk_bits);
+        if (scalar) des_key_enum_init(&keys_enum, base, search.chunk_bits);
+
+        for (uint64_t offset = 0; offset < chunk_keys && !atomic_load(&search.stop);
+             offset += BATCH_KEYS) {
+            size_t count = chunk_keys - offset < BATCH_KEYS ? (size_t)(chunk_keys - offset)
+                                                            : BATCH_KEYS;
+            search_batch(&search.test, &keys_enum, base + offset, count, scalar);
+            atomic_fetch_add(&self->current_tested, count);
+            atomic_fetch_add(&search.tested, count);
+        }
+    }
+
+    // A chunk abandoned because of a stop stays recorded in current for the checkpoint
+    atomic_fetch_add(&search.finished, 1);
+    return NULL;
+}
+
+// ================================
+//      Checkpoints
+// ================================
+
+// Collects every untried range: chunks in flight, owned ranges and the backlog. Chunks in
+// flight go back whole, so *tested (keys tested this run) leaves out their finished batches.
+static size_t snapshot_ranges(ChunkRange **out, uint64_t *tested) {
+    pthread_mutex_lock(&search.lock);
+    uint64_t in_flight = 0, done = atomic_load(&search.tested);
+    size_t capacity = search.pending_count + 2 * (size_t)search.worker_count;
+    ChunkRange *ranges = malloc((capacity ? capacity : 1) * sizeof(ChunkRange));
+    size_t count = 0;
+
+    if (ranges) {
+        for (int i = 0; i < search.worker_count; i++) {
+            Worker *w = &search.workers[i];
+            if (w->current != NO_CHUNK) {
+                ranges[count++] = (ChunkRange){ w->current, w->current + 1 };
+                in_flight += atomic_load(&w->current_tested);
+            }
+            if (w->next < w->end) {
+                ranges[count++] = (ChunkRange){ w->next, w->end };
+            }
+        }
+        memcpy(ranges + count, search.pending, search.pending_count * sizeof(ChunkRange));
+        count += search.pending_count;
+    }
+    pthread_mutex_unlock(&search.lock);
+    *tested = done > in_flight ? done - in_flight : 0;
+    *out = ranges;
+    return ranges ? count : 0;
+}
+
+// Written to a temporary file and renamed so a crash never leaves a torn checkpoint
+static int write_checkpoint_ranges(const char *path, const ChunkRange *ranges, size_t count,
+                                   uint64_t tested) {
+    char temp_path[4096];
+    FILE *fp;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    fp = fopen(temp_path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "%s\n", CHECKPOINT_MAGIC);
+    fprintf(fp, "block %016llX\n", (unsigned long long)search.test.plaintexts[0]);
+    fprintf(fp, "ciphertext %016llX\n", (unsigned long long)search.test.ciphertexts[0]);
+    fprintf(fp, "space %llX %d %d\n", (unsigned long long)search.prefix, search.bits,
+            search.chunk_bits);
+    fprintf(fp, "tested %llu\n", (unsigned long long)tested);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(fp, "range %llu %llu\n", (unsigned long long)ranges[i].start,
+                (unsigned long long)ranges[i].end);
+    }
+    if (fclose(fp) != 0 || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_checkpoint(const char *path) {
+    ChunkRange *ranges;
+    uint64_t tested;
+    size_t count = snapshot_ranges(&ranges, &tested);
+    if (!ranges) return -1;
+    int result = write_checkpoint_ranges(path, ranges, count, search.tested_before + tested);
+    free(ranges);
+    return result;
+}
+
+// Appends a range to the backlog (callers hold the lock or run before the workers start)
+static int push_pending(ChunkRange range) {
+    if (search.pending_count == search.pending_capacity) {
+        size_t capacity = search.pending_capacity ? 2 * search.pending_capacity : 64;
+        ChunkRange *grown = realloc(search.pending, capacity * sizeof(ChunkRange));
+        if (!grown) return -1;
+        search.pending = grown;
+        search.pending_capacity = capacity;
+    }
+    search.pending[search.pending_count++] = range;
+    return 0;
+}
+
+// Loads the untried ranges into the backlog; the search parameters must match
+static int load_checkpoint(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    unsigned long long block = 0, ciphertext = 0, prefix = 0, tested = 0, start, end;
+    int bits = -1, chunk_bits = -1;
+
+    if (!fp) return -1;
+    if (!fgets(line, sizeof(line), fp) || strncmp(line, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC)) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "block %llX", &block) == 1) continue;
+        if (sscanf(line, "ciphertext %llX", &ciphertext) == 1) continue;
+        if (sscanf(line, "space %llX %d %d", &prefix, &bits, &chunk_bits) == 3) continue;
+        if (sscanf(line, "tested %llu", &tested) == 1) continue;
+        if (sscanf(line, "range %llu %llu", &start, &end) == 2 && start < end &&
+            push_pending((ChunkRange){ start, end }) != 0) {
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    if (block != search.test.plaintexts[0] || ciphertext != search.test.ciphertexts[0] ||
+        prefix != search.prefix || bits != search.bits || chunk_bits != search.chunk_bits) {
+        fprintf(stderr, "Checkpoint %s belongs to a different search\n", path);
+        return -1;
+    }
+    search.tested_before = tested;
+    search.use_backlog = 1;
+    return 0;
+}
+
+// ================================
+//      Search Driver
+// ================================
+
+static void print_progress(double elapsed, uint64_t rate_keys, double rate_elapsed) {
+    uint64_t total = 1ULL << search.bits;
+    uint64_t done = search.tested_before + atomic_load(&search.tested);
+    double rate = rate_elapsed > 0 ? (double)rate_keys / rate_elapsed : 0.0;
+    double left = rate > 0 && total > done ? (double)(total - done) / rate : 0.0;
+
+    fprintf(stderr, "[%7.1fs] %llu keys (%.2f%%), %.2f Mkeys/s, ETA %.0fs\n", elapsed,
+            (unsigned long long)done, 100.0 * (double)done / (double)total, rate / 1e6, left);
+}
+
+// Runs the worker threads over the backlog (or, unless use_backlog is set, the whole space
+// split evenly) and calls tick every 50 ms until they have all exited
+static void run_search_threads(int threads, void (*tick)(void *ctx, double now), void *ctx) {
+    uint64_t chunks = chunk_count();
+
+    atomic_store(&search.stop, 0);
+    atomic_store(&search.finished, 0);
+    search.worker_count = threads;
+    for (int i = 0; i < threads; i++) {
+        Worker *w = &search.workers[i];
+        w->index = i;
+        w->current = NO_CHUNK;
+        w->next = search.use_backlog ? 0 : chunks * (uint64_t)i / (uint64_t)threads;
+        w->end = search.use_backlog ? 0 : chunks * (uint64_t)(i + 1) / (uint64_t)threads;
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&search.workers[i].thread, NULL, search_worker, &search.workers[i]);
+    }
+    while (atomic_load(&search.finished) < threads) {
+        sleep_ms(50);
+        tick(ctx, now_seconds());
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(search.workers[i].thread, NULL);
+    }
+}
+
+typedef struct {
+    const char *checkpoint;
+    double interval;
+    double start, last_report, last_checkpoint;
+    uint64_t last_tested;
+} LocalTick;
+
+// Progress once a second and a checkpoint every interval seconds
+static void local_tick(void *ctx, double now) {
+    LocalTick *t = ctx;
+    if (interrupted) atomic_store(&search.stop, 1);
+    if (now - t->last_report >= 1.0) {
+        uint64_t tested = atomic_load(&search.tested);
+        print_progress(now - t->start, tested - t->last_tested, now - t->last_report);
+        t->last_tested = tested;
+        t->last_report = now;
+    }
+    if (t->checkpoint && now - t->last_checkpoint >= t->interval) {
+        if (write_checkpoint(t->checkpoint) != 0) {
+            fprintf(stderr, "Could not write checkpoint %s\n", t->checkpoint);
+        }
+        t->last_checkpoint = now;
+    }
+}
+
+/**
+ * @brief Searches the configured key space with worker threads.
+ * @param threads Number of worker threads.
+ * @param checkpoint Checkpoint file path, or NULL for none.
+ * @param interval Seconds between checkpoints.
+ * @return 1 if the key was found, 0 if the space was exhausted, -1 if interrupted.
+ */
+static int brute_force_des(int threads, const char *checkpoint, double interval) {
+    double start = now_seconds();
+    LocalTick tick = { checkpoint, interval, start, start, start, 0 };
+    int result;
+
+    printf("Starting brute-force attack: 2^%d keys%s, %zu known pairs, %d threads, %s kernel...\n",
+           search.bits, search.test.target_count > 1 ? " (+ complements)" : "",
+           search.test.pair_count, threads, des_kernel_name(des_get_kernel()));
+    fflush(stdout);
+    run_search_threads(threads, local_tick, &tick);
+
+    double elapsed = now_seconds() - start;
+    uint64_t tested = atomic_load(&search.tested);
+    printf("Tested %llu keys in %.2fs (%.2f Mkeys/s)\n", (unsigned long long)tested, elapsed,
+           elapsed > 0 ? (double)tested / elapsed / 1e6 : 0.0);
+
+    if (atomic_load(&search.found)) {
+        result = 1;
+    } else if (interrupted) {
+        result = -1;
+    } else {
+        result = 0;
+    }
+
+    if (checkpoint) {
+        if (result == -1) {
+            if (write_checkpoint(checkpoint) == 0) {
+                printf("Interrupted; resume with --resume --checkpoint %s\n", checkpoint);
+            }
+        } else {
+            remove(checkpoint);
+        }
+    }
+    return result;
+}
+
+// ================================
+//      Distributed Mode
+// ================================
+
+// A coordinator owns the key space and leases ranges of chunks to worker processes
+// over a line-based protocol on TCP ("host:port") or a Unix socket ("unix:/path"):
+//
+//   worker -> coordinator   HELLO <name>
+//   coordinator -> worker   PROBLEM <prefix> <bits> <chunk_bits> <pairs> <P1> <C1> ...
+//   coordinator -> worker   LEASE <id> <first chunk> <end chunk>
+//   worker -> coordinator   PROGRESS <id> <keys tested in lease> <keys/s>   (every second)
+//   worker -> coordinator   DONE <id>            (lease exhausted; wants the next one)
+//   worker -> coordinator   FOUND <key>
+//   coordinator -> worker   STOP [<key>]
+//
+// A lease whose worker disconnects or stays silent for --lease-timeout seconds goes back
+// into the backlog and is handed to the next idle worker.
+
+#define MAX_CLIENTS 256
+#define LINE_MAX_LENGTH 1024
+
+typedef struct {
+    int fd;
+    char buffer[4 * LINE_MAX_LENGTH];
+    size_t length;
+} Connection;
+
+static int net_open(const char *address, int listening) {
+    int fd = -1;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strncpy(sa.sun_path, address + 5, sizeof(sa.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            unlink(sa.sun_path);
+            if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0 && listen(fd, 64) == 0) return fd;
+        } else if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0) {
+            return fd;
+        }
+        close(fd);
+        return -1;
+    }
+
+    char host[256];
+    const char *colon = strrchr(address, ':');
+    if (!colon || (size_t)(colon - address) >= sizeof(host)) return -1;
+    memcpy(host, address, (size_t)(colon - address));
+    host[colon - address] = '\0';
+
+    struct addrinfo hints, *list, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &list) != 0) return -1;
+    for (ai = list; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (listening) {
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+static int net_send(int fd, const char *format, ...) {
+    char line[LINE_MAX_LENGTH];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    if (length < 0 || length >= (int)sizeof(line) - 1) return -1;
+    line[length++] = '\n';
+    for (int sent = 0; sent < length;) {
+        ssize_t n = send(fd, line + sent, (size_t)(length - sent), MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        sent += (int)n;
+    }
+    return 0;
+}
+
+// Reads whatever is available; -1 once the peer has closed the connection
+static int net_fill(Connection *conn) {
+    if (conn->length == sizeof(conn->buffer)) return -1;  // Line too long: protocol error
+    ssize_t n = recv(conn->fd, conn->buffer + conn->length, sizeof(conn->buffer) - conn->length, 0);
+    if (n <= 0) return -1;
+    conn->length += (size_t)n;
+    return 0;
+}
+
+// Pops one complete line (without the newline) from the buffer
+static int net_next_line(Connection *conn, char *line, size_t size) {
+    char *newline = memchr(conn->buffer, '\n', conn->length);
+    if (!newline) return 0;
+    size_t length = (size_t)(newline - conn->buffer);
+    size_t copied = length < size - 1 ? length : size - 1;
+    memcpy(line, conn->buffer, copied);
+    line[copied] = '\0';
+    conn->length -= length + 1;
+    memmove(conn->buffer, newline + 1, conn->length);
+    return 1;
+}
+
+// ---- Coordinator ----
+
+typedef struct {
+    Connection conn;
+    char name[64];
+    int has_lease;
+    uint64_t lease_id;
+    ChunkRange lease;
+    uint64_t lease_tested;  // Keys tested so far in the current lease
+    uint64_t tested;        // Keys tested in completed leases
+    double rate;            // Last reported keys/s
+    double joined, last_heard;
+} Client;
+
+static Client clients[MAX_CLIENTS];
+static int client_count = 0;
+
+static void coordinator_requeue(Client *c) {
+    if (c->has_lease) {
+        push_pending(c->lease);
+        c->has_lease = 0;
+    }
+}
+
+static void coordinator_drop(Client *c, const char *reason, double now) {
+    double seconds = now - c->joined;
+    printf("Worker %s %s after %llu keys (%.2f Mkeys/s average)\n", c->name, reason,
+           (unsigned long long)(c->tested + c->lease_tested),
+           seconds > 0 ? (double)(c->tested + c->lease_tested) / seconds / 1e6 : 0.0);
+    if (c->has_lease) {
+        printf("  lease %llu (chunks %llu-%llu) returned to the backlog\n",
+               (unsigned long long)c->lease_id, (unsigned long long)c->lease.start,
+               (unsigned long long)c->lease.end);
+    }
+    coordinator_requeue(c);
+    close(c->conn.fd);
+    *c = clients[--client_count];
+}
+
+// Hands an idle, introduced worker the front of the last backlog range
+static void coordinator_assign(Client *c, uint64_t lease_chunks, uint64_t *next_lease_id) {
+    if (c->has_lease || !c->name[0] || search.pending_count == 0) return;
+    ChunkRange *range = &search.pending[search.pending_count - 1];
+    c->lease.start = range->start;
+    c->lease.end = range->end - range->start > lease_chunks ? range->start + lease_chunks : range->end;
+    range->start = c->lease.end;
+    if (range->start == range->end) search.pending_count--;
+    c->has_lease = 1;
+    c->lease_id = (*next_lease_id)++;
+    c->lease_tested = 0;
+    net_send(c->conn.fd, "LEASE %llu %llu %llu", (unsigned long long)c->lease_id,
+             (unsigned long long)c->lease.start, (unsigned long long)c->lease.end);
+}
+
+static void coordinator_send_problem(Client *c) {
+    char line[LINE_MAX_LENGTH];
+    int length = snprintf(line, sizeof(line), "PROBLEM %llX %d %d %zu",
+                          (unsigned long long)search.prefix, search.bits, search.chunk_bits,
+                          search.test.pair_count);
+    for (size_t i = 0; i < search.test.pair_count; i++) {
+        length += snprintf(line + length, sizeof(line) - (size_t)length, " %016llX %016llX",
+                           (unsigned long long)search.test.plaintexts[i],
+                           (unsigned long long)search.test.ciphertexts[i]);
+    }
+    net_send(c->conn.fd, "%s", line);
+}
+
+// Handles one protocol line; returns -1 if the worker misbehaved
+static int coordinator_handle(Client *c, const char *line, uint64_t *completed_keys) {
+    unsigned long long id, tested, key;
+    double rate;
+    char name[64];
+
+    if (sscanf(line, "HELLO %63s", name) == 1) {
+        snprintf(c->name, sizeof(c->name), "%s", name);
+        printf("Worker %s joined\n", c->name);
+        coordinator_send_problem(c);
+    } else if (sscanf(line, "PROGRESS %llu %llu %lf", &id, &tested, &rate) == 3) {
+        if (c->has_lease && id == c->lease_id) c->lease_tested = tested;
+        c->rate = rate;
+    } else if (sscanf(line, "DONE %llu", &id) == 1) {
+        if (c->has_lease && id == c->lease_id) {
+            uint64_t keys = (c->lease.end - c->lease.start) << search.chunk_bits;
+            c->tested += keys;
+            *completed_keys += keys;
+            c->has_lease = 0;
+            c->lease_tested = 0;
+        }
+    } else if (sscanf(line, "FOUND %llX", &key) == 1) {
+        // Trust but verify: the key must satisfy every known pair
+        DES_RoundKeys round_keys;
+        des_key_setup((uint64_t)key, &round_keys);
+        if (des_key_test_schedule(&search.test, &round_keys) & 1) {
+            printf("Worker %s found the key\n", c->name);
+            search.found_key = (uint64_t)key;
+            atomic_store(&search.found, 1);
+        } else {
+            printf("Worker %s reported a wrong key %016llX\n", c->name, key);
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Leases count as untried until they are reported done
+static void coordinator_checkpoint(const char *path, uint64_t completed_keys) {
+    ChunkRange *ranges = malloc((search.pending_count + MAX_CLIENTS) * sizeof(ChunkRange));
+    size_t count = search.pending_count;
+    if (!ranges) return;
+    memcpy(ranges, search.pending, count * sizeof(ChunkRange));
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i].has_lease) ranges[count++] = clients[i].lease;
+    }
+    if (write_checkpoint_ranges(path, ranges, count, completed_keys) != 0) {
+        fprintf(stderr, "Could not write checkpoint %s\n", path);
+    }
+    free(ranges);
+}
+
+/**
+ * @brief Runs the coordinator until the key is found, the space is exhausted or SIGINT.
+ * @return 1 if the key was found, 0 if the space was exhausted, -1 on error or interrupt.
+ */
+static int run_coordinator(const char *address, uint64_t lease_chunks, double lease_timeout,
+                           const char *checkpoint, double interval) {
+    int listen_fd = net_open(address, 1);
+    uint64_t next_lease_id = 1, completed_keys = search.tested_before;
+    uint64_t total = 1ULL << search.bits;
+    double start = now_seconds(), last_report = start, last_checkpoint = start;
+    struct pollfd fds[MAX_CLIENTS + 1];
+
+    if (listen_fd < 0) {
+        fprintf(stderr, "Cannot listen on %s\n", address);
+        return -1;
+    }
+    if (!search.use_backlog && push_pending((ChunkRange){ 0, chunk_count() }) != 0) return -1;
+    printf("Coordinator on %s: 2^%d keys in leases of %llu chunks (2^%d keys each)\n", address,
+           search.bits, (unsigned long long)lease_chunks, search.chunk_bits);
+    fflush(stdout);
+
+    for (;;) {
+        int outstanding = 0;
+        for (int i = 0; i < client_count; i++) outstanding += clients[i].has_lease;
+        if (atomic_load(&search.found) || interrupted) break;
+        if (search.pending_count == 0 && outstanding == 0) break;
+
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < client_count; i++) {
+            fds[i + 1].fd = clients[i].conn.fd;
+            fds[i + 1].events = POLLIN;
+        }
+        int polled = client_count;
+        if (poll(fds, (nfds_t)polled + 1, 200) < 0 && errno != EINTR) break;
+        double now = now_seconds();
+
+        // Walk backwards so dropping a client (swap with the last) is safe
+        for (int i = polled - 1; i >= 0; i--) {
+            Client *c = &clients[i];
+            char line[LINE_MAX_LENGTH];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (net_fill(&c->conn) != 0) {
+                coordinator_drop(c, "disconnected", now);
+                continue;
+            }
+            c->last_heard = now;
+            int bad = 0;
+            while (!bad && net_next_line(&c->conn, line, sizeof(line))) {
+                bad = coordinator_handle(c, line, &completed_keys) != 0;
+            }
+            if (bad) coordinator_drop(c, "sent a bad message and was dropped", now);
+        }
+
+        if ((fds[0].revents & POLLIN) && client_count < MAX_CLIENTS) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                Client *c = &clients[client_count++];
+                memset(c, 0, sizeof(*c));
+                c->conn.fd = fd;
+                c->joined = c->last_heard = now;
+            }
+        }
+
+        for (int i = client_count - 1; i >= 0; i--) {
+            if (clients[i].has_lease && now - clients[i].last_heard > lease_timeout) {
+                coordinator_drop(&clients[i], "timed out", now);
+            }
+        }
+        for (int i = 0; i < client_count; i++) {
+            coordinator_assign(&clients[i], lease_chunks, &next_lease_id);
+        }
+
+        if (now - last_report >= 2.0) {
+            uint64_t done = completed_keys;
+            double rate = 0.0;
+            for (int i = 0; i < client_count; i++) {
+                done += clients[i].lease_tested;
+                rate += clients[i].rate;
+            }
+            fprintf(stderr, "[%7.1fs] %d workers, %d leases out, %llu keys (%.2f%%), %.2f Mkeys/s, ETA %.0fs\n",
+                    now - start, client_count, outstanding, (unsigned long long)done,
+                    100.0 * (double)done / (double)total, rate / 1e6,
+                    rate > 0 && total > done ? (double)(total - done) / rate : 0.0);
+            last_report = now;
+        }
+        if (checkpoint && now - last_checkpoint >= interval) {
+            coordinator_checkpoint(checkpoint, completed_keys);
+            last_checkpoint = now;
+        }
+    }
+
+    int result = atomic_load(&search.found) ? 1 : (interrupted ? -1 : 0);
+    if (checkpoint) {
+        if (result == -1) {
+            coordinator_checkpoint(checkpoint, completed_keys);
+            printf("Interrupted; resume with --resume --checkpoint %s\n", checkpoint);
+        } else {
+            remove(checkpoint);
+        }
+    }
+    for (int i = 0; i < client_count; i++) {
+        clients[i].has_lease = 0;
+        if (result == 1) {
+            net_send(clients[i].conn.fd, "STOP %016llX", (unsigned long long)search.found_key);
+        } else {
+            net_send(clients[i].conn.fd, "STOP");
+        }
+    }
+    double now = now_seconds();
+    while (client_count > 0) coordinator_drop(&clients[client_count - 1], "released", now);
+    close(listen_fd);
+    if (strncmp(address, "unix:", 5) == 0) unlink(address + 5);
+    printf("Searched %llu keys in %.1fs\n", (unsigned long long)completed_keys, now - start);
+    return result;
+}
+
+// ---- Worker ----
+
+typedef struct {
+    Connection *conn;
+    uint64_t lease_id;
+    uint64_t keys_before;   // Keys tested in earlier leases of this session
+    double start, last_report;  // Session start; the heartbeat runs across leases
+    int stop_requested;     // STOP received, coordinator gone or SIGINT
+    uint64_t announced_key; // Key carried by a STOP, if any
+} WorkerTick;
+
+static void worker_handle_stop(WorkerTick *t, const char *line) {
+    unsigned long long key;
+    if (sscanf(line, "STOP %llX", &key) == 1) t->announced_key = (uint64_t)key;
+    t->stop_requested = 1;
+    atomic_store(&search.stop, 1);
+}
+
+// Heartbeat with progress once a second; a STOP from the coordinator ends the lease early
+static void worker_tick(void *ctx, double now) {
+    WorkerTick *t = ctx;
+    struct pollfd pfd = { t->conn->fd, POLLIN, 0 };
+    char line[LINE_MAX_LENGTH];
+
+    if (interrupted) {
+        t->stop_requested = 1;
+        atomic_store(&search.stop, 1);
+    }
+    if (poll(&pfd, 1, 0) > 0) {
+        if (net_fill(t->conn) != 0) {
+            t->stop_requested = 1;
+            atomic_store(&search.stop, 1);
+        }
+        while (net_next_line(t->conn, line, sizeof(line))) {
+            if (strncmp(line, "STOP", 4) == 0) worker_handle_stop(t, line);
+        }
+    }
+    if (now - t->last_report >= 1.0) {
+        uint64_t tested = atomic_load(&search.tested);
+        net_send(t->conn->fd, "PROGRESS %llu %llu %.0f", (unsigned long long)t->lease_id,
+                 (unsigned long long)tested, (double)(t->keys_before + tested) / (now - t->start));
+        t->last_report = now;
+    }
+}
+
+static int worker_setup(char *line) {
+    char *save = NULL;
+    char *token = strtok_r(line, " ", &save);  // "PROBLEM"
+    uint8_t plaintexts[8 * DES_KEY_TEST_MAX_PAIRS], ciphertexts[8 * DES_KEY_TEST_MAX_PAIRS];
+    size_t pairs;
+
+    if (!(token = strtok_r(NULL, " ", &save))) return -1;
+    search.prefix = strtoull(token, NULL, 16);
+    if (!(token = strtok_r(NULL, " ", &save))) return -1;
+    search.bits = atoi(token);
+    if (!(token = strtok_r(NULL, " ", &save))) return -1;
+    search.chunk_bits = atoi(token);
+    if (!(token = strtok_r(NULL, " ", &save))) return -1;
+    pairs = (size_t)strtoul(token, NULL, 10);
+    if (pairs == 0 || pairs > DES_KEY_TEST_MAX_PAIRS || search.bits < 1 || search.bits > 56 ||
+        search.chunk_bits < 1 || search.chunk_bits > search.bits) {
+        return -1;
+    }
+    for (size_t i = 0; i < 2 * pairs; i++) {
+        if (!(token = strtok_r(NULL, " ", &save))) return -1;
+        des_uint64_to_be_bytes(strtoull(token, NULL, 16),
+                               (i % 2 ? ciphertexts : plaintexts) + 8 * (i / 2));
+    }
+    return des_key_test_init(&search.test, plaintexts, ciphertexts, pairs);
+}
+
+/**
+ * @brief Connects to a coordinator and searches the leases it hands out.
+ * @return 1 if the key was found (here or by another worker), 0 if the coordinator
+ *         finished without it, -1 on error or interrupt.
+ */
+static int run_worker(const char *address, int threads) {
+    Connection conn;
+    char line[LINE_MAX_LENGTH], host[64];
+    uint64_t leases = 0;
+    double start = now_seconds();
+    WorkerTick tick = { &conn, 0, 0, start, start, 0, 0 };
+    int ready = 0;
+
+    memset(&conn, 0, sizeof(conn));
+    conn.fd = -1;
+    for (int attempt = 0; attempt < 50 && conn.fd < 0; attempt++) {
+        conn.fd = net_open(address, 0);
+        if (conn.fd < 0) sleep_ms(100);
+    }
+    if (conn.fd < 0) {
+        fprintf(stderr, "Cannot connect to %s\n", address);
+        return -1;
+    }
+    if (gethostname(host, sizeof(host)) != 0) snprintf(host, sizeof(host), "worker");
+    host[sizeof(host) - 1] = '\0';
+    net_send(conn.fd, "HELLO %s-%ld", host, (long)getpid());
+
+    for (;;) {
+        unsigned long long id, first, end, key;
+        while (!net_next_line(&conn, line, sizeof(line))) {
+            if (interrupted || net_fill(&conn) != 0) {
+                close(conn.fd);
+                return -1;
+            }
+        }
+
+        if (strncmp(line, "PROBLEM ", 8) == 0) {
+            if (worker_setup(line) != 0) {
+                fprintf(stderr, "Bad problem from coordinator\n");
+                break;
+            }
+            ready = 1;
+            printf("Searching for the coordinator with %d threads on the %s kernel\n", threads,
+                   des_kernel_name(des_get_kernel()));
+            fflush(stdout);
+        } else if (ready && sscanf(line, "LEASE %llu %llu %llu", &id, &first, &end) == 3 &&
+                   first < end) {
+            tick.lease_id = (uint64_t)id;
+            search.pending_count = 0;
+            search.use_backlog = 1;
+            push_pending((ChunkRange){ (uint64_t)first, (uint64_t)end });
+            atomic_store(&search.tested, 0);
+            run_search_threads(threads, worker_tick, &tick);
+            tick.keys_before += atomic_load(&search.tested);
+
+            if (atomic_load(&search.found)) {
+                printf("Key found: %016llX\n", (unsigned long long)search.found_key);
+                net_send(conn.fd, "FOUND %016llX", (unsigned long long)search.found_key);
+                atomic_store(&search.found, 0);  // Reported; now wait for the STOP
+            } else if (tick.stop_requested) {
+                if (tick.announced_key) {
+                    printf("Key found by another worker: %016llX\n",
+                           (unsigned long long)tick.announced_key);
+                }
+                close(conn.fd);
+                return interrupted ? -1 : (tick.announced_key ? 1 : 0);
+            } else {
+                leases++;
+                net_send(conn.fd, "DONE %llu", id);
+            }
+        } else if (sscanf(line, "STOP %llX", &key) == 1 || strcmp(line, "STOP") == 0) {
+            double elapsed = now_seconds() - start;
+            printf("Stopped after %llu leases, %llu keys (%.2f Mkeys/s)\n",
+                   (unsigned long long)leases, (unsigned long long)tick.keys_before,
+                   elapsed > 0 ? (double)tick.keys_before / elapsed / 1e6 : 0.0);
+            close(conn.fd);
+            return strcmp(line, "STOP") != 0;
+        }
+    }
+    close(conn.fd);
+    return -1;
+}
+
+// ================================
+//      Benchmark
+// ================================
+
+// Key trials per second on one thread for one search path:
+//   0  key and schedule rebuilt from the index, full 16-round encryption
+//   1  Gray enumerator, full 16-round encryption (scalar only)
+//   2  search_batch: early reject in round 15 (and complemented keys if the
+//      pairs allow it; those count as trials too)
+static double bench_rate(const DES_KeyTest *test, int path, int scalar, uint64_t total) {
+    uint64_t keys[BATCH_KEYS], matches[BATCH_KEYS / 64];
+    uint64_t target = test->ciphertexts[0];
+    uint64_t hits = 0;
+    DES_KeyEnumerator keys_enum;
+    double start = now_seconds();
+
+    des_key_enum_init(&keys_enum, 0, 56);
+    for (uint64_t done = 0; done < total; done += BATCH_KEYS) {
+        if (path == 2) {
+            search_batch(test, &keys_enum, done, BATCH_KEYS, scalar);
+        } else if (scalar) {
+            for (size_t i = 0; i < BATCH_KEYS; i++) {
+                DES_RoundKeys rebuilt;
+                uint8_t output[8];
+                const DES_RoundKeys *round_keys = &keys_enum.round_keys;
+                if (path == 0) {
+                    des_key_setup(des_key_from_index(done + i), &rebuilt);
+                    round_keys = &rebuilt;
+                } else {
+                    des_key_enum_next(&keys_enum);
+                }
+                des_encrypt_block_with_keys(test->plaintext, output, round_keys);
+                hits += des_be_bytes_to_uint64(output) == target;
+            }
+        } else {
+            uint8_t ciphertext[8];
+            des_uint64_to_be_bytes(target, ciphertext);
+            for (size_t i = 0; i < BATCH_KEYS; i++) keys[i] = des_key_from_index(done + i);
+            des_key_trial(keys, BATCH_KEYS, test->plaintext, ciphertext, matches);
+            hits += matches[0] != 0;
+        }
+    }
+    double rate = (double)total / (now_seconds() - start);
+    if (hits == UINT64_MAX) printf("(unreachable)\n");  // Keeps the trials observable
+    return path == 2 ? rate * test->target_count : rate;
+}
+
+static void run_benchmark(const DES_KeyTest *complement_test) {
+    static const char *const labels[] = {
+        "schedule per key, 16 rounds", "Gray enumerator, 16 rounds",
+        "early reject (round 15)", "early reject + complement"};
+    DES_Kernel kernel = des_get_kernel();
+    DES_KeyTest single = search.test;
+
+    // The plain paths see only the first pair; drop the complement target for them
+    single.target_count = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        int scalar = pass == 0;
+        uint64_t total = scalar ? 1ULL << 18 : 1ULL << 22;
+        double base = 0.0;
+
+        des_set_kernel(scalar ? DES_KERNEL_SCALAR : kernel);
+        for (int path = 0; path < 4; path++) {
+            if (path == 1 && !scalar) continue;  // The bitsliced search does not enumerate
+            const DES_KeyTest *test = path == 3 ? complement_test : &single;
+            double rate = bench_rate(test, path < 3 ? path : 2, scalar, total);
+            if (path == 0) base = rate;
+            printf("%-10s  %-32s %8.2f Mkeys/s  (x%.2f)\n", des_kernel_name(des_get_kernel()),
+                   labels[path], rate / 1e6, rate / base);
+        }
+    }
+    des_set_kernel(kernel);
+}
+
+int main(int argc, char **argv) {
+    uint8_t iv[8] = {0};
+    uint64_t test_key = 0x133457799BBCDFF1;
+    uint8_t message[8 * MAX_PAIRS] = KNOWN_MESSAGE;
+    uint8_t plaintexts[8 * (MAX_PAIRS + 1)], ciphertexts[8 * (MAX_PAIRS + 1)];
+    const char *checkpoint = NULL;
+    double interval = 10.0;
+    int threads = des_get_threads();
+    int pairs = 2;
+    int complement = 0;
+    int resume = 0;
+    int have_prefix = 0;
+    int bench = 0;
+    const char *coordinator = NULL, *worker_address = NULL;
+    uint64_t lease_chunks = 64;
+    double lease_timeout = 15.0;
+
+    search.bits = 28;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--resume") == 0) {
+            resume = 1;
+        } else if (strcmp(arg, "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(arg, "--complement") == 0) {
+            complement = 1;
+        } else if (value && strcmp(arg, "--key") == 0) {
+            test_key = strtoull(value, NULL, 16);
+            i++;
+        } else if (value && strcmp(arg, "--bits") == 0) {
+            search.bits = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--prefix") == 0) {
+            search.prefix = strtoull(value, NULL, 16);
+            have_prefix = 1;
+            i++;
+        } else if (value && strcmp(arg, "--threads") == 0) {
+            threads = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--pairs") == 0) {
+            pairs = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--coordinator") == 0) {
+            coordinator = value;
+            i++;
+        } else if (value && strcmp(arg, "--worker") == 0) {
+            worker_address = value;
+            i++;
+        } else if (value && strcmp(arg, "--lease") == 0) {
+            lease_chunks = strtoull(value, NULL, 10);
+            i++;
+        } else if (value && strcmp(arg, "--lease-timeout") == 0) {
+            lease_timeout = atof(value);
+            i++;
+        } else if (value && strcmp(arg, "--checkpoint") == 0) {
+            checkpoint = value;
+            i++;
+        } else if (value && strcmp(arg, "--interval") == 0) {
+            interval = atof(value);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--key HEX] [--bits N] [--prefix HEX] [--threads N]\n"
+                            "       [--pairs N] [--complement] [--checkpoint FILE]\n"
+                            "       [--interval SEC] [--resume] [--bench]\n"
+                            "       [--coordinator ADDR [--lease CHUNKS] [--lease-timeout SEC]]\n"
+                            "       [--worker ADDR]   (ADDR is host:port or unix:/path)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (search.bits < 1 || search.bits > 56) {
+        fprintf(stderr, "--bits must be between 1 and 56\n");
+        return 1;
+    }
+    if (pairs < 1 || pairs > MAX_PAIRS) {
+        fprintf(stderr, "--pairs must be between 1 and %d\n", MAX_PAIRS);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKERS) threads = MAX_WORKERS;
+    if (lease_chunks < 1) lease_chunks = 1;
+
+    // Broken connections show up as send errors, not as a fatal signal
+    signal(SIGPIPE, SIG_IGN);
+    if (worker_address) {
+        signal(SIGINT, on_interrupt);
+        int result = run_worker(worker_address, threads);
+        free(search.pending);
+        return result == 1 ? 0 : (result == 0 ? 2 : 1);
+    }
+
+    // Known message: block i of a CBC ciphertext is E(P_i ^ C_{i-1}), with C_0 = IV
+    memcpy(ciphertexts, message, 8 * (size_t)pairs);
+    des_cbc_encrypt(ciphertexts, 8 * (size_t)pairs, test_key, iv);
+    for (int b = 0; b < pairs; b++) {
+        const uint8_t *chain = b == 0 ? iv : ciphertexts + 8 * (b - 1);
+        for (int i = 0; i < 8; i++) plaintexts[8 * b + i] = message[8 * b + i] ^ chain[i];
+    }
+
+    // Chosen plaintext ~P_1 under the same IV gives the complementary pair
+    DES_KeyTest complement_test;
+    uint8_t *chosen = plaintexts + 8 * pairs, *chosen_ct = ciphertexts + 8 * pairs;
+    for (int i = 0; i < 8; i++) chosen_ct[i] = (uint8_t)~message[i];
+    des_cbc_encrypt(chosen_ct, 8, test_key, iv);
+    for (int i = 0; i < 8; i++) chosen[i] = (uint8_t)~plaintexts[i];
+    des_key_test_init(&complement_test, plaintexts, ciphertexts, (size_t)pairs + 1);
+    if (complement) {
+        search.test = complement_test;
+    } else {
+        des_key_test_init(&search.test, plaintexts, ciphertexts, (size_t)pairs);
+    }
+
+    if (bench) {
+        run_benchmark(&complement_test);
+        return 0;
+    }
+
+    // With the complement tested for free, the full search covers index bit 55 = 0 only
+    if (complement && search.bits == 56) {
+        search.bits = 55;
+        search.prefix = 0;
+        have_prefix = 1;
+    }
+    search.chunk_bits = search.bits < CHUNK_BITS ? search.bits : CHUNK_BITS;
+    if (!have_prefix) search.prefix = search.bits == 56 ? 0 : des_key_to_index(test_key) >> search.bits;
+    if (search.bits < 56) search.prefix &= (1ULL << (56 - search.bits)) - 1;
+
+    if (resume) {
+        if (!checkpoint || load_checkpoint(checkpoint) != 0) {
+            fprintf(stderr, "Cannot resume: no usable checkpoint\n");
+            return 1;
+        }
+        printf("Resuming: %zu untried ranges, %llu keys already tested\n", search.pending_count,
+               (unsigned long long)search.tested_before);
+        if (search.pending_count == 0) {
+            printf("Checkpoint has no untried ranges: the key space is exhausted.\n");
+            free(search.pending);
+            return 2;
+        }
+    }
+
+    signal(SIGINT, on_interrupt);
+    int result = coordinator ? run_coordinator(coordinator, lease_chunks, lease_timeout, checkpoint, interval)
+                             : brute_force_des(threads, checkpoint, interval);
+    if (result == 1) {
+        printf("Key found: %016llX\n", (unsigned long long)search.found_key);
+    } else if (result == 0) {
+        printf("Key not found in the searched space.\n");
+    }
+    free(search.pending);
+    return result == 1 ? 0 : (result == 0 ? 2 : 130);
+}
@@ -1,4 +1,6 @@
-#include "des.h"
+#include "des_internal.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 
 
@@ -62,47 +64,15 @@ const uint8_t DES_FINAL_MESSAGE_PERMUTATION[] = {40,  8, 48, 16, 56, 24, 64, 32,
 									          34,  2, 42, 10, 50, 18, 58, 26,
 									          33,  1, 41,  9, 49, 17, 57, 25};
 
-// S-boxes (in hexadecimal)
-const uint32_t DES_SBOX1[] = {14,  4, 13,  1,  2, 15, 11,  8,  3, 10,  6, 12,  5,  9,  0,  7,
-    0, 15,  7,  4, 14,  2, 13,  1, 10,  6, 12, 11,  9,  5,  3,  8,
-    4,  1, 14,  8, 13,  6,  2, 11, 15, 12,  9,  7,  3, 10,  5,  0,
-   15, 12,  8,  2,  4,  9,  1,  7,  5, 11,  3, 14, 10,  0,  6, 13};
-
- const uint32_t DES_SBOX2[] = {15,  1,  8, 14,  6, 11,  3,  4,  9,  7,  2, 13, 12,  0,  5, 10,
-    3, 13,  4,  7, 15,  2,  8, 14, 12,  0,  1, 10,  6,  9, 11,  5,
-    0, 14,  7, 11, 10,  4, 13,  1,  5,  8, 12,  6,  9,  3,  2, 15,
-   13,  8, 10,  1,  3, 15,  4,  2, 11,  6,  7, 12,  0,  5, 14,  9};
-
-const uint32_t DES_SBOX3[] = {10,  0,  9, 14,  6,  3, 15,  5,  1, 13, 12,  7, 11,  4,  2,  8,
-    13,  7,  0,  9,  3,  4,  6, 10,  2,  8,  5, 14, 12, 11, 15,  1,
-    13,  6,  4,  9,  8, 15,  3,  0, 11,  1,  2, 12,  5, 10, 14,  7,
-     1, 10, 13,  0,  6,  9,  8,  7,  4, 15, 14,  3, 11,  5,  2, 12};
-
-const uint32_t DES_SBOX4[] = { 7, 13, 14,  3,  0,  6,  9, 10,  1,  2,  8,  5, 11, 12,  4, 15,
-    13,  8, 11,  5,  6, 15,  0,  3,  4,  7,  2, 12,  1, 10, 14,  9,
-    10,  6,  9,  0, 12, 11,  7, 13, 15,  1,  3, 14,  5,  2,  8,  4,
-     3, 15,  0,  6, 10,  1, 13,  8,  9,  4,  5, 11, 12,  7,  2, 14};
-
- const uint32_t DES_SBOX5[]=  { 2, 12,  4,  1,  7, 10, 11,  6,  8,  5,  3, 15, 13,  0, 14,  9,
-    14, 11,  2, 12,  4,  7, 13,  1,  5,  0, 15, 10,  3,  9,  8,  6,
-     4,  2,  1, 11, 10, 13,  7,  8, 15,  9, 12,  5,  6,  3,  0, 14,
-    11,  8, 12,  7,  1, 14,  2, 13,  6, 15,  0,  9, 10,  4,  5,  3};
-
- const uint32_t DES_SBOX6[] = {12,  1, 10, 15,  9,  2,  6,  8,  0, 13,  3,  4, 14,  7,  5, 11,
-    10, 15,  4,  2,  7, 12,  9,  5,  6,  1, 13, 14,  0, 11,  3,  8,
-     9, 14, 15,  5,  2,  8, 12,  3,  7,  0,  4, 10,  1, 13, 11,  6,
-     4,  3,  2, 12,  9,  5, 15, 10, 11, 14,  1,  7,  6,  0,  8, 13};
-
- const uint32_t DES_SBOX7[] =  { 4, 11,  2, 14, 15,  0,  8, 13,  3, 12,  9,  7,  5, 10,  6,  1,
-    13,  0, 11,  7,  4,  9,  1, 10, 14,  3,  5, 12,  2, 15,  8,  6,
-     1,  4, 11, 13, 12,  3,  7, 14, 10, 15,  6,  8,  0,  5,  9,  2,
-     6, 11, 13,  8,  1,  4, 10,  7,  9,  5,  0, 15, 14,  2,  3, 12};
-
-
-const uint32_t DES_SBOX8[] = {13,  2,  8,  4,  6, 15, 11,  1, 10,  9,  3, 14,  5,  0, 12,  7,
-    1, 15, 13,  8, 10,  3,  7,  4, 12,  5,  6, 11,  0, 14,  9,  2,
-    7, 11,  4,  1,  9, 12, 14,  2,  0,  6, 10, 13, 15,  3,  5,  8,
-    2,  1, 14,  7,  4, 10,  8, 13, 15, 12,  9,  0,  3,  5,  6, 11};
+// S-boxes (values live in des_internal.h so the bitsliced core can fold them into gates)
+const uint32_t DES_SBOX1[] = DES_SBOX1_VALUES;
+const uint32_t DES_SBOX2[] = DES_SBOX2_VALUES;
+const uint32_t DES_SBOX3[] = DES_SBOX3_VALUES;
+const uint32_t DES_SBOX4[] = DES_SBOX4_VALUES;
+const uint32_t DES_SBOX5[] = DES_SBOX5_VALUES;
+const uint32_t DES_SBOX6[] = DES_SBOX6_VALUES;
+const uint32_t DES_SBOX7[] = DES_SBOX7_VALUES;
+const uint32_t DES_SBOX8[] = DES_SBOX8_VALUES;
 
 // ================================
 //      Utility Functions
@@ -136,10 +106,104 @@ void des_apply_permutation(uint64_t *output, uint64_t input, const uint8_t *tabl
     *output = result;
 }
 
+// Table-driven permutations (built once by des_init_tables)
+static DES_PermutationLUT des_ip_lut, des_fp_lut, des_pc1_lut, des_pc2_lut, des_p_lut;
+static uint32_t des_sp_table[8][64];  // S-box i output for each 6-bit input, already through P
+static uint64_t des_key_bit_masks[56][16];  // Subkey bits toggled by each key-index bit
+static uint32_t des_sp_masks[8];            // Output bits of S-box i after P
+static pthread_once_t des_tables_once = PTHREAD_ONCE_INIT;
+static atomic_int des_tables_ready;  // Set with release order once the tables are written
+
+const uint32_t *const DES_SBOXES[8] = {DES_SBOX1, DES_SBOX2, DES_SBOX3, DES_SBOX4,
+                                       DES_SBOX5, DES_SBOX6, DES_SBOX7, DES_SBOX8};
+
+void des_permutation_lut_init(DES_PermutationLUT *lut, const uint8_t *table, int n, int input_bits) {
+    memset(lut, 0, sizeof(*lut));
+    lut->input_bytes = (input_bits + 7) / 8;
+    for (int i = 0; i < n; i++) {
+        int src = input_bits - table[i];  // Source bit index counted from the LSB
+        uint64_t dst = 1ULL << (n - 1 - i);
+        for (int v = 0; v < 256; v++) {
+            if ((v >> (src % 8)) & 1) {
+                lut->lut[src / 8][v] |= dst;
+            }
+        }
+    }
+}
+
+// Unrolled forms for the input widths used by DES (32, 56 and 64 bits)
+static inline uint64_t des_lut_apply32(const DES_PermutationLUT *lut, uint64_t input) {
+    return lut->lut[0][input & 0xFF] | lut->lut[1][(input >> 8) & 0xFF] |
+           lut->lut[2][(input >> 16) & 0xFF] | lut->lut[3][(input >> 24) & 0xFF];
+}
+
+static inline uint64_t des_lut_apply56(const DES_PermutationLUT *lut, uint64_t input) {
+    return des_lut_apply32(lut, input) | lut->lut[4][(input >> 32) & 0xFF] |
+           lut->lut[5][(input >> 40) & 0xFF] | lut->lut[6][(input >> 48) & 0xFF];
+}
+
+static inline uint64_t des_lut_apply64(const DES_PermutationLUT *lut, uint64_t input) {
+    return des_lut_apply56(lut, input) | lut->lut[7][input >> 56];
+}
+
+uint64_t des_permutation_lut_apply(const DES_PermutationLUT *lut, uint64_t input) {
+    uint64_t result = 0;
+    for (int c = 0; c < lut->input_bytes; c++) {
+        result |= lut->lut[c][(input >> (8 * c)) & 0xFF];
+    }
+    return result;
+}
+
+// S-box lookup: the outer bits of the 6-bit group select the row, the inner four the column
+static inline uint32_t des_sbox_lookup(const uint32_t *sbox, uint32_t group) {
+    uint32_t row = ((group >> 4) & 2) | (group & 1);
+    uint32_t column = (group >> 1) & 0xF;
+    return sbox[row * 16 + column];
+}
+
+static void des_expand_key(uint64_t key, uint64_t *round_keys);
+static void des_build_tables(void);
+
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+void des_init_tables(void) {
+    if (!atomic_load_explicit(&des_tables_ready, memory_order_acquire)) {
+        pthread_once(&des_tables_once, des_build_tables);
+    }
+}
+
+static void des_build_tables(void) {
+    des_permutation_lut_init(&des_ip_lut, DES_INITIAL_MESSAGE_PERMUTATION, 64, 64);
+    des_permutation_lut_init(&des_fp_lut, DES_FINAL_MESSAGE_PERMUTATION, 64, 64);
+    des_permutation_lut_init(&des_pc1_lut, DES_INITIAL_KEY_PERMUTATION, 56, 64);
+    des_permutation_lut_init(&des_pc2_lut, DES_SUB_KEY_PERMUTATION, 48, 56);
+    des_permutation_lut_init(&des_p_lut, DES_RIGHT_SUB_MESSAGE_PERMUTATION, 32, 32);
+    for (int i = 0; i < 8; i++) {
+        for (uint32_t group = 0; group < 64; group++) {
+            uint32_t nibble = des_sbox_lookup(DES_SBOXES[i], group);
+            des_sp_table[i][group] = (uint32_t)des_lut_apply32(&des_p_lut, nibble << (28 - 4 * i));
+            des_sp_masks[i] |= des_sp_table[i][group];
+        }
+    }
+    // PC-1, the rotations and PC-2 only move bits, so the schedule is linear in the key
+    for (int bit = 0; bit < 56; bit++) {
+        des_expand_key(des_key_from_index(1ULL << bit) & ~0x0101010101010101ULL,
+                       des_key_bit_masks[bit]);
+    }
+    atomic_store_explicit(&des_tables_ready, 1, memory_order_release);
+}
+
 // Key Scheduling
 void des_generate_round_keys(uint64_t key, uint64_t *round_keys) {
-    uint64_t permuted_key;
-    des_apply_permutation(&permuted_key, key, DES_INITIAL_KEY_PERMUTATION, 56);
+    des_init_tables();
+    DES_PROFILE_BEGIN(DES_STAGE_KEY_SCHEDULE);
+    des_expand_key(key, round_keys);
+    DES_PROFILE_END(DES_STAGE_KEY_SCHEDULE);
+}
+
+static void des_expand_key(uint64_t key, uint64_t *round_keys) {
+    uint64_t permuted_key = des_lut_apply64(&des_pc1_lut, key);
 
     uint32_t left = (permuted_key >> 28) & 0x0FFFFFFF;
     uint32_t right = permuted_key & 0x0FFFFFFF;
@@ -147,109 +211,963 @@ void des_generate_round_keys(uint64_t key, uint64_t *round_keys) {
     for (int i = 0; i < 16; i++) {
         left = ((left << DES_KEY_SHIFT_SIZES[i]) | (left >> (28 - DES_KEY_SHIFT_SIZES[i]))) & 0x0FFFFFFF;
         right = ((right << DES_KEY_SHIFT_SIZES[i]) | (right >> (28 - DES_KEY_SHIFT_SIZES[i]))) & 0x0FFFFFFF;
-        des_apply_permutation(&round_keys[i], ((uint64_t)left << 28) | right, DES_SUB_KEY_PERMUTATION, 48);
+        round_keys[i] = des_lut_apply56(&des_pc2_lut, ((uint64_t)left << 28) | right);
     }
 }
 
-// Feistel Function
+// Feistel Function (reference, bit at a time). Inputs narrower than 64 bits are
+// left-aligned because des_apply_permutation counts positions from bit 63.
 void des_feistel_function(uint32_t right, uint64_t subkey, uint32_t *output) {
     uint64_t expanded;
-    des_apply_permutation(&expanded, right, DES_MESSAGE_EXPANSION, 48);
+    des_apply_permutation(&expanded, (uint64_t)right << 32, DES_MESSAGE_EXPANSION, 48);
     expanded ^= subkey;
 
     uint32_t substituted = 0;
-    // Simplified substitution (replace with actual S-box logic if needed)
-    substituted = expanded & 0xFFFFFFFF;
+    for (int i = 0; i < 8; i++) {
+        uint32_t group = (expanded >> (42 - 6 * i)) & 0x3F;
+        substituted = (substituted << 4) | des_sbox_lookup(DES_SBOXES[i], group);
+    }
 
-    des_apply_permutation((uint64_t *)output, substituted, DES_RIGHT_SUB_MESSAGE_PERMUTATION, 32);
+    uint64_t permuted;
+    des_apply_permutation(&permuted, (uint64_t)substituted << 32, DES_RIGHT_SUB_MESSAGE_PERMUTATION, 32);
+    *output = (uint32_t)permuted;
 }
 
-// DES Block Encryption
-void des_encrypt_block(const uint8_t *input, uint8_t *output, uint64_t key) {
+// S-box difference distribution: ddt[a][b] counts inputs x with S(x) ^ S(x ^ a) = b
+void des_sbox_ddt(int box, uint32_t ddt[64][16]) {
+    const uint32_t *sbox = DES_SBOXES[box];
+    memset(ddt, 0, 64 * sizeof(ddt[0]));
+    for (uint32_t a = 0; a < 64; a++) {
+        for (uint32_t x = 0; x < 64; x++) {
+            ddt[a][des_sbox_lookup(sbox, x) ^ des_sbox_lookup(sbox, x ^ a)]++;
+        }
+    }
+}
+
+// S-box linear approximation: lat[a][b] is the number of inputs x with a.x = b.S(x), minus 32
+void des_sbox_lat(int box, int32_t lat[64][16]) {
+    const uint32_t *sbox = DES_SBOXES[box];
+    for (uint32_t a = 0; a < 64; a++) {
+        for (uint32_t b = 0; b < 16; b++) {
+            int32_t agree = 0;
+            for (uint32_t x = 0; x < 64; x++) {
+                agree += __builtin_parity(a & x) == __builtin_parity(b & des_sbox_lookup(sbox, x));
+            }
+            lat[a][b] = agree - 32;
+        }
+    }
+}
+
+// Feistel Function (SP tables). E is done with rotates: the i-th 6-bit group of E(R)
+// is R rotated right by 27 - 4i, so each S-box costs one rotate, one lookup and one XOR.
+static inline uint32_t des_rotr32(uint32_t x, unsigned n) {
+    return (x >> (n & 31)) | (x << ((32 - n) & 31));
+}
+
+static inline uint32_t des_feistel_sp(uint32_t right, uint64_t subkey) {
+    return des_sp_table[0][(des_rotr32(right, 27) ^ (uint32_t)(subkey >> 42)) & 0x3F] ^
+           des_sp_table[1][(des_rotr32(right, 23) ^ (uint32_t)(subkey >> 36)) & 0x3F] ^
+           des_sp_table[2][(des_rotr32(right, 19) ^ (uint32_t)(subkey >> 30)) & 0x3F] ^
+           des_sp_table[3][(des_rotr32(right, 15) ^ (uint32_t)(subkey >> 24)) & 0x3F] ^
+           des_sp_table[4][(des_rotr32(right, 11) ^ (uint32_t)(subkey >> 18)) & 0x3F] ^
+           des_sp_table[5][(des_rotr32(right, 7) ^ (uint32_t)(subkey >> 12)) & 0x3F] ^
+           des_sp_table[6][(des_rotr32(right, 3) ^ (uint32_t)(subkey >> 6)) & 0x3F] ^
+           des_sp_table[7][(des_rotr32(right, 31) ^ (uint32_t)subkey) & 0x3F];
+}
+
+// Prepared key context
+void des_key_setup(uint64_t key, DES_RoundKeys *round_keys) {
+    des_generate_round_keys(key, round_keys->subkeys);
+    round_keys->key = key;
+}
+
+// Key enumeration. Index bit i is key bit 1 + i % 7 of byte 7 - i / 7 (counted from
+// the LSB), so flipping it also flips that byte's parity bit.
+uint64_t des_key_from_index(uint64_t index) {
+    uint64_t key = 0;
+    for (int byte = 0; byte < 8; byte++) {
+        uint64_t bits = (index >> (7 * byte)) & 0x7F;
+        uint64_t parity = !(__builtin_popcountll(bits) & 1);
+        key |= ((bits << 1) | parity) << (8 * byte);
+    }
+    return key;
+}
+
+uint64_t des_key_to_index(uint64_t key) {
+    uint64_t index = 0;
+    for (int byte = 0; byte < 8; byte++) {
+        index |= ((key >> (8 * byte + 1)) & 0x7F) << (7 * byte);
+    }
+    return index;
+}
+
+void des_key_enum_init(DES_KeyEnumerator *enumerator, uint64_t base_index, int bits) {
+    enumerator->index = base_index;
+    enumerator->key = des_key_from_index(base_index);
+    enumerator->step = 0;
+    enumerator->count = 1ULL << bits;
+    des_key_setup(enumerator->key, &enumerator->round_keys);
+}
+
+int des_key_enum_next(DES_KeyEnumerator *enumerator) {
+    if (++enumerator->step >= enumerator->count) return 0;
+    int bit = __builtin_ctzll(enumerator->step);  // Gray code: step n flips bit ctz(n)
+    const uint64_t *mask = des_key_bit_masks[bit];
+    enumerator->index ^= 1ULL << bit;
+    enumerator->key ^= ((2ULL << (bit % 7)) | 1) << (8 * (bit / 7));
+    for (int i = 0; i < 16; i++) {
+        enumerator->round_keys.subkeys[i] ^= mask[i];
+    }
+    enumerator->round_keys.key = enumerator->key;
+    return 1;
+}
+
+// Shared block routine: runs the first `rounds` rounds forwards (encrypt) or the last
+// ones backwards (decrypt). With states, state r = L_r || R_r (0 = after IP) is stored
+// for each round. Instantiated with constants, so the 16-round path pays for neither.
+static inline __attribute__((always_inline))
+void des_crypt_rounds(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode,
+                      const int rounds, uint64_t *states) {
+    DES_PROFILE_BEGIN(DES_STAGE_IP);
     uint64_t data = des_be_bytes_to_uint64(input);
-    uint64_t permuted;
-    des_apply_permutation(&permuted, data, DES_INITIAL_MESSAGE_PERMUTATION, 64);
+    uint64_t permuted = des_lut_apply64(&des_ip_lut, data);
 
     uint32_t left = (permuted >> 32) & 0xFFFFFFFF;
     uint32_t right = permuted & 0xFFFFFFFF;
+    DES_PROFILE_END(DES_STAGE_IP);
 
-    uint64_t *round_keys = (uint64_t *)malloc(16 * sizeof(uint64_t));
-    des_generate_round_keys(key, round_keys);
-
-    for (int i = 0; i < 16; i++) {
+    DES_PROFILE_BEGIN(DES_STAGE_ROUNDS);
+    if (states) states[0] = permuted;
+    for (int i = 0; i < rounds; i++) {
         uint32_t temp = right;
-        des_feistel_function(right, round_keys[i], &right);
-        right ^= left;
+        right = des_feistel_sp(right, subkeys[mode == DES_ENCRYPT ? i : 15 - i]) ^ left;
         left = temp;
+        if (states) states[i + 1] = ((uint64_t)left << 32) | right;
     }
+    DES_PROFILE_END(DES_STAGE_ROUNDS);
 
+    DES_PROFILE_BEGIN(DES_STAGE_FP);
     uint64_t final = ((uint64_t)right << 32) | left;
-    des_apply_permutation(&data, final, DES_FINAL_MESSAGE_PERMUTATION, 64);
+    data = des_lut_apply64(&des_fp_lut, final);
     des_uint64_to_be_bytes(data, output);
+    DES_PROFILE_END(DES_STAGE_FP);
+}
+
+static void des_crypt_block(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode) {
+    des_crypt_rounds(input, output, subkeys, mode, 16, NULL);
+}
+
+// Four independent blocks with their rounds interleaved, so the SP-table loads of
+// one block overlap the dependency chain of the others (`rounds` as in des_crypt_rounds)
+static inline __attribute__((always_inline))
+void des_crypt_rounds4(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode,
+                       const int rounds) {
+    uint32_t left[4], right[4];
+    DES_PROFILE_BEGIN(DES_STAGE_IP);
+    for (int b = 0; b < 4; b++) {
+        uint64_t permuted = des_lut_apply64(&des_ip_lut, des_be_bytes_to_uint64(input + 8 * b));
+        left[b] = permuted >> 32;
+        right[b] = permuted & 0xFFFFFFFF;
+    }
+    DES_PROFILE_END(DES_STAGE_IP);
+
+    DES_PROFILE_BEGIN(DES_STAGE_ROUNDS);
+    for (int i = 0; i < rounds; i++) {
+        uint64_t subkey = subkeys[mode == DES_ENCRYPT ? i : 15 - i];
+        uint32_t f0 = des_feistel_sp(right[0], subkey) ^ left[0];
+        uint32_t f1 = des_feistel_sp(right[1], subkey) ^ left[1];
+        uint32_t f2 = des_feistel_sp(right[2], subkey) ^ left[2];
+        uint32_t f3 = des_feistel_sp(right[3], subkey) ^ left[3];
+        left[0] = right[0]; left[1] = right[1]; left[2] = right[2]; left[3] = right[3];
+        right[0] = f0; right[1] = f1; right[2] = f2; right[3] = f3;
+    }
+    DES_PROFILE_END(DES_STAGE_ROUNDS);
+
+    DES_PROFILE_BEGIN(DES_STAGE_FP);
+    for (int b = 0; b < 4; b++) {
+        uint64_t final = ((uint64_t)right[b] << 32) | left[b];
+        des_uint64_to_be_bytes(des_lut_apply64(&des_fp_lut, final), output + 8 * b);
+    }
+    DES_PROFILE_END(DES_STAGE_FP);
+}
+
+static void des_crypt_blocks4(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode) {
+    des_crypt_rounds4(input, output, subkeys, mode, 16);
+}
+
+// Reduced-round encryption, one instantiation per round count so each loop unrolls:
+// a block with optional states, and four blocks without
+typedef void (*des_rounds_fn)(const uint8_t *input, uint8_t *output, const uint64_t *subkeys,
+                              uint64_t *states);
+typedef void (*des_rounds4_fn)(const uint8_t *input, uint8_t *output, const uint64_t *subkeys);
+
+#define DES_ROUNDS_INSTANCE(n) \
+    static void des_encrypt_rounds_##n(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, \
+                                       uint64_t *states) { \
+        des_crypt_rounds(input, output, subkeys, DES_ENCRYPT, n, states); \
+    } \
+    static void des_encrypt_rounds4_##n(const uint8_t *input, uint8_t *output, const uint64_t *subkeys) { \
+        des_crypt_rounds4(input, output, subkeys, DES_ENCRYPT, n); \
+    }
+DES_ROUNDS_INSTANCE(1) DES_ROUNDS_INSTANCE(2) DES_ROUNDS_INSTANCE(3) DES_ROUNDS_INSTANCE(4)
+DES_ROUNDS_INSTANCE(5) DES_ROUNDS_INSTANCE(6) DES_ROUNDS_INSTANCE(7) DES_ROUNDS_INSTANCE(8)
+DES_ROUNDS_INSTANCE(9) DES_ROUNDS_INSTANCE(10) DES_ROUNDS_INSTANCE(11) DES_ROUNDS_INSTANCE(12)
+DES_ROUNDS_INSTANCE(13) DES_ROUNDS_INSTANCE(14) DES_ROUNDS_INSTANCE(15) DES_ROUNDS_INSTANCE(16)
+
+static const des_rounds_fn des_encrypt_rounds_table[17] = {
+    NULL, des_encrypt_rounds_1, des_encrypt_rounds_2, des_encrypt_rounds_3, des_encrypt_rounds_4,
+    des_encrypt_rounds_5, des_encrypt_rounds_6, des_encrypt_rounds_7, des_encrypt_rounds_8,
+    des_encrypt_rounds_9, des_encrypt_rounds_10, des_encrypt_rounds_11, des_encrypt_rounds_12,
+    des_encrypt_rounds_13, des_encrypt_rounds_14, des_encrypt_rounds_15, des_encrypt_rounds_16,
+};
+
+static const des_rounds4_fn des_encrypt_rounds4_table[17] = {
+    NULL, des_encrypt_rounds4_1, des_encrypt_rounds4_2, des_encrypt_rounds4_3, des_encrypt_rounds4_4,
+    des_encrypt_rounds4_5, des_encrypt_rounds4_6, des_encrypt_rounds4_7, des_encrypt_rounds4_8,
+    des_encrypt_rounds4_9, des_encrypt_rounds4_10, des_encrypt_rounds4_11, des_encrypt_rounds4_12,
+    des_encrypt_rounds4_13, des_encrypt_rounds4_14, des_encrypt_rounds4_15, des_encrypt_rounds4_16,
+};
+
+// Triple DES (EDE). The 48 subkeys run as one sequence (reversed to decrypt); between
+// stages FP is followed by IP, which cancel, leaving only the swap of the halves.
+static inline int des3_subkey(int n, int mode) {
+    return mode == DES_ENCRYPT ? n : 47 - n;
+}
+
+static void des3_crypt_block(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode) {
+    DES_PROFILE_BEGIN(DES_STAGE_IP);
+    uint64_t permuted = des_lut_apply64(&des_ip_lut, des_be_bytes_to_uint64(input));
+    uint32_t left = (uint32_t)(permuted >> 32);
+    uint32_t right = (uint32_t)permuted;
+    DES_PROFILE_END(DES_STAGE_IP);
+
+    DES_PROFILE_BEGIN(DES_STAGE_ROUNDS);
+    for (int stage = 0; stage < 3; stage++) {
+        for (int i = 16 * stage; i < 16 * stage + 16; i += 2) {
+            left ^= des_feistel_sp(right, subkeys[des3_subkey(i, mode)]);
+            right ^= des_feistel_sp(left, subkeys[des3_subkey(i + 1, mode)]);
+        }
+        if (stage < 2) {
+            uint32_t temp = left;
+            left = right;
+            right = temp;
+        }
+    }
+    DES_PROFILE_END(DES_STAGE_ROUNDS);
+
+    DES_PROFILE_BEGIN(DES_STAGE_FP);
+    uint64_t final = ((uint64_t)right << 32) | left;
+    des_uint64_to_be_bytes(des_lut_apply64(&des_fp_lut, final), output);
+    DES_PROFILE_END(DES_STAGE_FP);
+}
+
+// Four blocks in flight, as in des_crypt_blocks4
+static void des3_crypt_blocks4(const uint8_t *input, uint8_t *output, const uint64_t *subkeys, int mode) {
+    uint32_t left[4], right[4];
+    DES_PROFILE_BEGIN(DES_STAGE_IP);
+    for (int b = 0; b < 4; b++) {
+        uint64_t permuted = des_lut_apply64(&des_ip_lut, des_be_bytes_to_uint64(input + 8 * b));
+        left[b] = (uint32_t)(permuted >> 32);
+        right[b] = (uint32_t)permuted;
+    }
+    DES_PROFILE_END(DES_STAGE_IP);
+
+    DES_PROFILE_BEGIN(DES_STAGE_ROUNDS);
+    for (int stage = 0; stage < 3; stage++) {
+        for (int i = 16 * stage; i < 16 * stage + 16; i += 2) {
+            uint64_t first = subkeys[des3_subkey(i, mode)];
+            uint64_t second = subkeys[des3_subkey(i + 1, mode)];
+            left[0] ^= des_feistel_sp(right[0], first);
+            left[1] ^= des_feistel_sp(right[1], first);
+            left[2] ^= des_feistel_sp(right[2], first);
+            left[3] ^= des_feistel_sp(right[3], first);
+            right[0] ^= des_feistel_sp(left[0], second);
+            right[1] ^= des_feistel_sp(left[1], second);
+            right[2] ^= des_feistel_sp(left[2], second);
+            right[3] ^= des_feistel_sp(left[3], second);
+        }
+        if (stage < 2) {
+            for (int b = 0; b < 4; b++) {
+                uint32_t temp = left[b];
+                left[b] = right[b];
+                right[b] = temp;
+            }
+        }
+    }
+    DES_PROFILE_END(DES_STAGE_ROUNDS);
+
+    DES_PROFILE_BEGIN(DES_STAGE_FP);
+    for (int b = 0; b < 4; b++) {
+        uint64_t final = ((uint64_t)right[b] << 32) | left[b];
+        des_uint64_to_be_bytes(des_lut_apply64(&des_fp_lut, final), output + 8 * b);
+    }
+    DES_PROFILE_END(DES_STAGE_FP);
+}
+
+void des3_key_setup(uint64_t key1, uint64_t key2, uint64_t key3, DES3_RoundKeys *round_keys) {
+    uint64_t middle[16];
+    des_generate_round_keys(key1, round_keys->subkeys);
+    des_generate_round_keys(key2, middle);
+    des_generate_round_keys(key3, round_keys->subkeys + 32);
+    for (int i = 0; i < 16; i++) {
+        round_keys->subkeys[16 + i] = middle[15 - i];  // K2 decrypts
+    }
+    round_keys->keys[0] = key1;
+    round_keys->keys[1] = key2;
+    round_keys->keys[2] = key3;
+}
+
+void des3_ecb_blocks(const uint8_t *input, uint8_t *output, size_t blocks,
+                     const DES3_RoundKeys *round_keys, int mode) {
+    DES_PROFILE_BEGIN(DES_STAGE_ECB);
+    size_t i = blocks >= DES_BITSLICE_LANES ? des_kernel_ecb(input, output, blocks, round_keys->keys, 3, mode) : 0;
+    for (; i + 4 <= blocks; i += 4) {
+        des3_crypt_blocks4(input + 8 * i, output + 8 * i, round_keys->subkeys, mode);
+    }
+    for (; i < blocks; i++) {
+        des3_crypt_block(input + 8 * i, output + 8 * i, round_keys->subkeys, mode);
+    }
+    DES_PROFILE_END(DES_STAGE_ECB);
+}
+
+void des3_encrypt_block(const uint8_t *input, uint8_t *output, const DES3_RoundKeys *round_keys) {
+    des3_crypt_block(input, output, round_keys->subkeys, DES_ENCRYPT);
+}
+
+void des3_decrypt_block(const uint8_t *input, uint8_t *output, const DES3_RoundKeys *round_keys) {
+    des3_crypt_block(input, output, round_keys->subkeys, DES_DECRYPT);
+}
+
+void des3_ecb_encrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys) {
+    des3_ecb_blocks(data, data, length / 8, round_keys, DES_ENCRYPT);
+}
+
+void des3_ecb_decrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys) {
+    des3_ecb_blocks(data, data, length / 8, round_keys, DES_DECRYPT);
+}
+
+// Key testing
+int des_key_test_init(DES_KeyTest *test, const uint8_t *plaintexts, const uint8_t *ciphertexts,
+                      size_t count) {
+    if (count == 0 || count > DES_KEY_TEST_MAX_PAIRS) return -1;
+    des_init_tables();
+
+    memcpy(test->plaintext, plaintexts, 8);
+    test->pair_count = count;
+    for (size_t i = 0; i < count; i++) {
+        test->plaintexts[i] = des_be_bytes_to_uint64(plaintexts + 8 * i);
+        test->ciphertexts[i] = des_be_bytes_to_uint64(ciphertexts + 8 * i);
+    }
+
+    // IP(C) is the pre-output R16 || L16, and L16 = R15 is what round 15 produces
+    uint64_t permuted = des_lut_apply64(&des_ip_lut, test->plaintexts[0]);
+    test->left = (uint32_t)(permuted >> 32);
+    test->right = (uint32_t)permuted;
+    test->targets[0] = (uint32_t)des_lut_apply64(&des_ip_lut, test->ciphertexts[0]);
+    test->target_count = 1;
+
+    // A pair (~P, C') means E_k(P) = ~C' exactly when ~k is the key
+    for (size_t i = 1; i < count; i++) {
+        if (test->plaintexts[i] == ~test->plaintexts[0]) {
+            test->targets[1] = ~(uint32_t)des_lut_apply64(&des_ip_lut, test->ciphertexts[i]);
+            test->target_count = 2;
+            break;
+        }
+    }
+    return 0;
+}
+
+static int des_key_test_verify(const DES_KeyTest *test, const uint64_t *subkeys) {
+    for (size_t i = 0; i < test->pair_count; i++) {
+        uint8_t block[8];
+        des_uint64_to_be_bytes(test->plaintexts[i], block);
+        des_crypt_block(block, block, subkeys, DES_ENCRYPT);
+        if (des_be_bytes_to_uint64(block) != test->ciphertexts[i]) return 0;
+    }
+    return 1;
+}
+
+int des_key_test_schedule(const DES_KeyTest *test, const DES_RoundKeys *round_keys) {
+    const uint64_t *k = round_keys->subkeys;
+    uint32_t left = test->left, right = test->right;
+    int alive = (1 << test->target_count) - 1;
+    int result = 0;
+
+    DES_PROFILE_BEGIN(DES_STAGE_KEY_TEST);
+    for (int i = 0; i < 14; i += 2) {
+        left ^= des_feistel_sp(right, k[i]);
+        right ^= des_feistel_sp(left, k[i + 1]);
+    }
 
-    free(round_keys); // Free dynamically allocated memory
+    // Round 15, one S-box at a time: each one fixes four bits of R15
+    for (int box = 0; box < 8 && alive; box++) {
+        uint32_t group = (des_rotr32(right, (unsigned)(27 - 4 * box)) ^ (uint32_t)(k[14] >> (42 - 6 * box))) & 0x3F;
+        uint32_t r15 = des_sp_table[box][group] ^ left;
+        for (int t = 0; t < test->target_count; t++) {
+            if ((r15 ^ test->targets[t]) & des_sp_masks[box]) alive &= ~(1 << t);
+        }
+    }
+
+    if ((alive & 1) && des_key_test_verify(test, k)) result |= 1;
+    if (alive & 2) {
+        // Complementing the key complements every subkey
+        uint64_t complement[16];
+        for (int i = 0; i < 16; i++) complement[i] = k[i] ^ 0xFFFFFFFFFFFFULL;
+        if (des_key_test_verify(test, complement)) result |= 2;
+    }
+    DES_PROFILE_END(DES_STAGE_KEY_TEST);
+    return result;
+}
+
+void des_ecb_blocks(const uint8_t *input, uint8_t *output, size_t blocks,
+                    const DES_RoundKeys *round_keys, int mode) {
+    size_t i = 0;
+    DES_PROFILE_BEGIN(DES_STAGE_ECB);
+    if (blocks >= DES_BITSLICE_LANES) {
+        i = des_kernel_ecb(input, output, blocks, &round_keys->key, 1, mode);
+    }
+    for (; i + 4 <= blocks; i += 4) {
+        des_crypt_blocks4(input + 8 * i, output + 8 * i, round_keys->subkeys, mode);
+    }
+    for (; i < blocks; i++) {
+        des_crypt_block(input + 8 * i, output + 8 * i, round_keys->subkeys, mode);
+    }
+    DES_PROFILE_END(DES_STAGE_ECB);
+}
+
+void des_encrypt_block_with_keys(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys) {
+    des_crypt_block(input, output, round_keys->subkeys, DES_ENCRYPT);
+}
+
+void des_decrypt_block_with_keys(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys) {
+    des_crypt_block(input, output, round_keys->subkeys, DES_DECRYPT);
+}
+
+// DES Block Encryption (expands the key on every call; prefer des_key_setup for bulk data)
+void des_encrypt_block(const uint8_t *input, uint8_t *output, uint64_t key) {
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    des_crypt_block(input, output, round_keys.subkeys, DES_ENCRYPT);
 }
 
 // DES Block Decryption
 void des_decrypt_block(const uint8_t *input, uint8_t *output, uint64_t key) {
-    uint64_t data = des_be_bytes_to_uint64(input);
-    uint64_t permuted;
-    des_apply_permutation(&permuted, data, DES_INITIAL_MESSAGE_PERMUTATION, 64);
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    des_crypt_block(input, output, round_keys.subkeys, DES_DECRYPT);
+}
 
-    uint32_t left = (permuted >> 32) & 0xFFFFFFFF;
-    uint32_t right = permuted & 0xFFFFFFFF;
+// Reduced-round encryption
+int des_encrypt_block_rounds(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys,
+                             int rounds, uint64_t *states) {
+    if (rounds < 1 || rounds > 16) return -1;
+    des_encrypt_rounds_table[rounds](input, output, round_keys->subkeys, states);
+    return 0;
+}
 
-    uint64_t *round_keys = (uint64_t *)malloc(16 * sizeof(uint64_t));
-    des_generate_round_keys(key, round_keys);
+int des_ecb_encrypt_rounds(uint8_t *data, size_t length, const DES_RoundKeys *round_keys,
+                           int rounds, uint64_t *states) {
+    if (rounds < 1 || rounds > 16) return -1;
+    size_t blocks = length / 8, i = 0;
+    des_rounds_fn fn = des_encrypt_rounds_table[rounds];
 
-    for (int i = 15; i >= 0; i--) {
-        uint32_t temp = right;
-        des_feistel_function(right, round_keys[i], &right);
-        right ^= left;
-        left = temp;
+    DES_PROFILE_BEGIN(DES_STAGE_ECB);
+    if (blocks >= DES_BITSLICE_LANES) {
+        i = des_kernel_ecb_rounds(data, data, blocks, round_keys->key, rounds, states);
+    }
+    for (; !states && i + 4 <= blocks; i += 4) {
+        des_encrypt_rounds4_table[rounds](data + 8 * i, data + 8 * i, round_keys->subkeys);
     }
+    for (; i < blocks; i++) {
+        fn(data + 8 * i, data + 8 * i, round_keys->subkeys, states ? states + i * (size_t)(rounds + 1) : NULL);
+    }
+    DES_PROFILE_END(DES_STAGE_ECB);
+    return 0;
+}
 
-    uint64_t final = ((uint64_t)right << 32) | left;
-    des_apply_permutation(&data, final, DES_FINAL_MESSAGE_PERMUTATION, 64);
-    des_uint64_to_be_bytes(data, output);
+// ECB Mode (whole kernel passes go through the active bulk kernel)
+void des_ecb_encrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys) {
+    des_ecb_blocks(data, data, length / 8, round_keys, DES_ENCRYPT);
+}
+
+void des_ecb_decrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys) {
+    des_ecb_blocks(data, data, length / 8, round_keys, DES_DECRYPT);
+}
+
+// Key-agile batches: block i under keys[i]. Slices go to the thread pool; within a slice
+// whole passes run on the kernel (one key per lane), the rest on the scalar path.
+typedef struct {
+    const uint64_t *keys;
+    const uint8_t *input;
+    uint8_t *output;
+    size_t count;
+    size_t slices;
+    int mode;
+} DES_MultikeyJob;
 
-    free(round_keys); // Free dynamically allocated memory
+static void des_multikey_task(void *arg, size_t slice) {
+    DES_MultikeyJob *job = (DES_MultikeyJob *)arg;
+    // Slice boundaries fall on whole passes of the widest kernel
+    size_t passes = job->count / DES_KERNEL_MAX_LANES;
+    size_t begin = slice == 0 ? 0 : DES_KERNEL_MAX_LANES * (passes * slice / job->slices);
+    size_t end = slice + 1 == job->slices ? job->count : DES_KERNEL_MAX_LANES * (passes * (slice + 1) / job->slices);
+    size_t i = begin;
+    if (end - begin >= DES_BITSLICE_LANES) {
+        i += des_kernel_ecb_multikey(job->keys + begin, job->input + 8 * begin, job->output + 8 * begin,
+                                     end - begin, job->mode);
+    }
+    for (; i < end; i++) {
+        DES_RoundKeys round_keys;
+        des_key_setup(job->keys[i], &round_keys);
+        des_crypt_block(job->input + 8 * i, job->output + 8 * i, round_keys.subkeys, job->mode);
+    }
+}
+
+static void des_multikey_blocks(const uint64_t *keys, const uint8_t *input, uint8_t *output,
+                                size_t count, int mode) {
+    size_t slices = 8 * count / DES_PARALLEL_MIN_BYTES;
+    size_t threads = (size_t)des_get_threads();
+    if (slices > threads) slices = threads;
+    if (slices < 1) slices = 1;
+
+    DES_MultikeyJob job = {keys, input, output, count, slices, mode};
+    DES_PROFILE_BEGIN(DES_STAGE_MULTIKEY);
+    des_parallel_for(slices, des_multikey_task, &job);
+    DES_PROFILE_END(DES_STAGE_MULTIKEY);
+}
+
+void des_encrypt_blocks_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output, size_t count) {
+    des_multikey_blocks(keys, input, output, count, DES_ENCRYPT);
+}
+
+void des_decrypt_blocks_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output, size_t count) {
+    des_multikey_blocks(keys, input, output, count, DES_DECRYPT);
 }
 
-// CBC Mode
-void des_cbc_encrypt(uint8_t *data, size_t length, uint64_t key, uint8_t iv[8]) {
-    uint8_t *previous_block = (uint8_t *)malloc(8);
-    memcpy(previous_block, iv, 8);
+// Block cipher seen by the chaining modes: single DES, or EDE triple DES when triple is set
+typedef struct {
+    const DES_RoundKeys *single;
+    const DES3_RoundKeys *triple;
+} DES_BlockCipher;
 
-    for (size_t i = 0; i < length; i += 8) {
+static void des_cipher_blocks(const DES_BlockCipher *cipher, const uint8_t *input, uint8_t *output,
+                              size_t blocks, int mode) {
+    if (cipher->triple) {
+        des3_ecb_blocks(input, output, blocks, cipher->triple, mode);
+    } else {
+        des_ecb_blocks(input, output, blocks, cipher->single, mode);
+    }
+}
+
+// CBC Mode: encrypts blocks from input to output (which may be the same buffer),
+// chaining from and updating `chain`
+static void des_cbc_encrypt_blocks(const DES_BlockCipher *cipher, uint8_t chain[8],
+                                   const uint8_t *input, uint8_t *output, size_t blocks) {
+    uint8_t block[8];
+
+    for (size_t i = 0; i < blocks; i++) {
         for (int j = 0; j < 8; j++) {
-            data[i + j] ^= previous_block[j];
+            block[j] = input[8 * i + j] ^ chain[j];
         }
 
-        des_encrypt_block(&data[i], &data[i], key);
-        memcpy(previous_block, &data[i], 8);
+        if (cipher->triple) {
+            des3_crypt_block(block, chain, cipher->triple->subkeys, DES_ENCRYPT);
+        } else {
+            des_crypt_block(block, chain, cipher->single->subkeys, DES_ENCRYPT);
+        }
+        memcpy(&output[8 * i], chain, 8);
     }
+}
+
+static void des_cbc_encrypt_cipher(uint8_t *data, size_t length, const DES_BlockCipher *cipher,
+                                   const uint8_t iv[8]) {
+    uint8_t chain[8];
+    memcpy(chain, iv, 8);
+    DES_PROFILE_BEGIN(DES_STAGE_CBC_ENCRYPT);
+    des_cbc_encrypt_blocks(cipher, chain, data, data, length / 8);
+    DES_PROFILE_END(DES_STAGE_CBC_ENCRYPT);
+}
 
-    free(previous_block); // Free dynamically allocated memory
+void des_cbc_encrypt_with_keys(uint8_t *data, size_t length, const DES_RoundKeys *round_keys, const uint8_t iv[8]) {
+    DES_BlockCipher cipher = {round_keys, NULL};
+    des_cbc_encrypt_cipher(data, length, &cipher, iv);
 }
 
-void des_cbc_decrypt(uint8_t *data, size_t length, uint64_t key, uint8_t iv[8]) {
-    uint8_t *previous_block = (uint8_t *)malloc(8);
-    memcpy(previous_block, iv, 8);
+// CBC decryption of one contiguous slice. Each batch is decrypted into a scratch
+// buffer, then XORed with the preceding ciphertext walking backwards, so the
+// ciphertext a block needs is still in place when it is read.
+#define DES_CBC_BATCH_BLOCKS 512
 
-    for (size_t i = 0; i < length; i += 8) {
-        uint8_t *current_block = (uint8_t *)malloc(8);
-        memcpy(current_block, &data[i], 8);
+static void des_cbc_decrypt_slice(uint8_t *data, size_t blocks, const DES_BlockCipher *cipher,
+                                  const uint8_t previous[8]) {
+    uint8_t scratch[DES_CBC_BATCH_BLOCKS * 8];
+    uint8_t chain[8];
+    memcpy(chain, previous, 8);
 
-        des_decrypt_block(&data[i], &data[i], key);
+    for (size_t start = 0; start < blocks; start += DES_CBC_BATCH_BLOCKS) {
+        size_t count = blocks - start < DES_CBC_BATCH_BLOCKS ? blocks - start : DES_CBC_BATCH_BLOCKS;
+        uint8_t *batch = data + 8 * start;
+        uint8_t next_chain[8];
+        memcpy(next_chain, batch + 8 * (count - 1), 8);
 
+        des_cipher_blocks(cipher, batch, scratch, count, DES_DECRYPT);
+        for (size_t i = count - 1; i > 0; i--) {
+            for (int j = 0; j < 8; j++) {
+                batch[8 * i + j] = scratch[8 * i + j] ^ batch[8 * (i - 1) + j];
+            }
+        }
         for (int j = 0; j < 8; j++) {
-            data[i + j] ^= previous_block[j];
+            batch[j] = scratch[j] ^ chain[j];
+        }
+        memcpy(chain, next_chain, 8);
+    }
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t blocks;
+    size_t slices;
+    const DES_BlockCipher *cipher;
+    uint8_t (*previous)[8];  // Ciphertext block (or IV) preceding each slice
+} DES_CbcDecryptJob;
+
+static void des_cbc_decrypt_task(void *arg, size_t slice) {
+    DES_CbcDecryptJob *job = (DES_CbcDecryptJob *)arg;
+    size_t begin = job->blocks * slice / job->slices;
+    size_t end = job->blocks * (slice + 1) / job->slices;
+    des_cbc_decrypt_slice(job->data + 8 * begin, end - begin, job->cipher, job->previous[slice]);
+}
+
+static void des_cbc_decrypt_cipher(uint8_t *data, size_t length, const DES_BlockCipher *cipher,
+                                   const uint8_t iv[8]) {
+    size_t blocks = length / 8;
+    size_t slices = length / DES_PARALLEL_MIN_BYTES;
+    size_t threads = (size_t)des_get_threads();
+    if (slices > threads) slices = threads;
+    // Bounds the chaining-block array below
+    if (slices > DES_MAX_THREADS) slices = DES_MAX_THREADS;
+
+    DES_PROFILE_BEGIN(DES_STAGE_CBC_DECRYPT);
+    if (slices <= 1) {
+        if (blocks > 0) des_cbc_decrypt_slice(data, blocks, cipher, iv);
+    } else {
+        // Save every slice's chaining block before any thread overwrites it
+        uint8_t previous[DES_MAX_THREADS][8];
+        memcpy(previous[0], iv, 8);
+        for (size_t slice = 1; slice < slices; slice++) {
+            size_t begin = blocks * slice / slices;
+            memcpy(previous[slice], data + 8 * (begin - 1), 8);
         }
 
-        memcpy(previous_block, current_block, 8);
-        free(current_block); // Free dynamically allocated memory
+        DES_CbcDecryptJob job = {data, blocks, slices, cipher, previous};
+        des_parallel_for(slices, des_cbc_decrypt_task, &job);
     }
+    DES_PROFILE_END(DES_STAGE_CBC_DECRYPT);
+}
+
+void des_cbc_decrypt_with_keys(uint8_t *data, size_t length, const DES_RoundKeys *round_keys, const uint8_t iv[8]) {
+    DES_BlockCipher cipher = {round_keys, NULL};
+    des_cbc_decrypt_cipher(data, length, &cipher, iv);
+}
+
+// Multi-stream CBC encryption: one kernel lane per stream, all lanes advanced together
+typedef struct {
+    DES_CbcStream *streams;
+    size_t count;
+    size_t groups;
+} DES_CbcStreamsJob;
+
+static void des_cbc_encrypt_stream_range(DES_CbcStream *streams, size_t count) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    if (!ops || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            des_cbc_encrypt_with_keys(streams[i].data, streams[i].length, streams[i].round_keys, streams[i].iv);
+        }
+        return;
+    }
+
+    _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+    uint64_t values[DES_KERNEL_MAX_LANES], chain[DES_KERNEL_MAX_LANES];
+    long lane_stream[DES_KERNEL_MAX_LANES];
+    size_t lane_offset[DES_KERNEL_MAX_LANES];
+    int lanes = ops->lanes;
+    int active = 0;
+    size_t next = 0;
 
-    free(previous_block); // Free dynamically allocated memory
-}
\ No newline at end of file
+    for (int lane = 0; lane < lanes; lane++) {
+        lane_stream[lane] = -1;
+    }
+    ops->broadcast(key_slices, 0);
+
+    for (;;) {
+        // Refill idle lanes with the next non-empty streams
+        for (int lane = 0; lane < lanes && next < count; lane++) {
+            if (lane_stream[lane] >= 0) continue;
+            while (next < count && streams[next].length < 8) next++;
+            if (next == count) break;
+            lane_stream[lane] = (long)next;
+            lane_offset[lane] = 0;
+            chain[lane] = des_be_bytes_to_uint64(streams[next].iv);
+            des_kernel_set_lane(ops, key_slices, lane, streams[next].round_keys->key);
+            active++;
+            next++;
+        }
+        if (active == 0) break;
+
+        // A nearly empty pass costs as much as a full one; finish stragglers on the scalar path
+        if (next == count && active * 8 <= lanes) {
+            for (int lane = 0; lane < lanes; lane++) {
+                if (lane_stream[lane] < 0) continue;
+                DES_CbcStream *stream = &streams[lane_stream[lane]];
+                uint8_t iv[8];
+                des_uint64_to_be_bytes(chain[lane], iv);
+                des_cbc_encrypt_with_keys(stream->data + lane_offset[lane], stream->length - lane_offset[lane],
+                                          stream->round_keys, iv);
+            }
+            break;
+        }
+
+        for (int lane = 0; lane < lanes; lane++) {
+            values[lane] = lane_stream[lane] < 0 ? 0 :
+                des_be_bytes_to_uint64(streams[lane_stream[lane]].data + lane_offset[lane]) ^ chain[lane];
+        }
+        ops->load(slices, values);
+        ops->crypt(slices, key_slices, DES_ENCRYPT);
+        ops->store(slices, values);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            if (lane_stream[lane] < 0) continue;
+            DES_CbcStream *stream = &streams[lane_stream[lane]];
+            des_uint64_to_be_bytes(values[lane], stream->data + lane_offset[lane]);
+            chain[lane] = values[lane];
+            lane_offset[lane] += 8;
+            if (lane_offset[lane] + 8 > stream->length) {
+                lane_stream[lane] = -1;
+                active--;
+            }
+        }
+    }
+}
+
+static void des_cbc_encrypt_streams_task(void *arg, size_t group) {
+    DES_CbcStreamsJob *job = (DES_CbcStreamsJob *)arg;
+    size_t begin = job->count * group / job->groups;
+    size_t end = job->count * (group + 1) / job->groups;
+    des_cbc_encrypt_stream_range(job->streams + begin, end - begin);
+}
+
+void des_cbc_encrypt_streams(DES_CbcStream *streams, size_t count) {
+    // Give each thread enough streams to keep its lanes busy
+    int lanes = des_kernel_lanes(des_get_kernel());
+    size_t groups = count / (size_t)(2 * lanes);
+    size_t threads = (size_t)des_get_threads();
+    if (groups > threads) groups = threads;
+    if (groups < 1) groups = 1;
+
+    DES_CbcStreamsJob job = {streams, count, groups};
+    DES_PROFILE_BEGIN(DES_STAGE_CBC_STREAMS);
+    des_parallel_for(groups, des_cbc_encrypt_streams_task, &job);
+    DES_PROFILE_END(DES_STAGE_CBC_STREAMS);
+}
+
+// CTR Mode
+#define DES_CTR_BATCH_BLOCKS 512
+
+static void des_ctr_xcrypt_range(uint8_t *data, size_t length, const DES_BlockCipher *cipher,
+                                 uint64_t counter, uint64_t offset) {
+    uint8_t keystream[DES_CTR_BATCH_BLOCKS * 8];
+    uint64_t block = offset / 8;
+    size_t skip = (size_t)(offset % 8);  // Keystream bytes to drop in the first block
+
+    while (length > 0) {
+        size_t needed = (skip + length + 7) / 8;
+        size_t count = needed < DES_CTR_BATCH_BLOCKS ? needed : DES_CTR_BATCH_BLOCKS;
+        for (size_t i = 0; i < count; i++) {
+            des_uint64_to_be_bytes(counter + block + i, keystream + 8 * i);
+        }
+        des_cipher_blocks(cipher, keystream, keystream, count, DES_ENCRYPT);
+
+        size_t available = count * 8 - skip;
+        size_t chunk = length < available ? length : available;
+        for (size_t i = 0; i < chunk; i++) {
+            data[i] ^= keystream[skip + i];
+        }
+        data += chunk;
+        length -= chunk;
+        block += count;
+        skip = 0;
+    }
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    size_t slices;
+    const DES_BlockCipher *cipher;
+    uint64_t counter;
+    uint64_t offset;
+} DES_CtrJob;
+
+static void des_ctr_task(void *arg, size_t slice) {
+    DES_CtrJob *job = (DES_CtrJob *)arg;
+    // Slice boundaries fall on whole keystream blocks
+    size_t blocks = job->length / 8;
+    size_t begin = slice == 0 ? 0 : 8 * (blocks * slice / job->slices);
+    size_t end = slice + 1 == job->slices ? job->length : 8 * (blocks * (slice + 1) / job->slices);
+    des_ctr_xcrypt_range(job->data + begin, end - begin, job->cipher, job->counter, job->offset + begin);
+}
+
+static void des_ctr_xcrypt_cipher(uint8_t *data, size_t length, const DES_BlockCipher *cipher,
+                                  const uint8_t counter[8], uint64_t offset) {
+    size_t slices = length / DES_PARALLEL_MIN_BYTES;
+    size_t threads = (size_t)des_get_threads();
+    if (slices > threads) slices = threads;
+    if (slices < 1) slices = 1;
+
+    DES_CtrJob job = {data, length, slices, cipher, des_be_bytes_to_uint64(counter), offset};
+    DES_PROFILE_BEGIN(DES_STAGE_CTR);
+    des_parallel_for(slices, des_ctr_task, &job);
+    DES_PROFILE_END(DES_STAGE_CTR);
+}
+
+void des_ctr_xcrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys,
+                    const uint8_t counter[8], uint64_t offset) {
+    DES_BlockCipher cipher = {round_keys, NULL};
+    des_ctr_xcrypt_cipher(data, length, &cipher, counter, offset);
+}
+
+// Triple-DES chaining modes share the code above
+void des3_cbc_encrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys, const uint8_t iv[8]) {
+    DES_BlockCipher cipher = {NULL, round_keys};
+    des_cbc_encrypt_cipher(data, length, &cipher, iv);
+}
+
+void des3_cbc_decrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys, const uint8_t iv[8]) {
+    DES_BlockCipher cipher = {NULL, round_keys};
+    des_cbc_decrypt_cipher(data, length, &cipher, iv);
+}
+
+void des3_ctr_xcrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys,
+                     const uint8_t counter[8], uint64_t offset) {
+    DES_BlockCipher cipher = {NULL, round_keys};
+    des_ctr_xcrypt_cipher(data, length, &cipher, counter, offset);
+}
+
+// Incremental CBC
+void des_cbc_init(DES_CbcContext *ctx, const DES_RoundKeys *round_keys, const uint8_t iv[8], int mode) {
+    ctx->round_keys = round_keys;
+    ctx->round_keys3 = NULL;
+    memcpy(ctx->chain, iv, 8);
+    ctx->buffered = 0;
+    ctx->mode = mode;
+}
+
+void des3_cbc_init(DES_CbcContext *ctx, const DES3_RoundKeys *round_keys, const uint8_t iv[8], int mode) {
+    ctx->round_keys = NULL;
+    ctx->round_keys3 = round_keys;
+    memcpy(ctx->chain, iv, 8);
+    ctx->buffered = 0;
+    ctx->mode = mode;
+}
+
+// Decrypts one ciphertext block into output and advances the chain
+static void des_cbc_decrypt_one(DES_CbcContext *ctx, const DES_BlockCipher *cipher,
+                                const uint8_t block[8], uint8_t *output) {
+    uint8_t plain[8];
+    des_cipher_blocks(cipher, block, plain, 1, DES_DECRYPT);
+    for (int j = 0; j < 8; j++) {
+        output[j] = plain[j] ^ ctx->chain[j];
+    }
+    memcpy(ctx->chain, block, 8);
+}
+
+size_t des_cbc_update(DES_CbcContext *ctx, const uint8_t *input, size_t length, uint8_t *output) {
+    DES_BlockCipher cipher = {ctx->round_keys, ctx->round_keys3};
+    size_t written = 0;
+
+    // Decryption keeps the last block back until final, as it may hold the padding
+    size_t keep = ctx->mode == DES_DECRYPT ? 1 : 0;
+    if (ctx->buffered + length < 8 + keep) {
+        memcpy(ctx->buffer + ctx->buffered, input, length);
+        ctx->buffered += length;
+        return 0;
+    }
+
+    DES_PROFILE_BEGIN(DES_STAGE_CBC_UPDATE);
+
+    // Complete the carried block
+    if (ctx->buffered > 0) {
+        size_t take = 8 - ctx->buffered;
+        memcpy(ctx->buffer + ctx->buffered, input, take);
+        input += take;
+        length -= take;
+        if (ctx->mode == DES_ENCRYPT) {
+            des_cbc_encrypt_blocks(&cipher, ctx->chain, ctx->buffer, output, 1);
+        } else {
+            des_cbc_decrypt_one(ctx, &cipher, ctx->buffer, output);
+        }
+        written = 8;
+    }
+
+    size_t blocks = length >= keep ? (length - keep) / 8 : 0;
+    if (blocks > 0) {
+        if (ctx->mode == DES_ENCRYPT) {
+            des_cbc_encrypt_blocks(&cipher, ctx->chain, input, output + written, blocks);
+        } else {
+            // Batched (and for large updates threaded) decryption in the output buffer
+            memcpy(output + written, input, 8 * blocks);
+            des_cbc_decrypt_cipher(output + written, 8 * blocks, &cipher, ctx->chain);
+            memcpy(ctx->chain, input + 8 * (blocks - 1), 8);
+        }
+        written += 8 * blocks;
+    }
+
+    ctx->buffered = length - 8 * blocks;
+    memcpy(ctx->buffer, input + 8 * blocks, ctx->buffered);
+    DES_PROFILE_END(DES_STAGE_CBC_UPDATE);
+    return written;
+}
+
+int des_cbc_final(DES_CbcContext *ctx, uint8_t *output, size_t *written) {
+    DES_BlockCipher cipher = {ctx->round_keys, ctx->round_keys3};
+    uint8_t plain[8];
+
+    *written = 0;
+    if (ctx->mode == DES_ENCRYPT) {
+        // PKCS#7: 1-8 bytes, each holding the pad length
+        memset(ctx->buffer + ctx->buffered, (int)(8 - ctx->buffered), 8 - ctx->buffered);
+        DES_PROFILE_BEGIN(DES_STAGE_CBC_UPDATE);
+        des_cbc_encrypt_blocks(&cipher, ctx->chain, ctx->buffer, output, 1);
+        DES_PROFILE_END(DES_STAGE_CBC_UPDATE);
+        ctx->buffered = 0;
+        *written = 8;
+        return 0;
+    }
+
+    if (ctx->buffered != 8) return -1;
+    DES_PROFILE_BEGIN(DES_STAGE_CBC_UPDATE);
+    des_cbc_decrypt_one(ctx, &cipher, ctx->buffer, plain);
+    DES_PROFILE_END(DES_STAGE_CBC_UPDATE);
+    ctx->buffered = 0;
+    int pad = plain[7];
+    if (pad < 1 || pad > 8) return -1;
+    for (int i = 8 - pad; i < 8; i++) {
+        if (plain[i] != pad) return -1;
+    }
+    memcpy(output, plain, (size_t)(8 - pad));
+    *written = (size_t)(8 - pad);
+    return 0;
+}
+
+void des_cbc_encrypt(uint8_t *data, size_t length, uint64_t key, const uint8_t iv[8]) {
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    des_cbc_encrypt_with_keys(data, length, &round_keys, iv);
+}
+
+void des_cbc_decrypt(uint8_t *data, size_t length, uint64_t key, const uint8_t iv[8]) {
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    des_cbc_decrypt_with_keys(data, length, &round_keys, iv);
+}
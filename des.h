@@ -2,6 +2,7 @@
 #define DES_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 // DES Block and Key Sizes
@@ -12,17 +13,56 @@
 #define DES_ENCRYPT 1
 #define DES_DECRYPT 0
 
-// Structure for DES round keys (each subkey is 48 bits)
+// Structure for DES round keys (each subkey is 48 bits). The scalar paths read the
+// subkeys; the bitsliced kernels expand `key` themselves, so a context must come from
+// des_key_setup (or keep `key` in step with the subkeys) to give the same results on
+// every kernel.
 typedef struct {
     uint64_t subkeys[16];  // 16 subkeys, each derived from the main key
+    uint64_t key;          // Key the subkeys were expanded from (read by the bitsliced kernels)
 } DES_RoundKeys;
 
+// Byte-indexed lookup form of a permutation table: lut[c][v] holds the output bits
+// contributed by input byte c (counted from the least significant byte) having value v.
+typedef struct {
+    int input_bytes;        // Number of input bytes that contribute to the output
+    uint64_t lut[8][256];
+} DES_PermutationLUT;
+
+// ================================
+//      Permutation Engine
+// ================================
+
+/**
+ * @brief Builds the lookup form of a permutation table.
+ * @param lut Pointer to the lookup table to fill.
+ * @param table Permutation table (1-based bit positions, counted from the input's MSB).
+ * @param n Number of elements in the table (output width in bits).
+ * @param input_bits Width of the right-aligned input value in bits (at most 64).
+ */
+void des_permutation_lut_init(DES_PermutationLUT *lut, const uint8_t *table, int n, int input_bits);
+
+/**
+ * @brief Applies a permutation through its lookup form (one lookup per input byte).
+ * @param lut Lookup table built by des_permutation_lut_init.
+ * @param input Right-aligned input value.
+ * @return Permuted value, right-aligned.
+ */
+uint64_t des_permutation_lut_apply(const DES_PermutationLUT *lut, uint64_t input);
+
+/**
+ * @brief Builds the internal lookup tables. Runs automatically at startup with GCC/Clang
+ *        and on first key setup otherwise; safe to call more than once, from any thread.
+ */
+void des_init_tables(void);
+
 // ================================
 //      Key Schedule Functions
 // ================================
 
 /**
- * @brief Applies a permutation table to an input value.
+ * @brief Applies a permutation table to an input value one bit at a time (reference
+ *        implementation; positions are counted from bit 63 of the input).
  * @param output Pointer to store the result.
  * @param input Input value to permute.
  * @param table Permutation table.
@@ -38,13 +78,36 @@ void des_apply_permutation(uint64_t *output, uint64_t input, const uint8_t *tabl
 void des_generate_round_keys(uint64_t key, uint64_t *round_keys);
 
 /**
- * @brief Feistel function (expands and substitutes the right half of the block).
+ * @brief Feistel function: E expansion, key mixing, S-box substitution and the P
+ *        permutation, computed bit at a time (reference for the SP-table round).
  * @param right 32-bit right half of the data.
  * @param subkey 48-bit round subkey.
  * @param output Pointer to store the result.
  */
 void des_feistel_function(uint32_t right, uint64_t subkey, uint32_t *output);
 
+// ================================
+//      S-Box Analysis
+// ================================
+
+/**
+ * @brief Difference distribution table of one S-box, computed from DES_SBOXES (inputs
+ *        are 6-bit groups as the Feistel function sees them, outer bits selecting the row).
+ * @param box S-box index, 0 for DES_SBOX1 to 7 for DES_SBOX8.
+ * @param ddt Receives, for input difference a and output difference b, the number of
+ *        inputs x with S(x) ^ S(x ^ a) = b (each row sums to 64).
+ */
+void des_sbox_ddt(int box, uint32_t ddt[64][16]);
+
+/**
+ * @brief Linear approximation table of one S-box, computed from DES_SBOXES (same input
+ *        convention as des_sbox_ddt; a mask bit selects the matching value bit).
+ * @param box S-box index, 0 for DES_SBOX1 to 7 for DES_SBOX8.
+ * @param lat Receives, for input mask a and output mask b, the number of inputs x with
+ *        parity(x & a) = parity(S(x) & b) minus 32 (Matsui's NS(a, b) - 32).
+ */
+void des_sbox_lat(int box, int32_t lat[64][16]);
+
 // ================================
 //      Block Encryption/Decryption
 // ================================
@@ -65,6 +128,451 @@ void des_encrypt_block(const uint8_t *input, uint8_t *output, uint64_t key);
  */
 void des_decrypt_block(const uint8_t *input, uint8_t *output, uint64_t key);
 
+// ================================
+//      Prepared Key Context
+// ================================
+
+/**
+ * @brief Expands a key into a round-key context that can be reused for any number of blocks.
+ * @param key 64-bit key.
+ * @param round_keys Pointer to the context to fill.
+ */
+void des_key_setup(uint64_t key, DES_RoundKeys *round_keys);
+
+/**
+ * @brief Encrypts a single 64-bit block with a prepared key context (no allocation).
+ * @param input Pointer to 8-byte plaintext block.
+ * @param output Pointer to store 8-byte ciphertext block (may alias input).
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_encrypt_block_with_keys(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Decrypts a single 64-bit block with a prepared key context (no allocation).
+ * @param input Pointer to 8-byte ciphertext block.
+ * @param output Pointer to store 8-byte plaintext block (may alias input).
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_decrypt_block_with_keys(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Encrypts data in place using DES in ECB mode (runs on the active bulk kernel).
+ * @param data Pointer to the data buffer.
+ * @param length Data length (should be a multiple of 8).
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_ecb_encrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Decrypts data in place using DES in ECB mode (runs on the active bulk kernel).
+ * @param data Pointer to the data buffer.
+ * @param length Data length (should be a multiple of 8).
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_ecb_decrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys);
+
+// ================================
+//      Key-Schedule Cache (des_keycache.c)
+// ================================
+
+// Thread-safe cache of expanded keys for workloads where the same keys recur (one key
+// per tenant, say). Bounded, least recently used eviction; see des_keycache.c.
+typedef struct DES_KeyCache DES_KeyCache;
+
+typedef struct {
+    uint64_t hits;          // Lookups served from the cache
+    uint64_t misses;        // Lookups that expanded the key
+    uint64_t evictions;     // Entries replaced to make room
+    uint64_t entries;       // Entries in use
+    uint64_t capacity;      // Entries the cache holds
+} DES_KeyCacheStats;
+
+/**
+ * @brief Creates an empty key-schedule cache.
+ * @param capacity Number of keys to hold (rounded up to a power of two, at least 8).
+ * @return The cache, or NULL when out of memory.
+ */
+DES_KeyCache *des_key_cache_create(size_t capacity);
+
+/**
+ * @brief Frees a cache; no other thread may be using it.
+ */
+void des_key_cache_destroy(DES_KeyCache *cache);
+
+/**
+ * @brief Cached form of des_key_setup: fills the context from the cache, expanding and
+ *        inserting the key on a miss. Safe to call from any number of threads; the result
+ *        is the caller's copy and works with every call taking a DES_RoundKeys context.
+ * @param cache Cache from des_key_cache_create.
+ * @param key 64-bit key (keys differing only in parity bits share an entry).
+ * @param round_keys Pointer to the context to fill.
+ */
+void des_key_cache_setup(DES_KeyCache *cache, uint64_t key, DES_RoundKeys *round_keys);
+
+/**
+ * @brief Reads the hit, miss and eviction counters (totals since creation).
+ * @param cache Cache from des_key_cache_create.
+ * @param stats Receives the counters.
+ */
+void des_key_cache_stats(DES_KeyCache *cache, DES_KeyCacheStats *stats);
+
+// ================================
+//      Key-Agile Batches
+// ================================
+
+// One block under each of many keys (key check values, key-derivation checks, candidate
+// verification). Whole kernel passes put one key per lane; the bitsliced key schedule is
+// pure wiring, so key setup costs nothing beyond transposing the keys.
+
+/**
+ * @brief Encrypts block i under keys[i] for every i (large batches use the thread pool).
+ * @param keys count 64-bit keys.
+ * @param input Pointer to count * 8 bytes.
+ * @param output Pointer to store count * 8 bytes (may alias input).
+ * @param count Number of key/block pairs.
+ */
+void des_encrypt_blocks_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output, size_t count);
+
+/**
+ * @brief Decrypts block i under keys[i] for every i (large batches use the thread pool).
+ * @param keys count 64-bit keys.
+ * @param input Pointer to count * 8 bytes.
+ * @param output Pointer to store count * 8 bytes (may alias input).
+ * @param count Number of key/block pairs.
+ */
+void des_decrypt_blocks_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output, size_t count);
+
+// ================================
+//      Key Enumeration
+// ================================
+
+// Walks an aligned block of the 56-bit key space in Gray-code order. Each step flips
+// one key bit, and the round keys are patched with that bit's precomputed subkey mask
+// instead of being rebuilt through PC-1/PC-2.
+typedef struct {
+    uint64_t index;           // 56-bit key index of the current key
+    uint64_t key;             // Current key, with odd parity
+    uint64_t step;            // Position in the walk
+    uint64_t count;           // Keys in the walk
+    DES_RoundKeys round_keys; // Round keys of the current key
+} DES_KeyEnumerator;
+
+/**
+ * @brief Expands a 56-bit key index into a 64-bit key (seven bits per byte, odd parity).
+ * @param index Key index; bit 0 is the lowest effective bit of the last key byte.
+ * @return The key.
+ */
+uint64_t des_key_from_index(uint64_t index);
+
+/**
+ * @brief Extracts the 56-bit key index of a key (parity bits are dropped).
+ * @param key 64-bit key.
+ * @return The key index.
+ */
+uint64_t des_key_to_index(uint64_t key);
+
+/**
+ * @brief Starts a walk over the 2^bits key indices sharing the upper bits of base_index.
+ * @param enumerator Pointer to the enumerator to initialize.
+ * @param base_index First key index, a multiple of 2^bits.
+ * @param bits Number of free low index bits (1 to 56).
+ */
+void des_key_enum_init(DES_KeyEnumerator *enumerator, uint64_t base_index, int bits);
+
+/**
+ * @brief Advances to the next key, patching its round keys in place.
+ * @param enumerator Pointer to the enumerator.
+ * @return 1 if a new key is current, 0 once the walk is exhausted.
+ */
+int des_key_enum_next(DES_KeyEnumerator *enumerator);
+
+// ================================
+//      Key Testing
+// ================================
+
+#define DES_KEY_TEST_MAX_PAIRS 8
+
+// Known plaintext/ciphertext pairs prepared for key search. A candidate encrypts the
+// first plaintext for 14 rounds; round 15 is then built one S-box at a time and the
+// key is dropped as soon as four bits of R15 disagree with L16 of the known ciphertext
+// (15 in 16 keys go after the first S-box). Survivors are checked against every pair.
+// If a pair holds the complement of the first plaintext, each trial also tests the
+// complemented key, since E_~k(~P) = ~E_k(P). The AVX2 and AVX-512 kernels skip the
+// filter and encrypt all 16 rounds: with every lane of a wide word needing to die before
+// the pass can end, the filter measured about 0.9x a full encryption there.
+typedef struct {
+    uint8_t plaintext[8];        // Block every candidate encrypts (first pair)
+    uint32_t left, right;        // Its IP halves
+    uint32_t targets[2];         // L16 required of the key and of its complement
+    int target_count;            // 2 when complemented keys are tested too
+    size_t pair_count;
+    uint64_t plaintexts[DES_KEY_TEST_MAX_PAIRS];
+    uint64_t ciphertexts[DES_KEY_TEST_MAX_PAIRS];
+} DES_KeyTest;
+
+/**
+ * @brief Prepares known plaintext/ciphertext pairs for key testing.
+ * @param test Pointer to the context to fill.
+ * @param plaintexts count consecutive 8-byte plaintext blocks.
+ * @param ciphertexts count consecutive 8-byte ciphertext blocks.
+ * @param count Number of pairs (1 to DES_KEY_TEST_MAX_PAIRS).
+ * @return 0 on success, -1 if count is out of range.
+ */
+int des_key_test_init(DES_KeyTest *test, const uint8_t *plaintexts, const uint8_t *ciphertexts,
+                      size_t count);
+
+/**
+ * @brief Tests one expanded key with early reject (scalar path).
+ * @param test Prepared pairs.
+ * @param round_keys Candidate key context.
+ * @return Bit 0 set if the key satisfies every pair, bit 1 if its complement does.
+ */
+int des_key_test_schedule(const DES_KeyTest *test, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Tests a batch of keys (and their complements) on the active bulk kernel.
+ * @param test Prepared pairs.
+ * @param keys Candidate keys.
+ * @param count Number of keys.
+ * @param found Receives the keys that satisfy every pair.
+ * @param max_found Capacity of found.
+ * @return Number of keys found (may exceed max_found; only max_found are stored).
+ */
+size_t des_key_test_batch(const DES_KeyTest *test, const uint64_t *keys, size_t count,
+                          uint64_t *found, size_t max_found);
+
+// ================================
+//      Bitsliced Engine (des_bitslice.c)
+// ================================
+
+// Blocks (or keys) processed per bitsliced pass
+#define DES_BITSLICE_LANES 64
+
+/**
+ * @brief Encrypts blocks in ECB mode with the 64-lane bitsliced engine.
+ * @param input Pointer to blocks * 8 bytes of plaintext.
+ * @param output Pointer to store the ciphertext (may alias input).
+ * @param blocks Number of 8-byte blocks (any count; a partial pass is padded internally).
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_bitslice_encrypt(const uint8_t *input, uint8_t *output, size_t blocks, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Decrypts blocks in ECB mode with the 64-lane bitsliced engine.
+ * @param input Pointer to blocks * 8 bytes of ciphertext.
+ * @param output Pointer to store the plaintext (may alias input).
+ * @param blocks Number of 8-byte blocks.
+ * @param round_keys Context filled by des_key_setup.
+ */
+void des_bitslice_decrypt(const uint8_t *input, uint8_t *output, size_t blocks, const DES_RoundKeys *round_keys);
+
+/**
+ * @brief Trials 64 keys against one known plaintext/ciphertext pair in a single pass.
+ * @param keys 64 candidate keys.
+ * @param plaintext 8-byte known plaintext.
+ * @param ciphertext 8-byte known ciphertext.
+ * @return Mask with bit i set when keys[i] encrypts plaintext to ciphertext.
+ */
+uint64_t des_bitslice_key_search(const uint64_t keys[DES_BITSLICE_LANES], const uint8_t plaintext[8],
+                                 const uint8_t ciphertext[8]);
+
+/**
+ * @brief Converts 64 big-endian blocks to bitsliced form: slice k holds DES bit k + 1
+ *        (MSB first) of every block, block i in bit i.
+ * @param blocks Pointer to 64 * 8 bytes.
+ * @param slices Pointer to store 64 slice words.
+ */
+void des_bitslice_transpose_in(const uint8_t *blocks, uint64_t slices[64]);
+
+/**
+ * @brief Converts 64 slice words back to 64 big-endian blocks.
+ * @param slices 64 slice words.
+ * @param blocks Pointer to store 64 * 8 bytes.
+ */
+void des_bitslice_transpose_out(const uint64_t slices[64], uint8_t *blocks);
+
+/**
+ * @brief Runs the 16 rounds on bitsliced data in place; each lane may use its own key.
+ * @param slices 64 data slice words.
+ * @param key_slices 64 key slice words in the same layout (the output of
+ *        des_bitslice_transpose_in applied to 64 keys).
+ * @param mode DES_ENCRYPT or DES_DECRYPT.
+ */
+void des_bitslice_crypt(uint64_t slices[64], const uint64_t key_slices[64], int mode);
+
+// ================================
+//      Bulk Kernel Dispatch (des_simd.c)
+// ================================
+
+// Kernels behind the bulk paths (ECB and the parallel modes). The widest one the CPU
+// supports is picked at startup; DES_KERNEL=scalar|bitslice64|sse2|avx2|avx512 in the
+// environment forces one for testing.
+typedef enum {
+    DES_KERNEL_SCALAR,      // SP-table rounds, one block at a time
+    DES_KERNEL_BITSLICE64,  // 64 lanes in uint64_t
+    DES_KERNEL_SSE2,        // 128 lanes
+    DES_KERNEL_AVX2,        // 256 lanes
+    DES_KERNEL_AVX512,      // 512 lanes
+    DES_KERNEL_COUNT
+} DES_Kernel;
+
+/**
+ * @brief Returns the kernel currently used by the bulk paths.
+ */
+DES_Kernel des_get_kernel(void);
+
+/**
+ * @brief Selects the kernel used by the bulk paths.
+ * @param kernel Kernel to use.
+ * @return 0 on success, -1 if the CPU (or this build) does not support it.
+ */
+int des_set_kernel(DES_Kernel kernel);
+
+/**
+ * @brief Reports whether a kernel can run on this CPU.
+ * @return 1 if supported, 0 otherwise.
+ */
+int des_kernel_supported(DES_Kernel kernel);
+
+/**
+ * @brief Returns the kernel's name as accepted by the DES_KERNEL variable.
+ */
+const char *des_kernel_name(DES_Kernel kernel);
+
+/**
+ * @brief Returns the number of blocks a kernel processes per pass (1 for scalar).
+ */
+int des_kernel_lanes(DES_Kernel kernel);
+
+/**
+ * @brief Trials a batch of keys against one known plaintext/ciphertext pair on the
+ *        active bulk kernel (one key per lane; the key schedule is pure wiring).
+ * @param keys Candidate keys.
+ * @param count Number of keys (any count; whole kernel passes are fastest).
+ * @param plaintext 8-byte known plaintext.
+ * @param ciphertext 8-byte known ciphertext.
+ * @param matches Pointer to (count + 63) / 64 words; bit i % 64 of word i / 64 is set
+ *        when keys[i] encrypts plaintext to ciphertext.
+ */
+void des_key_trial(const uint64_t *keys, size_t count, const uint8_t plaintext[8],
+                   const uint8_t ciphertext[8], uint64_t *matches);
+
+// ================================
+//      Reduced-Round Encryption (des.c)
+// ================================
+
+// DES cut to its first r rounds: IP, rounds 1..r, then the swap and FP exactly as after
+// round 16, so r = 16 is ordinary DES. State r is L_r << 32 | R_r (state 0 = IP(input)).
+
+/**
+ * @brief Encrypts one block with the first `rounds` rounds. Each round count has its own
+ *        compiled routine; the normal 16-round paths do not go through it.
+ * @param input Pointer to 8-byte plaintext block.
+ * @param output Pointer to store 8-byte output block.
+ * @param round_keys Context filled by des_key_setup.
+ * @param rounds Number of rounds (1 to 16).
+ * @param states NULL, or rounds + 1 values receiving every intermediate state.
+ * @return 0 on success, -1 if rounds is out of range.
+ */
+int des_encrypt_block_rounds(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys,
+                             int rounds, uint64_t *states);
+
+/**
+ * @brief Reduced-round ECB encryption in place: whole kernel passes on the active bulk
+ *        kernel, the rest block by block. Single-threaded, like des_ecb_encrypt.
+ * @param data Pointer to the data buffer.
+ * @param length Data length (should be a multiple of 8).
+ * @param round_keys Context filled by des_key_setup.
+ * @param rounds Number of rounds (1 to 16).
+ * @param states NULL, or (length / 8) * (rounds + 1) values: block b's state r goes to
+ *        states[b * (rounds + 1) + r]. Tapping costs one extra transpose per state.
+ * @return 0 on success, -1 if rounds is out of range.
+ */
+int des_ecb_encrypt_rounds(uint8_t *data, size_t length, const DES_RoundKeys *round_keys,
+                           int rounds, uint64_t *states);
+
+// ================================
+//      Avalanche Statistics (des_simd.c)
+// ================================
+
+// Inputs flipped by des_avalanche_accumulate
+#define DES_AVALANCHE_PLAINTEXT 0   // The 64 plaintext bits
+#define DES_AVALANCHE_KEY 1         // The 56 effective key bits (parity bits skipped)
+
+// Difference counts for the strict avalanche criterion (SAC) and bit independence
+// criterion (BIC). Bit 0 is the first DES bit, i.e. the MSB of the block or key; key
+// rows count effective bits only, so row 7 is key bit 8 (0-based), skipping parity bit 7.
+typedef struct {
+    uint64_t samples;             // Random inputs accumulated
+    uint64_t flips[64][64];       // [input bit][output bit]: times the output bit changed
+    uint64_t pairs[64][64][64];   // [input bit][j][k], j < k: times outputs j and k both changed
+} DES_AvalancheCounts;
+
+/**
+ * @brief Encrypts each (plaintext, key) sample and every one-bit variant of it on the
+ *        active bulk kernel, adding the ciphertext differences to counts. Flips are slice
+ *        complements and differences are popcounts of slice XORs, so nothing is transposed
+ *        except the samples themselves.
+ * @param plaintexts Host-order plaintext of each sample.
+ * @param keys Host-order key of each sample.
+ * @param count Number of samples (any count; whole kernel passes are fastest).
+ * @param target DES_AVALANCHE_PLAINTEXT or DES_AVALANCHE_KEY.
+ * @param bic Nonzero to also count output pairs (counts->pairs).
+ * @param counts Accumulator (zero it before the first call).
+ */
+void des_avalanche_accumulate(const uint64_t *plaintexts, const uint64_t *keys, size_t count,
+                              int target, int bic, DES_AvalancheCounts *counts);
+
+/**
+ * @brief des_avalanche_accumulate on DES reduced to its first `rounds` rounds (1 to 16,
+ *        see des_ecb_encrypt_rounds).
+ */
+void des_avalanche_accumulate_rounds(const uint64_t *plaintexts, const uint64_t *keys, size_t count,
+                                     int target, int rounds, int bic, DES_AvalancheCounts *counts);
+
+// ================================
+//      Bit Correlation Counts (des_simd.c)
+// ================================
+
+// Exact co-occurrence counts between the bits of paired 64-bit words (a plaintext and
+// its ciphertext, two adjacent ciphertext blocks, ...). Bit 0 is the MSB. Counts from
+// several threads merge by plain addition.
+typedef struct {
+    uint64_t samples;             // Word pairs accumulated
+    uint64_t ones_a[64];          // Times bit i of a was set
+    uint64_t ones_b[64];          // Times bit j of b was set
+    uint64_t both[64][64];        // [bit of a][bit of b]: times both were set
+} DES_CorrelationCounts;
+
+/**
+ * @brief Adds word pairs to co-occurrence counts. Words are transposed 64 at a time and
+ *        every bit pair is counted with one AND and popcount per 64 pairs (POPCNT where
+ *        the CPU has it, VPOPCNTQ when the active kernel is avx512 and supports it).
+ * @param a First word of each pair (host order, e.g. des_be_bytes_to_uint64 of a block).
+ * @param b Second word of each pair.
+ * @param count Number of pairs.
+ * @param counts Accumulator (zero it before the first call).
+ */
+void des_correlation_accumulate(const uint64_t *a, const uint64_t *b, size_t count,
+                                DES_CorrelationCounts *counts);
+
+// ================================
+//      Threading (des_threads.c)
+// ================================
+
+/**
+ * @brief Sets how many threads the parallel paths (e.g. CBC decryption) may use.
+ * @param threads Thread count including the caller; 0 restores the default (the
+ *        DES_THREADS environment variable, or the number of online CPUs). Counts are
+ *        capped at 256.
+ */
+void des_set_threads(int threads);
+
+/**
+ * @brief Returns the thread count used by the parallel paths (1 to 256).
+ */
+int des_get_threads(void);
+
 // ================================
 //      CBC Mode Encryption/Decryption
 // ================================
@@ -74,18 +582,213 @@ void des_decrypt_block(const uint8_t *input, uint8_t *output, uint64_t key);
  * @param data Pointer to the data buffer (must be a multiple of 8 bytes).
  * @param length Data length (should be a multiple of 8).
  * @param key 64-bit encryption key.
- * @param iv 8-byte initialization vector.
+ * @param iv 8-byte initialization vector (not modified).
  */
-void des_cbc_encrypt(uint8_t *data, size_t length, uint64_t key, uint8_t iv[8]);
+void des_cbc_encrypt(uint8_t *data, size_t length, uint64_t key, const uint8_t iv[8]);
 
 /**
  * @brief Decrypts data using DES in CBC mode.
  * @param data Pointer to the ciphertext buffer.
  * @param length Data length (should be a multiple of 8).
  * @param key 64-bit decryption key.
- * @param iv 8-byte initialization vector.
+ * @param iv 8-byte initialization vector (not modified).
+ */
+void des_cbc_decrypt(uint8_t *data, size_t length, uint64_t key, const uint8_t iv[8]);
+
+/**
+ * @brief Encrypts data in place using DES in CBC mode with a prepared key context.
+ * @param data Pointer to the data buffer (must be a multiple of 8 bytes).
+ * @param length Data length (should be a multiple of 8).
+ * @param round_keys Context filled by des_key_setup.
+ * @param iv 8-byte initialization vector (not modified).
+ */
+void des_cbc_encrypt_with_keys(uint8_t *data, size_t length, const DES_RoundKeys *round_keys, const uint8_t iv[8]);
+
+/**
+ * @brief Decrypts data in place using DES in CBC mode with a prepared key context.
+ *        Blocks are independent here, so large buffers are split across threads and
+ *        each slice runs on the bulk kernel.
+ * @param data Pointer to the ciphertext buffer.
+ * @param length Data length (should be a multiple of 8).
+ * @param round_keys Context filled by des_key_setup.
+ * @param iv 8-byte initialization vector (not modified).
+ */
+void des_cbc_decrypt_with_keys(uint8_t *data, size_t length, const DES_RoundKeys *round_keys, const uint8_t iv[8]);
+
+// One independent CBC message for des_cbc_encrypt_streams
+typedef struct {
+    uint8_t *data;                     // Buffer encrypted in place
+    size_t length;                     // Data length (should be a multiple of 8)
+    const DES_RoundKeys *round_keys;   // Context filled by des_key_setup (may differ per stream)
+    uint8_t iv[8];                     // Initialization vector (not modified)
+} DES_CbcStream;
+
+/**
+ * @brief Encrypts many independent CBC messages at once. Block k of every stream goes
+ *        through the same bulk-kernel pass (one lane per stream, each with its own key);
+ *        a lane whose stream ends is refilled with the next stream. Streams are split
+ *        across threads when there are enough of them.
+ * @param streams Array of streams; output is identical to des_cbc_encrypt_with_keys on each.
+ * @param count Number of streams.
+ */
+void des_cbc_encrypt_streams(DES_CbcStream *streams, size_t count);
+
+// ================================
+//      CTR Mode
+// ================================
+
+/**
+ * @brief Encrypts or decrypts data in place using DES in counter mode. The 8-byte
+ *        counter block is a big-endian 64-bit value (nonce and counter share it, e.g.
+ *        nonce in the high half); keystream block i is E(counter + i mod 2^64).
+ *        Keystream is generated in bulk-kernel batches and large buffers are split
+ *        across threads.
+ * @param data Pointer to the data buffer (any length).
+ * @param length Data length in bytes.
+ * @param round_keys Context filled by des_key_setup.
+ * @param counter Initial 8-byte counter block (not modified).
+ * @param offset Keystream byte offset of data[0], so any byte range of a message can
+ *        be processed on its own (0 for a whole message).
+ */
+void des_ctr_xcrypt(uint8_t *data, size_t length, const DES_RoundKeys *round_keys,
+                    const uint8_t counter[8], uint64_t offset);
+
+// ================================
+//      Triple DES (EDE)
+// ================================
+
+// Expanded 3DES context: C = E_K3(D_K2(E_K1(P))). The 48 subkeys are stored in the
+// order encryption uses them (decryption walks them backwards), so a block runs as one
+// 48-round Feistel network; the FP/IP pairs between the stages cancel and are skipped.
+typedef struct {
+    uint64_t subkeys[48];   // K1 forwards, K2 backwards, K3 forwards
+    uint64_t keys[3];       // K1, K2, K3 (read by the bitsliced kernels)
+} DES3_RoundKeys;
+
+/**
+ * @brief Expands the three 3DES keys once into a reusable context.
+ * @param key1 First key (K1).
+ * @param key2 Second key (K2).
+ * @param key3 Third key (K3); pass key1 again for two-key 3DES.
+ * @param round_keys Pointer to the context to fill.
+ */
+void des3_key_setup(uint64_t key1, uint64_t key2, uint64_t key3, DES3_RoundKeys *round_keys);
+
+/**
+ * @brief Encrypts a single 64-bit block with 3DES.
+ */
+void des3_encrypt_block(const uint8_t *input, uint8_t *output, const DES3_RoundKeys *round_keys);
+
+/**
+ * @brief Decrypts a single 64-bit block with 3DES.
+ */
+void des3_decrypt_block(const uint8_t *input, uint8_t *output, const DES3_RoundKeys *round_keys);
+
+/**
+ * @brief Encrypts data in place using 3DES in ECB mode (runs on the active bulk kernel).
+ * @param data Pointer to data (length must be a multiple of 8).
+ * @param length Data length in bytes.
+ * @param round_keys Context filled by des3_key_setup.
+ */
+void des3_ecb_encrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys);
+
+/**
+ * @brief Decrypts data in place using 3DES in ECB mode (runs on the active bulk kernel).
+ */
+void des3_ecb_decrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys);
+
+/**
+ * @brief Encrypts data in place using 3DES in CBC mode (outer CBC; serial by nature).
+ * @param data Pointer to data (length must be a multiple of 8).
+ * @param length Data length in bytes.
+ * @param round_keys Context filled by des3_key_setup.
+ * @param iv Initialization vector (not modified).
+ */
+void des3_cbc_encrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys, const uint8_t iv[8]);
+
+/**
+ * @brief Decrypts data in place using 3DES in CBC mode (parallel and batched, like
+ *        des_cbc_decrypt_with_keys).
+ */
+void des3_cbc_decrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys, const uint8_t iv[8]);
+
+/**
+ * @brief Encrypts or decrypts data in place using 3DES in CTR mode (see des_ctr_xcrypt).
+ */
+void des3_ctr_xcrypt(uint8_t *data, size_t length, const DES3_RoundKeys *round_keys,
+                     const uint8_t counter[8], uint64_t offset);
+
+// ================================
+//      Incremental CBC
+// ================================
+
+// Streaming CBC state for messages that arrive in pieces: the chaining block and a
+// partial block are carried between updates, and final applies (or on decryption
+// checks and strips) PKCS#7 padding. The context holds no allocations; the key context
+// it points to must stay valid until final. Output matches the one-shot CBC call on the
+// padded message.
+typedef struct {
+    const DES_RoundKeys *round_keys;     // Single DES key, or NULL
+    const DES3_RoundKeys *round_keys3;   // 3DES key, or NULL
+    uint8_t chain[8];                    // IV, then the last ciphertext block
+    uint8_t buffer[8];                   // Input carried to the next call
+    size_t buffered;                     // Bytes in buffer (decryption keeps up to a full block)
+    int mode;                            // DES_ENCRYPT or DES_DECRYPT
+} DES_CbcContext;
+
+/**
+ * @brief Starts a single-DES CBC message.
+ * @param ctx Context to fill.
+ * @param round_keys Context filled by des_key_setup.
+ * @param iv 8-byte initialization vector (copied).
+ * @param mode DES_ENCRYPT or DES_DECRYPT.
+ */
+void des_cbc_init(DES_CbcContext *ctx, const DES_RoundKeys *round_keys, const uint8_t iv[8], int mode);
+
+/**
+ * @brief Starts a 3DES CBC message (see des_cbc_init).
+ */
+void des3_cbc_init(DES_CbcContext *ctx, const DES3_RoundKeys *round_keys, const uint8_t iv[8], int mode);
+
+/**
+ * @brief Processes the next piece of the message, of any length.
+ * @param ctx Context from des_cbc_init or des3_cbc_init.
+ * @param input Next input bytes.
+ * @param length Number of input bytes.
+ * @param output Receives the completed blocks; room for length + 8 bytes, not overlapping input.
+ * @return Number of bytes written to output (a multiple of 8).
+ */
+size_t des_cbc_update(DES_CbcContext *ctx, const uint8_t *input, size_t length, uint8_t *output);
+
+/**
+ * @brief Ends the message: encryption pads and writes the last block, decryption checks
+ *        and strips the padding of the held-back last block.
+ * @param ctx Context from des_cbc_init or des3_cbc_init.
+ * @param output Receives up to 8 bytes.
+ * @param written Receives the number of bytes written.
+ * @return 0 on success, -1 if the ciphertext length or padding is invalid.
+ */
+int des_cbc_final(DES_CbcContext *ctx, uint8_t *output, size_t *written);
+
+// ================================
+//      Profiling (des_profile.c)
+// ================================
+
+// With the library built with -DDES_PROFILE, key schedule, IP, rounds, FP, the mode
+// loops, the bulk kernels and the thread pool record per-stage cycles and (Linux) hardware
+// counters. The profile is printed to stderr at exit (or to the file named by
+// DES_PROFILE_OUT) and after SIGUSR1; DES_PROFILE_COUNTERS=0 skips the counters.
+
+/**
+ * @brief Prints the per-stage profile gathered so far (a note when not compiled in).
+ * @param stream Output stream.
+ */
+void des_profile_report(FILE *stream);
+
+/**
+ * @brief Clears the gathered profile.
  */
-void des_cbc_decrypt(uint8_t *data, size_t length, uint64_t key, uint8_t iv[8]);
+void des_profile_reset(void);
 
 // ================================
 //      Utility Functions
@@ -134,5 +837,6 @@ extern const uint32_t DES_SBOX5[];
 extern const uint32_t DES_SBOX6[];
 extern const uint32_t DES_SBOX7[];
 extern const uint32_t DES_SBOX8[];
+extern const uint32_t *const DES_SBOXES[8];  // DES_SBOX1..8 in order
 
 #endif // DES_H
@@ -1,116 +1,292 @@
+/*
+ * DES Avalanche Analysis
+ * Measures the strict avalanche criterion (SAC) and the bit independence criterion (BIC)
+ * over random inputs. Every sample is a random (plaintext, key) pair; each of the 64
+ * plaintext bits and each of the 56 effective key bits is flipped in turn and the
+ * ciphertext difference is counted per output bit (SAC) and per output bit pair (BIC).
+ * Samples run on the bulk bitsliced kernel, where a flip is a slice complement, and are
+ * spread over worker threads that each keep their own counts.
+ *
+ * Usage: des_avalanche [--samples N] [--target plaintext|key|both] [--no-bic]
+ *                      [--threads N] [--seed N] [--format csv|bin] [--out PREFIX]
+ *
+ * N takes K and M suffixes (default 1M). For each target, PREFIX_<target>_sac.csv holds
+ * the probability that output bit j (column) changes when input bit i (row) is flipped,
+ * and PREFIX_<target>_bic.csv the largest |correlation| between the changes of output
+ * bits j and k over all input bits. Bits use DES numbering (1 = MSB); key rows name the
+ * flipped key bit, so parity bits 8, 16, ... are absent. --format bin writes the same
+ * matrices as <name>.bin: the 8-byte magic "DESSAC1\n" or "DESBIC1\n", uint32 rows,
+ * uint32 columns, uint64 samples, then rows * columns doubles (all in host byte order).
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <math.h>
-#include "des.h" // Include your DES header file
+#include "des.h"
+#include "des_tool.h"
 
-#define BLOCK_SIZE 8  // DES block size in bytes
-#define NUM_ITERATIONS 10  // Number of iterations to run the test
-#define FLIP_BIT 1  // The bit to flip (always bit 1)
+#define CHUNK_SAMPLES 4096  // Samples a worker claims at a time
 
-// Function to count bit differences (Hamming distance) between two byte arrays
-int count_bit_difference(const uint8_t *a, const uint8_t *b, size_t length) {
-    int count = 0;
-    for (size_t i = 0; i < length; i++) {
-        count += __builtin_popcount(a[i] ^ b[i]);
+typedef struct {
+    int target;
+    int bic;
+    uint64_t samples;
+    uint64_t seed;
+    atomic_uint_fast64_t next;  // First sample of the next unclaimed chunk
+} Job;
+
+typedef struct {
+    pthread_t thread;
+    Job *job;
+    DES_AvalancheCounts *counts;
+} Worker;
+
+static void *avalanche_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Job *job = w->job;
+    uint64_t plaintexts[CHUNK_SAMPLES], keys[CHUNK_SAMPLES];
+
+    for (;;) {
+        uint64_t first = atomic_fetch_add(&job->next, CHUNK_SAMPLES);
+        if (first >= job->samples) break;
+        size_t count = job->samples - first < CHUNK_SAMPLES ? (size_t)(job->samples - first) : CHUNK_SAMPLES;
+
+        uint64_t state = job->seed ^ (first * 0xD1B54A32D192ED03ULL);
+        for (size_t i = 0; i < count; i++) {
+            plaintexts[i] = splitmix64(&state);
+            keys[i] = splitmix64(&state);
+        }
+        des_avalanche_accumulate(plaintexts, keys, count, job->target, job->bic, w->counts);
     }
-    return count;
+    return NULL;
 }
 
-// Function to print data in hexadecimal format
-void print_hex(FILE *file, const uint8_t *data, size_t length) {
-    for (size_t i = 0; i < length; i++) {
-        fprintf(file, "%02X", data[i]);
+// ================================
+//      Statistics
+// ================================
+
+static const char *target_name(int target) {
+    return target == DES_AVALANCHE_KEY ? "key" : "plaintext";
+}
+
+static int target_inputs(int target) {
+    return target == DES_AVALANCHE_KEY ? 56 : 64;
+}
+
+// DES bit number (1-based) of input row i
+static int input_bit(int target, int i) {
+    return target == DES_AVALANCHE_KEY ? i + i / 7 + 1 : i + 1;
+}
+
+// Correlation between the changes of output bits j < k when input bit i is flipped
+static double bic_correlation(const DES_AvalancheCounts *c, int i, int j, int k) {
+    double n = (double)c->samples, a = (double)c->flips[i][j], b = (double)c->flips[i][k];
+    double both = (double)c->pairs[i][j][k];
+    double var = a * (n - a) * b * (n - b);
+    return var > 0 ? (n * both - a * b) / sqrt(var) : 0.0;
+}
+
+static int write_matrix(const char *path, int binary, const char *magic, int target,
+                        const double *m, int rows, uint64_t samples) {
+    FILE *file = fopen(path, binary ? "wb" : "w");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    if (binary) {
+        uint32_t shape[2] = {(uint32_t)rows, 64};
+        fwrite(magic, 1, 8, file);
+        fwrite(shape, sizeof(shape), 1, file);
+        fwrite(&samples, sizeof(samples), 1, file);
+        fwrite(m, sizeof(double), (size_t)rows * 64, file);
+    } else {
+        fprintf(file, "%s", target < 0 ? "output_bit" : "input_bit");
+        for (int j = 0; j < 64; j++) fprintf(file, ",out%d", j + 1);
+        fprintf(file, "\n");
+        for (int i = 0; i < rows; i++) {
+            fprintf(file, "%d", target < 0 ? i + 1 : input_bit(target, i));
+            for (int j = 0; j < 64; j++) fprintf(file, ",%.6f", m[i * 64 + j]);
+            fprintf(file, "\n");
+        }
     }
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        perror(path);
+        return -1;
+    }
+    return 0;
 }
 
-void test_avalanche_effect(uint64_t key, const uint8_t *plaintext, double *total_avalanche, FILE *file) {
-    uint8_t iv[BLOCK_SIZE];
-    uint8_t ciphertext_original[BLOCK_SIZE], ciphertext_modified[BLOCK_SIZE];
+// Prints the summary and writes the SAC (and BIC) matrices of one target
+static int report(const DES_AvalancheCounts *c, int target, int bic, const char *prefix, int binary) {
+    int rows = target_inputs(target);
+    double n = (double)c->samples;
+    double sigma = 0.5 / sqrt(n);   // Standard deviation of a SAC entry for an ideal cipher
+    static double sac[64 * 64], independence[64 * 64];
+    double chi2 = 0, worst = 0, min_row = 64, total = 0;
+    int worst_i = 0, worst_j = 0, outliers = 0;
 
-    // Generate random IV for each iteration
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        iv[i] = rand() % 256;
+    for (int i = 0; i < rows; i++) {
+        double row = 0;
+        for (int j = 0; j < 64; j++) {
+            double p = (double)c->flips[i][j] / n, dev = fabs(p - 0.5);
+            sac[i * 64 + j] = p;
+            row += p;
+            chi2 += (p - 0.5) * (p - 0.5) / (sigma * sigma);
+            if (dev > 4 * sigma) outliers++;
+            if (dev > worst) {
+                worst = dev;
+                worst_i = i;
+                worst_j = j;
+            }
+        }
+        total += row;
+        if (row < min_row) min_row = row;
     }
 
-    // Encrypt the original plaintext
-    uint8_t temp_plaintext[BLOCK_SIZE];
-    memcpy(temp_plaintext, plaintext, BLOCK_SIZE); // Copy plaintext to avoid modifying the original
-    des_cbc_encrypt(temp_plaintext, BLOCK_SIZE, key, iv);
-    memcpy(ciphertext_original, temp_plaintext, BLOCK_SIZE);  // Save the original ciphertext
-
-    // Write the original plaintext, IV, and ciphertext to the file
-    fprintf(file, "\nOriginal Plaintext: ");
-    print_hex(file, plaintext, BLOCK_SIZE);
-    fprintf(file, "\nOriginal IV: ");
-    print_hex(file, iv, BLOCK_SIZE);
-    fprintf(file, "\nOriginal Ciphertext: ");
-    print_hex(file, ciphertext_original, BLOCK_SIZE);
-    fprintf(file, "\n");
-
-    // Modify one specific bit in the plaintext to check the avalanche effect
-    uint8_t modified_plaintext[BLOCK_SIZE];
-    memcpy(modified_plaintext, plaintext, BLOCK_SIZE);  // Copy original plaintext
-
-    // Modify the specific bit in the plaintext (flip the bit passed as an argument)
-    modified_plaintext[FLIP_BIT / 8] ^= (1 << (FLIP_BIT % 8)); // Flip the specific bit
-    fprintf(file, "Flipping bit: %d\n", FLIP_BIT); // Show which bit is flipped
-
-    // Encrypt the modified plaintext
-    uint8_t temp_modified_plaintext[BLOCK_SIZE];
-    memcpy(temp_modified_plaintext, modified_plaintext, BLOCK_SIZE); // Copy modified plaintext
-    des_cbc_encrypt(temp_modified_plaintext, BLOCK_SIZE, key, iv);
-    memcpy(ciphertext_modified, temp_modified_plaintext, BLOCK_SIZE);  // Save the modified ciphertext
-
-    // Calculate the bit differences between original and modified ciphertext (Hamming distance)
-    int bit_difference = count_bit_difference(ciphertext_original, ciphertext_modified, BLOCK_SIZE);
-
-    // Print the modified plaintext and ciphertext for this bit change
-    fprintf(file, "Modified Plaintext (Flipped Bit %d): ", FLIP_BIT);
-    print_hex(file, modified_plaintext, BLOCK_SIZE);
-    fprintf(file, "\nModified Ciphertext: ");
-    print_hex(file, ciphertext_modified, BLOCK_SIZE);
-    fprintf(file, "\nHamming Distance: %d\n", bit_difference);
-
-    // Compute the avalanche effect (percentage of bit changes)
-    double avalanche_percentage = ((double)bit_difference / (BLOCK_SIZE * 8)) * 100;
-    fprintf(file, "Avalanche Effect: %.2f%%\n", avalanche_percentage);
-
-    // Add the result to the total avalanche effect
-    *total_avalanche += avalanche_percentage;
-}
+    printf("\n=== %s bits (%d inputs x 64 outputs, %llu samples) ===\n", target_name(target), rows,
+           (unsigned long long)c->samples);
+    printf("Average avalanche: %.4f output bits (%.3f%%), weakest input %.4f\n", total / rows,
+           100.0 * total / (rows * 64.0), min_row);
+    printf("SAC: worst |p - 0.5| = %.6f (input %d, output %d) = %.2f sigma; %d of %d entries beyond 4 sigma\n",
+           worst, input_bit(target, worst_i), worst_j + 1, worst / sigma, outliers, rows * 64);
+    printf("SAC: chi-square %.1f on %d degrees of freedom (%.3f per entry)\n", chi2, rows * 64,
+           chi2 / (rows * 64));
 
-int main() {
-    srand(time(NULL));
-    uint64_t key = 0x133457799BBCDFF1; // Example DES key
-    double total_avalanche = 0.0;
+    char path[1024];
+    const char *ext = binary ? "bin" : "csv";
+    snprintf(path, sizeof(path), "%s_%s_sac.%s", prefix, target_name(target), ext);
+    if (write_matrix(path, binary, "DESSAC1\n", target, sac, rows, c->samples) != 0) return -1;
+    printf("SAC matrix written to %s\n", path);
+    if (!bic) return 0;
 
-    // Open the output file
-    FILE *file = fopen("des_avalanche_effect_results.txt", "w");
-    if (file == NULL) {
-        perror("Error opening file");
-        return 1;
+    // Pair correlations over every input bit; an ideal cipher gives |r| ~ 0.8 / sqrt(n)
+    double worst_r = 0, sum_r = 0;
+    int pair_count = 0;
+    memset(independence, 0, sizeof(independence));
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < 64; j++) {
+            for (int k = j + 1; k < 64; k++) {
+                double r = fabs(bic_correlation(c, i, j, k));
+                sum_r += r;
+                pair_count++;
+                if (r > independence[j * 64 + k]) independence[j * 64 + k] = independence[k * 64 + j] = r;
+                if (r > worst_r) worst_r = r;
+            }
+        }
     }
+    printf("BIC: max |r| = %.6f, mean |r| = %.6f (ideal mean %.6f)\n", worst_r, sum_r / pair_count,
+           sqrt(2.0 / M_PI) / sqrt(n));
+
+    snprintf(path, sizeof(path), "%s_%s_bic.%s", prefix, target_name(target), ext);
+    if (write_matrix(path, binary, "DESBIC1\n", -1, independence, 64, c->samples) != 0) return -1;
+    printf("BIC matrix written to %s\n", path);
+    return 0;
+}
+
+// ================================
+//      Main
+// ================================
 
-    // Fixed plaintext for all iterations
-    uint8_t plaintext[BLOCK_SIZE] = {0x33, 0x0C, 0xFF, 0xCC, 0xFF, 0xC0, 0x33, 0x00}; // 33 0C FF CC FF C0 33 00
+static uint64_t parse_count(const char *text) {
+    char *end;
+    uint64_t value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    if (*end == 'M' || *end == 'm') value <<= 20;
+    return value;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: des_avalanche [--samples N] [--target plaintext|key|both] [--no-bic]\n"
+            "                     [--threads N] [--seed N] [--format csv|bin] [--out PREFIX]\n");
+}
 
-    // Run the avalanche test multiple iterations, flipping the same bit each time
-    for (int i = 0; i < NUM_ITERATIONS; i++) {
-        fprintf(file, "Iteration %d:\n", i + 1);
+int main(int argc, char **argv) {
+    uint64_t samples = 1 << 20, seed = (uint64_t)time(NULL);
+    const char *target = "both", *format = "csv", *prefix = "des_avalanche";
+    int threads = des_get_threads(), bic = 1;
 
-        // Perform the avalanche effect test (flip the same bit in each iteration)
-        test_avalanche_effect(key, plaintext, &total_avalanche, file);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--no-bic") == 0) {
+            bic = 0;
+            continue;
+        }
+        if (!value) {
+            usage();
+            return 2;
+        }
+        i++;
+        if (strcmp(arg, "--samples") == 0) samples = parse_count(value);
+        else if (strcmp(arg, "--target") == 0) target = value;
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--format") == 0) format = value;
+        else if (strcmp(arg, "--out") == 0) prefix = value;
+        else {
+            usage();
+            return 2;
+        }
     }
+    int binary = strcmp(format, "bin") == 0;
+    int run_plaintext = strcmp(target, "plaintext") == 0 || strcmp(target, "both") == 0;
+    int run_key = strcmp(target, "key") == 0 || strcmp(target, "both") == 0;
+    if ((!binary && strcmp(format, "csv") != 0) || (!run_plaintext && !run_key) || samples == 0) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
 
-    // Calculate the final average avalanche effect
-    double final_avg_avalanche = total_avalanche / NUM_ITERATIONS;
-    fprintf(file, "\nFinal Average Avalanche Effect: %.2f%%\n", final_avg_avalanche);
+    printf("DES avalanche analysis: %llu samples, %d thread%s, %s kernel, seed %llu\n",
+           (unsigned long long)samples, threads, threads == 1 ? "" : "s", des_kernel_name(des_get_kernel()),
+           (unsigned long long)seed);
 
-    // Close the file
-    fclose(file);
+    Worker workers[MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        workers[t].counts = (DES_AvalancheCounts *)calloc(1, sizeof(DES_AvalancheCounts));
+        if (!workers[t].counts) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
 
-    return 0;
-}
\ No newline at end of file
+    int status = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int which = pass == 0 ? DES_AVALANCHE_PLAINTEXT : DES_AVALANCHE_KEY;
+        if (!(pass == 0 ? run_plaintext : run_key)) continue;
+
+        Job job = {which, bic, samples, seed ^ (uint64_t)pass << 63, 0};
+        double start = now_seconds();
+        for (int t = 0; t < threads; t++) {
+            workers[t].job = &job;
+            memset(workers[t].counts, 0, sizeof(DES_AvalancheCounts));
+            pthread_create(&workers[t].thread, NULL, avalanche_worker, &workers[t]);
+        }
+        for (int t = 0; t < threads; t++) pthread_join(workers[t].thread, NULL);
+        double elapsed = now_seconds() - start;
+
+        // Fold every worker's counts into the first
+        DES_AvalancheCounts *sum = workers[0].counts;
+        for (int t = 1; t < threads; t++) {
+            const uint64_t *from = (const uint64_t *)workers[t].counts;
+            uint64_t *to = (uint64_t *)sum;
+            for (size_t i = 0; i < sizeof(DES_AvalancheCounts) / sizeof(uint64_t); i++) to[i] += from[i];
+        }
+
+        double encryptions = (double)samples * (target_inputs(which) + 1);
+        if (report(sum, which, bic, prefix, binary) != 0) status = 1;
+        printf("Time: %.2fs (%.2f M samples/s, %.1f M encryptions/s)\n", elapsed, samples / elapsed / 1e6,
+               encryptions / elapsed / 1e6);
+    }
+
+    for (int t = 0; t < threads; t++) free(workers[t].counts);
+    return status;
+}
@@ -0,0 +1,147 @@
+#include "des_internal.h"
+#include <string.h>
+
+// ================================
+//      Wiring Tables
+// ================================
+
+uint8_t des_bs_key_index[16][48];
+uint8_t des_bs_p_inverse[32];
+
+static volatile int des_bs_tables_ready = 0;
+
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+void des_bs_init_tables(void) {
+    if (des_bs_tables_ready) return;
+
+    // Follow every key bit through PC-1, the rotations and PC-2
+    uint8_t cd[56], rotated[56];
+    for (int p = 0; p < 56; p++) {
+        cd[p] = DES_INITIAL_KEY_PERMUTATION[p] - 1;
+    }
+    for (int round = 0; round < 16; round++) {
+        int shift = DES_KEY_SHIFT_SIZES[round];
+        for (int p = 0; p < 28; p++) {
+            rotated[p] = cd[(p + shift) % 28];
+            rotated[28 + p] = cd[28 + (p + shift) % 28];
+        }
+        memcpy(cd, rotated, sizeof(cd));
+        for (int i = 0; i < 48; i++) {
+            uint8_t key_bit = cd[DES_SUB_KEY_PERMUTATION[i] - 1];
+            des_bs_key_index[round][i] = key_bit;
+        }
+    }
+
+    for (int p = 0; p < 32; p++) {
+        des_bs_p_inverse[DES_RIGHT_SUB_MESSAGE_PERMUTATION[p] - 1] = (uint8_t)p;
+    }
+
+    des_bs_tables_ready = 1;
+}
+
+// One butterfly stage: swaps the j-bit blocks selected by mask between rows k and k + j
+#define DES_BS_TRANSPOSE_STAGE(j, mask)                          \
+    for (int base = 0; base < 64; base += 2 * (j)) {             \
+        for (int k = base; k < base + (j); k++) {                \
+            uint64_t t = ((m[k] >> (j)) ^ m[k + (j)]) & (mask);  \
+            m[k] ^= t << (j);                                    \
+            m[k + (j)] ^= t;                                     \
+        }                                                        \
+    }
+
+void des_bs_transpose64(uint64_t m[64]) {
+    // Constant shifts and masks per stage let the compiler unroll and vectorize the rows
+    DES_BS_TRANSPOSE_STAGE(32, 0x00000000FFFFFFFFULL)
+    DES_BS_TRANSPOSE_STAGE(16, 0x0000FFFF0000FFFFULL)
+    DES_BS_TRANSPOSE_STAGE(8, 0x00FF00FF00FF00FFULL)
+    DES_BS_TRANSPOSE_STAGE(4, 0x0F0F0F0F0F0F0F0FULL)
+    DES_BS_TRANSPOSE_STAGE(2, 0x3333333333333333ULL)
+    DES_BS_TRANSPOSE_STAGE(1, 0x5555555555555555ULL)
+}
+
+// ================================
+//      64-Lane Scalar Instantiation
+// ================================
+
+#define BS_WORD uint64_t
+#define BS_NAME(x) des_bs64_##x
+#define BS_GROUPS 1
+#define BS_KERNEL_ID DES_KERNEL_BITSLICE64
+#define BS_KERNEL_NAME "bitslice64"
+#include "des_bitslice_core.h"
+#undef BS_WORD
+#undef BS_NAME
+#undef BS_GROUPS
+#undef BS_KERNEL_ID
+#undef BS_KERNEL_NAME
+
+// ================================
+//      Public API
+// ================================
+
+void des_bitslice_transpose_in(const uint8_t *blocks, uint64_t slices[64]) {
+    uint64_t values[64];
+    for (int i = 0; i < 64; i++) {
+        values[i] = des_be_bytes_to_uint64(blocks + 8 * i);
+    }
+    des_bs64_load(slices, values);
+}
+
+void des_bitslice_transpose_out(const uint64_t slices[64], uint8_t *blocks) {
+    uint64_t values[64];
+    des_bs64_store(slices, values);
+    for (int i = 0; i < 64; i++) {
+        des_uint64_to_be_bytes(values[i], blocks + 8 * i);
+    }
+}
+
+void des_bitslice_crypt(uint64_t slices[64], const uint64_t key_slices[64], int mode) {
+    if (!des_bs_tables_ready) des_bs_init_tables();
+    des_bs64_crypt(slices, key_slices, mode);
+}
+
+static void des_bitslice_ecb(const uint8_t *input, uint8_t *output, size_t blocks,
+                             const DES_RoundKeys *round_keys, int mode) {
+    uint64_t key_slices[64], slices[64];
+    uint8_t tail[64 * 8];
+
+    des_bs64_broadcast(key_slices, round_keys->key);
+
+    size_t i = 0;
+    for (; i + 64 <= blocks; i += 64) {
+        des_bitslice_transpose_in(input + 8 * i, slices);
+        des_bs64_crypt(slices, key_slices, mode);
+        des_bitslice_transpose_out(slices, output + 8 * i);
+    }
+    if (i < blocks) {
+        size_t rest = (blocks - i) * 8;
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, input + 8 * i, rest);
+        des_bitslice_transpose_in(tail, slices);
+        des_bs64_crypt(slices, key_slices, mode);
+        des_bitslice_transpose_out(slices, tail);
+        memcpy(output + 8 * i, tail, rest);
+    }
+}
+
+void des_bitslice_encrypt(const uint8_t *input, uint8_t *output, size_t blocks, const DES_RoundKeys *round_keys) {
+    des_bitslice_ecb(input, output, blocks, round_keys, DES_ENCRYPT);
+}
+
+void des_bitslice_decrypt(const uint8_t *input, uint8_t *output, size_t blocks, const DES_RoundKeys *round_keys) {
+    des_bitslice_ecb(input, output, blocks, round_keys, DES_DECRYPT);
+}
+
+uint64_t des_bitslice_key_search(const uint64_t keys[DES_BITSLICE_LANES], const uint8_t plaintext[8],
+                                 const uint8_t ciphertext[8]) {
+    uint64_t key_slices[64], slices[64], matches;
+    if (!des_bs_tables_ready) des_bs_init_tables();
+
+    des_bs64_load(key_slices, keys);
+    des_bs64_broadcast(slices, des_be_bytes_to_uint64(plaintext));
+    des_bs64_crypt(slices, key_slices, DES_ENCRYPT);
+    des_bs64_match(slices, des_be_bytes_to_uint64(ciphertext), &matches);
+    return matches;
+}
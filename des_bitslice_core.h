@@ -0,0 +1,292 @@
+// Bitsliced DES core, instantiated once per lane word type.
+//
+// The includer defines:
+//   BS_WORD         lane word type (uint64_t or a GCC vector of uint64_t)
+//   BS_NAME(x)      name mangling for the generated functions
+//   BS_GROUPS       number of 64-bit elements in BS_WORD
+//   BS_KERNEL_ID    DES_Kernel value; BS_NAME(ops) is then exported for dispatch
+//   BS_KERNEL_NAME  kernel name string
+//   BS_KEY_FILTER   optional, 0 leaves out the early-reject key trial (key_filter is NULL)
+//
+// State layout: s[k] holds DES bit k + 1 (MSB-first numbering) of every lane;
+// lane 64 * g + j is bit j of element g. Key slices use the same numbering for
+// the 64 key bits (the parity slices are never read). All permutations are
+// plain index renaming; each S-box is a decoder network built from DES_SBOXn.
+
+#include <string.h>
+
+#ifndef DES_BITSLICE_CORE_ONCE
+#define DES_BITSLICE_CORE_ONCE
+
+static const uint8_t des_bs_sbox_table[8][64] = {
+    DES_SBOX1_VALUES, DES_SBOX2_VALUES, DES_SBOX3_VALUES, DES_SBOX4_VALUES,
+    DES_SBOX5_VALUES, DES_SBOX6_VALUES, DES_SBOX7_VALUES, DES_SBOX8_VALUES};
+
+// The S-box loops below must unroll completely so every table lookup folds away
+#if defined(__GNUC__)
+#define DES_BS_INLINE static inline __attribute__((always_inline))
+#define DES_BS_PRAGMA(x) _Pragma(#x)
+#define DES_BS_UNROLL(n) DES_BS_PRAGMA(GCC unroll n)
+#else
+#define DES_BS_INLINE static inline
+#define DES_BS_UNROLL(n)
+#endif
+
+#endif // DES_BITSLICE_CORE_ONCE
+
+// S-box `box` (a compile-time constant) on six input slices, x[0] being the MSB of
+// the group. The inputs are decoded into a[i] (top three bits) and b[j] (bottom
+// three); output bit `bit` is the OR over i of a[i] & B(i, bit), where B is the OR of
+// the b[j] whose table entry has that bit set (or the complement of the others).
+DES_BS_INLINE void BS_NAME(sbox)(const int box, const BS_WORD *x, BS_WORD *y) {
+    BS_WORD a[8], b[8];
+    BS_WORD zero = x[0] ^ x[0];  // All-zero word of the lane type
+    BS_WORD n0 = ~x[0], n1 = ~x[1], n2 = ~x[2], n3 = ~x[3], n4 = ~x[4], n5 = ~x[5];
+
+    BS_WORD a00 = n0 & n1, a01 = n0 & x[1], a10 = x[0] & n1, a11 = x[0] & x[1];
+    a[0] = a00 & n2; a[1] = a00 & x[2]; a[2] = a01 & n2; a[3] = a01 & x[2];
+    a[4] = a10 & n2; a[5] = a10 & x[2]; a[6] = a11 & n2; a[7] = a11 & x[2];
+
+    BS_WORD b00 = n3 & n4, b01 = n3 & x[4], b10 = x[3] & n4, b11 = x[3] & x[4];
+    b[0] = b00 & n5; b[1] = b00 & x[5]; b[2] = b01 & n5; b[3] = b01 & x[5];
+    b[4] = b10 & n5; b[5] = b10 & x[5]; b[6] = b11 & n5; b[7] = b11 & x[5];
+
+    BS_WORD acc[4];
+    DES_BS_UNROLL(8)
+    for (int i = 0; i < 8; i++) {
+        DES_BS_UNROLL(4)
+        for (int bit = 0; bit < 4; bit++) {
+            int set = 0;
+            DES_BS_UNROLL(8)
+            for (int j = 0; j < 8; j++) {
+                int v = 8 * i + j;
+                int row = ((v >> 4) & 2) | (v & 1);
+                int column = (v >> 1) & 0xF;
+                if ((des_bs_sbox_table[box][row * 16 + column] >> (3 - bit)) & 1) {
+                    set |= 1 << j;
+                }
+            }
+            int invert = __builtin_popcount(set) > 4;
+            if (invert) set ^= 0xFF;
+
+            BS_WORD term = zero;
+            DES_BS_UNROLL(8)
+            for (int j = 0; j < 8; j++) {
+                if ((set >> j) & 1) term |= b[j];
+            }
+            if (invert) term = ~term;
+
+            if (i == 0) {
+                acc[bit] = a[0] & term;
+            } else {
+                acc[bit] |= a[i] & term;
+            }
+        }
+    }
+    y[0] = acc[0]; y[1] = acc[1]; y[2] = acc[2]; y[3] = acc[3];
+}
+
+// One Feistel round: l ^= P(S(E(r) ^ subkey)), with the subkey read from the key slices
+DES_BS_INLINE void BS_NAME(round)(BS_WORD *l, const BS_WORD *r, const BS_WORD *k, const uint8_t *key_index) {
+    DES_BS_UNROLL(8)
+    for (int box = 0; box < 8; box++) {
+        BS_WORD in[6], out[4];
+        // E: group `box` is bits 4 * box - 1 .. 4 * box + 4 of R, wrapping around
+        for (int b = 0; b < 6; b++) {
+            in[b] = r[(4 * box + b + 31) % 32] ^ k[key_index[6 * box + b]];
+        }
+        BS_NAME(sbox)(box, in, out);
+        for (int b = 0; b < 4; b++) {
+            l[des_bs_p_inverse[4 * box + b]] ^= out[b];
+        }
+    }
+}
+
+// Stores the state after `round` rounds (L in slices 0-31, R in 32-63) into the tap
+DES_BS_INLINE void BS_NAME(tap_state)(BS_WORD *tap, int round, const BS_WORD *l, const BS_WORD *r) {
+    memcpy(tap + 64 * round, l, 32 * sizeof(BS_WORD));
+    memcpy(tap + 64 * round + 32, r, 32 * sizeof(BS_WORD));
+}
+
+// The first `rounds` rounds forwards (encrypt) or the last ones backwards (decrypt),
+// then the swap and FP. With a tap, state r (0 = after IP) goes to tap[64 r ..]. The
+// full cipher instantiates this with constants, so rounds and the tap cost it nothing.
+DES_BS_INLINE void BS_NAME(crypt_body)(BS_WORD *s, const BS_WORD *k, int mode, const int rounds, BS_WORD *tap) {
+    BS_WORD L[32], R[32];
+
+    for (int i = 0; i < 32; i++) {
+        L[i] = s[DES_INITIAL_MESSAGE_PERMUTATION[i] - 1];
+        R[i] = s[DES_INITIAL_MESSAGE_PERMUTATION[32 + i] - 1];
+    }
+    if (tap) BS_NAME(tap_state)(tap, 0, L, R);
+
+    // Two rounds per iteration so the halves swap roles without copying: after an odd
+    // round L_r is in R and R_r in L
+    int round = 0;
+    for (; round + 2 <= rounds; round += 2) {
+        int first = mode == DES_ENCRYPT ? round : 15 - round;
+        int second = mode == DES_ENCRYPT ? round + 1 : 14 - round;
+        BS_NAME(round)(L, R, k, des_bs_key_index[first]);
+        if (tap) BS_NAME(tap_state)(tap, round + 1, R, L);
+        BS_NAME(round)(R, L, k, des_bs_key_index[second]);
+        if (tap) BS_NAME(tap_state)(tap, round + 2, L, R);
+    }
+    if (round < rounds) {
+        BS_NAME(round)(L, R, k, des_bs_key_index[mode == DES_ENCRYPT ? round : 15 - round]);
+        if (tap) BS_NAME(tap_state)(tap, round + 1, R, L);
+    }
+
+    // Pre-output block is R_r || L_r
+    const BS_WORD *left = rounds % 2 ? R : L, *right = rounds % 2 ? L : R;
+    for (int i = 0; i < 64; i++) {
+        int src = DES_FINAL_MESSAGE_PERMUTATION[i] - 1;
+        s[i] = src < 32 ? right[src] : left[src - 32];
+    }
+}
+
+// Encrypts (DES_ENCRYPT) or decrypts (DES_DECRYPT) every lane of s in place
+static void BS_NAME(crypt)(BS_WORD *s, const BS_WORD *k, int mode) {
+    BS_NAME(crypt_body)(s, k, mode, 16, NULL);
+}
+
+// Reduced-round encryption (1 to 16 rounds), optionally tapping every state
+static void BS_NAME(crypt_rounds)(BS_WORD *s, const BS_WORD *k, int rounds, BS_WORD *tap) {
+    BS_NAME(crypt_body)(s, k, DES_ENCRYPT, rounds, tap);
+}
+
+#if !defined(BS_KEY_FILTER) || BS_KEY_FILTER
+// Early-reject key trial on the plaintext in s (left intact): rounds 1-14, then round
+// 15 one S-box at a time against R15 = L16 of each target. The pass ends as soon as no
+// lane can still match. masks[t * BS_GROUPS + g] bit j is set when lane 64 * g + j
+// survives target t.
+static void BS_NAME(key_filter)(const BS_WORD *s, const BS_WORD *k, const uint32_t *targets,
+                                int target_count, uint64_t *masks) {
+    BS_WORD L[32], R[32], alive[2], zero;
+    memset(&zero, 0, sizeof(zero));
+
+    for (int i = 0; i < 32; i++) {
+        L[i] = s[DES_INITIAL_MESSAGE_PERMUTATION[i] - 1];
+        R[i] = s[DES_INITIAL_MESSAGE_PERMUTATION[32 + i] - 1];
+    }
+    for (int round = 0; round < 14; round += 2) {
+        BS_NAME(round)(L, R, k, des_bs_key_index[round]);
+        BS_NAME(round)(R, L, k, des_bs_key_index[round + 1]);
+    }
+
+    alive[0] = alive[1] = ~zero;
+    DES_BS_UNROLL(8)
+    for (int box = 0; box < 8; box++) {
+        BS_WORD in[6], out[4], any = zero;
+        uint64_t words[BS_GROUPS], live = 0;
+        for (int b = 0; b < 6; b++) {
+            in[b] = R[(4 * box + b + 31) % 32] ^ k[des_bs_key_index[14][6 * box + b]];
+        }
+        BS_NAME(sbox)(box, in, out);
+        for (int t = 0; t < target_count; t++) {
+            for (int b = 0; b < 4; b++) {
+                int p = des_bs_p_inverse[4 * box + b];
+                alive[t] &= ~(out[b] ^ L[p] ^ (zero - ((targets[t] >> (31 - p)) & 1)));
+            }
+            any |= alive[t];
+        }
+        memcpy(words, &any, sizeof(words));
+        for (int g = 0; g < BS_GROUPS; g++) live |= words[g];
+        if (!live) break;
+    }
+    for (int t = 0; t < target_count; t++) {
+        memcpy(masks + t * BS_GROUPS, &alive[t], sizeof(alive[t]));
+    }
+}
+
+#endif
+
+// Slices BS_GROUPS * 64 host-order 64-bit values (lane i = values[i])
+static void BS_NAME(load)(BS_WORD *s, const uint64_t *values) {
+    uint64_t *words = (uint64_t *)s;
+    uint64_t m[64];
+    for (int g = 0; g < BS_GROUPS; g++) {
+        memcpy(m, values + 64 * g, sizeof(m));
+        des_bs_transpose64(m);
+        for (int bit = 0; bit < 64; bit++) {
+            words[bit * BS_GROUPS + g] = m[63 - bit];
+        }
+    }
+}
+
+// Inverse of load
+static void BS_NAME(store)(const BS_WORD *s, uint64_t *values) {
+    const uint64_t *words = (const uint64_t *)s;
+    uint64_t m[64];
+    for (int g = 0; g < BS_GROUPS; g++) {
+        for (int bit = 0; bit < 64; bit++) {
+            m[63 - bit] = words[bit * BS_GROUPS + g];
+        }
+        des_bs_transpose64(m);
+        memcpy(values + 64 * g, m, sizeof(m));
+    }
+}
+
+// Sets every lane to the same 64-bit value
+static void BS_NAME(broadcast)(BS_WORD *s, uint64_t value) {
+    BS_WORD zero;
+    memset(&zero, 0, sizeof(zero));
+    for (int bit = 0; bit < 64; bit++) {
+        s[bit] = zero - ((value >> (63 - bit)) & 1);
+    }
+}
+
+// Per-lane equality with a broadcast value; masks[g] bit j is set when lane 64 * g + j matches
+static void BS_NAME(match)(const BS_WORD *s, uint64_t value, uint64_t *masks) {
+    BS_WORD diff, zero;
+    memset(&zero, 0, sizeof(zero));
+    diff = zero;
+    for (int bit = 0; bit < 64; bit++) {
+        diff |= s[bit] ^ (zero - ((value >> (63 - bit)) & 1));
+    }
+    memcpy(masks, &diff, sizeof(diff));
+    for (int g = 0; g < BS_GROUPS; g++) {
+        masks[g] = ~masks[g];
+    }
+}
+
+// Type-erased entry points for the runtime dispatcher in des_simd.c
+static void BS_NAME(load_any)(void *s, const uint64_t *values) {
+    BS_NAME(load)((BS_WORD *)s, values);
+}
+
+static void BS_NAME(store_any)(const void *s, uint64_t *values) {
+    BS_NAME(store)((const BS_WORD *)s, values);
+}
+
+static void BS_NAME(broadcast_any)(void *s, uint64_t value) {
+    BS_NAME(broadcast)((BS_WORD *)s, value);
+}
+
+static void BS_NAME(crypt_any)(void *s, const void *k, int mode) {
+    BS_NAME(crypt)((BS_WORD *)s, (const BS_WORD *)k, mode);
+}
+
+static void BS_NAME(crypt_rounds_any)(void *s, const void *k, int rounds, void *tap) {
+    BS_NAME(crypt_rounds)((BS_WORD *)s, (const BS_WORD *)k, rounds, (BS_WORD *)tap);
+}
+
+static void BS_NAME(match_any)(const void *s, uint64_t value, uint64_t *masks) {
+    BS_NAME(match)((const BS_WORD *)s, value, masks);
+}
+
+#if !defined(BS_KEY_FILTER) || BS_KEY_FILTER
+static void BS_NAME(key_filter_any)(const void *s, const void *k, const uint32_t *targets,
+                                    int target_count, uint64_t *masks) {
+    BS_NAME(key_filter)((const BS_WORD *)s, (const BS_WORD *)k, targets, target_count, masks);
+}
+#define BS_KEY_FILTER_OP BS_NAME(key_filter_any)
+#else
+#define BS_KEY_FILTER_OP NULL
+#endif
+
+const DES_KernelOps BS_NAME(ops) = {
+    BS_KERNEL_ID, BS_KERNEL_NAME, 64 * BS_GROUPS,
+    BS_NAME(load_any), BS_NAME(store_any), BS_NAME(broadcast_any), BS_NAME(crypt_any), BS_NAME(match_any),
+    BS_KEY_FILTER_OP, BS_NAME(crypt_rounds_any),
+};
+#undef BS_KEY_FILTER_OP
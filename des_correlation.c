@@ -1,117 +1,389 @@
+/*
+ * DES Correlation Analysis
+ * Streams plaintext/ciphertext pairs through exact bit co-occurrence counters and reports
+ * Pearson correlations for two relations:
+ *   plaintext -> ciphertext    block P_t against its CBC ciphertext C_t
+ *   ciphertext -> ciphertext   C_t against the next block C_t+1 of the same CBC chain
+ * Each relation keeps the full 64x64 matrix of counts (bit i of the first block set,
+ * bit j of the second set, both set), accumulated per thread with popcounts of
+ * transposed words and merged at the end, so the statistics are exact for any volume.
+ *
+ * Usage: des_correlation [--bytes N] [--message N] [--pattern random|counter|sparse]
+ *                        [--key HEX] [--threads N] [--seed N] [--csv FILE]
+ *        des_correlation --plaintext FILE --ciphertext FILE [--skip N] [--threads N] [--csv FILE]
+ *
+ * The first form generates N bytes (K/M/G suffixes, default 1G) of plaintext as CBC
+ * messages of --message bytes (default 4K) under random IVs and encrypts them with
+ * des_cbc_encrypt_streams. The second form reads existing pairs; --skip drops a header
+ * from the ciphertext file (8 for the IV written by des_file). Per bit position, r is the
+ * correlation of bit i with bit i; "aggregate" pools all 64 positions, as the original
+ * single-block test did. The report goes to stdout and correlation_results.txt; --csv
+ * writes both full matrices with their counts.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <math.h>
 #include "des.h"
+#include "des_tool.h"
 
-#define BLOCK_SIZE 8   // DES block size in bytes
-#define SAMPLE_SIZE 10  // Number of iterations for correlation test
-
-// Function to compute correlation coefficient
-double compute_correlation(const uint8_t *plaintext, const uint8_t *ciphertext, size_t length) {
-    double sum_plain = 0, sum_cipher = 0, sum_plain_cipher = 0;
-    double sum_plain_sq = 0, sum_cipher_sq = 0;
-    int n = length * 8;  // Total number of bits
-    
-    // Calculate correlation between plaintext and ciphertext bit-by-bit
-    for (size_t i = 0; i < length; i++) {
-        for (int bit = 0; bit < 8; bit++) {
-            int p_bit = (plaintext[i] >> bit) & 1;  // Extract the bit from the plaintext
-            int c_bit = (ciphertext[i] >> bit) & 1; // Extract the bit from the ciphertext
-            
-            sum_plain += p_bit;
-            sum_cipher += c_bit;
-            sum_plain_cipher += p_bit * c_bit;
-            sum_plain_sq += p_bit * p_bit;
-            sum_cipher_sq += c_bit * c_bit;
-        }
+#define CHUNK_BYTES (1 << 20)   // Data a worker takes at a time
+#define RELATIONS 2
+
+enum { PLAIN_CIPHER, CIPHER_CIPHER };
+static const char *const relation_names[RELATIONS] = {"plaintext->ciphertext", "ciphertext->ciphertext"};
+
+typedef enum { PATTERN_RANDOM, PATTERN_COUNTER, PATTERN_SPARSE } Pattern;
+
+typedef struct {
+    // Generated pairs
+    uint64_t bytes;
+    size_t message;
+    Pattern pattern;
+    DES_RoundKeys round_keys;
+    uint64_t seed;
+    atomic_uint_fast64_t next_chunk;
+
+    // Pairs from files, read in order under the lock
+    FILE *plain_file, *cipher_file;
+    pthread_mutex_t lock;
+    int have_last;
+    uint64_t last_cipher;       // Final block of the previous chunk, paired with the next chunk's first
+    int read_error;
+} Source;
+
+typedef struct {
+    pthread_t thread;
+    Source *source;
+    DES_CorrelationCounts *counts[RELATIONS];
+} Worker;
+
+// ================================
+//      Pair Sources
+// ================================
+
+static uint64_t plaintext_word(Pattern pattern, uint64_t *state, uint64_t index) {
+    switch (pattern) {
+    case PATTERN_COUNTER:
+        return index;
+    case PATTERN_SPARSE:
+        // Each bit set with probability 1/16
+        return splitmix64(state) & splitmix64(state) & splitmix64(state) & splitmix64(state);
+    default:
+        return splitmix64(state);
     }
-    
-    // Compute the Pearson correlation coefficient
-    double numerator = (n * sum_plain_cipher) - (sum_plain * sum_cipher);
-    double denominator = sqrt((n * sum_plain_sq - sum_plain * sum_plain) * (n * sum_cipher_sq - sum_cipher * sum_cipher));
-    
-    // Return the correlation coefficient, checking for division by zero
-    return (denominator == 0) ? 0 : (numerator / denominator);
 }
 
-// DES encryption function in CBC mode (with the full round logic)
-void des_encrypt_cbc(const uint8_t *input, uint8_t *output, uint64_t key, uint8_t *iv) {
-    uint8_t block[BLOCK_SIZE];
-    uint8_t previous_ciphertext[BLOCK_SIZE];
-    
-    // Copy the IV to initialize the previous ciphertext (used in CBC mode)
-    memcpy(previous_ciphertext, iv, BLOCK_SIZE);
+// Builds chunk `chunk` as independent CBC messages; fills plain/cipher with host-order
+// words and returns the block count. Adjacent-ciphertext pairs never cross a message.
+static size_t generate_chunk(Source *src, uint64_t chunk, uint8_t *data, uint64_t *plain, uint64_t *cipher,
+                             DES_CbcStream *streams, size_t *stream_count) {
+    uint64_t offset = chunk * CHUNK_BYTES;
+    size_t bytes = src->bytes - offset < CHUNK_BYTES ? (size_t)(src->bytes - offset) : CHUNK_BYTES;
+    size_t blocks = bytes / 8;
+    uint64_t state = src->seed ^ (chunk * 0xD1B54A32D192ED03ULL);
 
-    // XOR the plaintext with the previous ciphertext (or IV for the first block)
-    for (int i = 0; i < BLOCK_SIZE; i++) {
-        block[i] = input[i] ^ previous_ciphertext[i];
+    for (size_t i = 0; i < blocks; i++) {
+        plain[i] = plaintext_word(src->pattern, &state, offset / 8 + i);
+        des_uint64_to_be_bytes(plain[i], data + 8 * i);
+    }
+    size_t count = 0;
+    for (size_t start = 0; start < 8 * blocks; start += src->message) {
+        DES_CbcStream *s = &streams[count++];
+        s->data = data + start;
+        s->length = 8 * blocks - start < src->message ? 8 * blocks - start : src->message;
+        s->round_keys = &src->round_keys;
+        des_uint64_to_be_bytes(splitmix64(&state), s->iv);
     }
+    des_cbc_encrypt_streams(streams, count);
+    for (size_t i = 0; i < blocks; i++) cipher[i] = des_be_bytes_to_uint64(data + 8 * i);
+    *stream_count = count;
+    return blocks;
+}
 
-    // Perform encryption with DES in CBC mode
-    des_cbc_encrypt(block, BLOCK_SIZE, key, iv);
+// Reads the next chunk of both files; cipher[0] is the previous chunk's last block
+// when there was one (the return value counts blocks after it)
+static size_t read_chunk(Source *src, uint8_t *data, uint64_t *plain, uint64_t *cipher, int *carried) {
+    pthread_mutex_lock(&src->lock);
+    size_t plain_bytes = fread(data, 1, CHUNK_BYTES, src->plain_file);
+    size_t blocks = plain_bytes / 8;
+    for (size_t i = 0; i < blocks; i++) plain[i] = des_be_bytes_to_uint64(data + 8 * i);
+    size_t cipher_bytes = blocks ? fread(data, 1, 8 * blocks, src->cipher_file) : 0;
+    if (cipher_bytes / 8 < blocks) blocks = cipher_bytes / 8;
+    if (ferror(src->plain_file) || ferror(src->cipher_file)) src->read_error = 1;
 
-    // Store the output ciphertext and update previous ciphertext for next block
-    memcpy(output, block, BLOCK_SIZE);
-    memcpy(previous_ciphertext, output, BLOCK_SIZE);  // Update the previous ciphertext for chaining
+    *carried = src->have_last;
+    cipher[0] = src->last_cipher;
+    for (size_t i = 0; i < blocks; i++) cipher[*carried + i] = des_be_bytes_to_uint64(data + 8 * i);
+    if (blocks > 0) {
+        src->have_last = 1;
+        src->last_cipher = cipher[*carried + blocks - 1];
+    }
+    pthread_mutex_unlock(&src->lock);
+    return blocks;
 }
 
-// Function to run the correlation test and write results to a file
-void test_correlation(uint64_t key) {
-    srand(time(NULL));  // Seed the random number generator
-    FILE *file = fopen("correlation_results.txt", "w");
-    if (file == NULL) {
-        printf("Error opening file!\n");
-        return;
+static void *correlation_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Source *src = w->source;
+    size_t max_blocks = CHUNK_BYTES / 8;
+    uint8_t *data = (uint8_t *)malloc(CHUNK_BYTES);
+    uint64_t *plain = (uint64_t *)malloc(max_blocks * sizeof(uint64_t));
+    uint64_t *cipher = (uint64_t *)malloc((max_blocks + 1) * sizeof(uint64_t));
+    DES_CbcStream *streams = (DES_CbcStream *)malloc((CHUNK_BYTES / 8) * sizeof(DES_CbcStream));
+    if (!data || !plain || !cipher || !streams) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
     }
 
-    fprintf(file, "=== DES CBC Mode Correlation Results ===\n");
+    for (;;) {
+        if (src->plain_file) {
+            int carried;
+            size_t blocks = read_chunk(src, data, plain, cipher, &carried);
+            if (blocks == 0) break;
+            des_correlation_accumulate(plain, cipher + carried, blocks, w->counts[PLAIN_CIPHER]);
+            des_correlation_accumulate(cipher, cipher + 1, blocks + carried - 1, w->counts[CIPHER_CIPHER]);
+        } else {
+            uint64_t chunk = atomic_fetch_add(&src->next_chunk, 1);
+            if (chunk * CHUNK_BYTES >= src->bytes) break;
+            size_t count;
+            size_t blocks = generate_chunk(src, chunk, data, plain, cipher, streams, &count);
+            des_correlation_accumulate(plain, cipher, blocks, w->counts[PLAIN_CIPHER]);
+            for (size_t s = 0; s < count; s++) {
+                size_t first = (size_t)(streams[s].data - data) / 8, n = streams[s].length / 8;
+                if (n > 1) des_correlation_accumulate(cipher + first, cipher + first + 1, n - 1, w->counts[CIPHER_CIPHER]);
+            }
+        }
+    }
+    free(data);
+    free(plain);
+    free(cipher);
+    free(streams);
+    return NULL;
+}
+
+// ================================
+//      Statistics
+// ================================
 
-    double total_correlation = 0.0;  // Variable to accumulate correlation for all iterations
+// Pearson r from exact counts: n pairs, a and b ones, both co-occurrences. The numerator
+// is formed in 128-bit integers so it stays exact however many pairs were counted.
+static double pearson(uint64_t n, uint64_t a, uint64_t b, uint64_t both) {
+    __int128 numerator = (__int128)n * both - (__int128)a * b;
+    double var = (double)a * (double)(n - a) * (double)b * (double)(n - b);
+    return var > 0 ? (double)numerator / sqrt(var) : 0.0;
+}
 
-    for (int i = 0; i < SAMPLE_SIZE; i++) {
-        uint8_t plaintext[BLOCK_SIZE], ciphertext[BLOCK_SIZE], iv[BLOCK_SIZE];
+static void report(FILE *out, const DES_CorrelationCounts *c, const char *name) {
+    uint64_t n = c->samples;
+    double noise = n ? 1.0 / sqrt((double)n) : 0;   // Standard deviation of r for independent bits
+    uint64_t ones_a = 0, ones_b = 0, same = 0;
+    double max_diag = 0, sum_diag = 0, max_all = 0, chi2 = 0;
+    int max_diag_bit = 0, max_i = 0, max_j = 0;
 
-        // Generate random plaintext and IV for each iteration
-        for (int j = 0; j < BLOCK_SIZE; j++) {
-            plaintext[j] = rand() % 256;
-            iv[j] = rand() % 256;  // Random IV to ensure unpredictability
+    fprintf(out, "\n=== %s (%llu pairs) ===\n", name, (unsigned long long)n);
+    fprintf(out, "%4s %10s %10s %10s\n", "bit", "P(a)", "P(b)", "r");
+    for (int i = 0; i < 64; i++) {
+        double r = pearson(n, c->ones_a[i], c->ones_b[i], c->both[i][i]);
+        fprintf(out, "%4d %10.6f %10.6f %+10.6f\n", i + 1, (double)c->ones_a[i] / n, (double)c->ones_b[i] / n, r);
+        ones_a += c->ones_a[i];
+        ones_b += c->ones_b[i];
+        same += c->both[i][i];
+        sum_diag += fabs(r);
+        if (fabs(r) > max_diag) {
+            max_diag = fabs(r);
+            max_diag_bit = i;
         }
+        for (int j = 0; j < 64; j++) {
+            double rij = pearson(n, c->ones_a[i], c->ones_b[j], c->both[i][j]);
+            chi2 += (double)n * rij * rij;
+            if (fabs(rij) > max_all) {
+                max_all = fabs(rij);
+                max_i = i;
+                max_j = j;
+            }
+        }
+    }
 
-        // Perform encryption in CBC mode with the random IV
-        des_encrypt_cbc(plaintext, ciphertext, key, iv);
+    double aggregate = pearson(64 * n, ones_a, ones_b, same);
+    fprintf(out, "Aggregate correlation (all positions pooled): %+.8f (%.2f sigma)\n", aggregate,
+            aggregate * sqrt(64.0 * n));
+    fprintf(out, "Same position: mean |r| %.6f, max |r| %.6f at bit %d (%.2f sigma)\n", sum_diag / 64, max_diag,
+            max_diag_bit + 1, max_diag / noise);
+    fprintf(out, "All 4096 bit pairs: max |r| %.6f at (%d, %d) (%.2f sigma); chi-square %.1f on 4096 df\n",
+            max_all, max_i + 1, max_j + 1, max_all / noise, chi2);
+}
 
-        // Compute the correlation between plaintext and ciphertext
-        double correlation = compute_correlation(plaintext, ciphertext, BLOCK_SIZE);
-        total_correlation += correlation;
+static int write_csv(const char *path, DES_CorrelationCounts *const *counts) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    fprintf(file, "relation,bit_a,bit_b,pairs,ones_a,ones_b,both,r\n");
+    for (int rel = 0; rel < RELATIONS; rel++) {
+        const DES_CorrelationCounts *c = counts[rel];
+        for (int i = 0; i < 64; i++) {
+            for (int j = 0; j < 64; j++) {
+                fprintf(file, "%s,%d,%d,%llu,%llu,%llu,%llu,%.8f\n", relation_names[rel], i + 1, j + 1,
+                        (unsigned long long)c->samples, (unsigned long long)c->ones_a[i],
+                        (unsigned long long)c->ones_b[j], (unsigned long long)c->both[i][j],
+                        pearson(c->samples, c->ones_a[i], c->ones_b[j], c->both[i][j]));
+            }
+        }
+    }
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// ================================
+//      Main
+// ================================
+
+static uint64_t parse_size(const char *text) {
+    char *end;
+    uint64_t value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    if (*end == 'M' || *end == 'm') value <<= 20;
+    if (*end == 'G' || *end == 'g') value <<= 30;
+    return value;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: des_correlation [--bytes N] [--message N] [--pattern random|counter|sparse]\n"
+            "                       [--key HEX] [--threads N] [--seed N] [--csv FILE]\n"
+            "       des_correlation --plaintext FILE --ciphertext FILE [--skip N] [--threads N] [--csv FILE]\n");
+}
 
-        // Write the plaintext, ciphertext, and correlation to the file for this iteration
-        fprintf(file, "Iteration %d:\n", i + 1);
-        fprintf(file, "Plaintext: ");
-        for (int j = 0; j < BLOCK_SIZE; j++) {
-            fprintf(file, "%02X", plaintext[j]);
+int main(int argc, char **argv) {
+    Source src;
+    memset(&src, 0, sizeof(src));
+    src.bytes = 1ULL << 30;
+    src.message = 4096;
+    src.seed = (uint64_t)time(NULL);
+    uint64_t key = 0x133457799BBCDFF1ULL, skip = 0;
+    const char *plain_path = NULL, *cipher_path = NULL, *csv_path = NULL, *pattern = "random";
+    int threads = des_get_threads();
+
+    for (int i = 1; i < argc; i += 2) {
+        const char *arg = argv[i], *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage();
+            return 2;
         }
-        fprintf(file, "\nCiphertext: ");
-        for (int j = 0; j < BLOCK_SIZE; j++) {
-            fprintf(file, "%02X", ciphertext[j]);
+        if (strcmp(arg, "--bytes") == 0) src.bytes = parse_size(value);
+        else if (strcmp(arg, "--message") == 0) src.message = (size_t)parse_size(value);
+        else if (strcmp(arg, "--pattern") == 0) pattern = value;
+        else if (strcmp(arg, "--key") == 0) key = strtoull(value, NULL, 16);
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) src.seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--csv") == 0) csv_path = value;
+        else if (strcmp(arg, "--plaintext") == 0) plain_path = value;
+        else if (strcmp(arg, "--ciphertext") == 0) cipher_path = value;
+        else if (strcmp(arg, "--skip") == 0) skip = parse_size(value);
+        else {
+            usage();
+            return 2;
         }
-        fprintf(file, "\nCorrelation: %.6f\n\n", correlation);
     }
+    if (strcmp(pattern, "random") == 0) src.pattern = PATTERN_RANDOM;
+    else if (strcmp(pattern, "counter") == 0) src.pattern = PATTERN_COUNTER;
+    else if (strcmp(pattern, "sparse") == 0) src.pattern = PATTERN_SPARSE;
+    else {
+        usage();
+        return 2;
+    }
+    src.message &= ~(size_t)7;
+    if (src.message < 16 || (!plain_path != !cipher_path)) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
 
-    // Print the overall average correlation to the file
-    double avg_correlation = total_correlation / SAMPLE_SIZE;
-    double correlation_percentage = fabs(avg_correlation) * 100;
-    fprintf(file, "\n=== Overall Correlation Result ===\n");
-    fprintf(file, "Average Correlation: %.6f\n", avg_correlation);
-    fprintf(file, "Correlation Effect: %.2f%%\n", correlation_percentage);
+    if (plain_path) {
+        src.plain_file = fopen(plain_path, "rb");
+        src.cipher_file = fopen(cipher_path, "rb");
+        if (!src.plain_file || !src.cipher_file) {
+            perror(!src.plain_file ? plain_path : cipher_path);
+            return 1;
+        }
+        if (skip && fseek(src.cipher_file, (long)skip, SEEK_SET) != 0) {
+            perror(cipher_path);
+            return 1;
+        }
+        pthread_mutex_init(&src.lock, NULL);
+        printf("DES correlation analysis: %s vs %s, %d thread%s\n", plain_path, cipher_path, threads,
+               threads == 1 ? "" : "s");
+    } else {
+        des_key_setup(key, &src.round_keys);
+        printf("DES correlation analysis: %llu bytes of %s plaintext in %zu-byte CBC messages, key %016llX, "
+               "%d thread%s, seed %llu\n", (unsigned long long)src.bytes, pattern, src.message,
+               (unsigned long long)key, threads, threads == 1 ? "" : "s", (unsigned long long)src.seed);
+    }
 
-    fclose(file);  // Close the file
-}
+    // Library calls from the workers stay on their own thread
+    des_set_threads(1);
+    Worker workers[MAX_THREADS];
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        workers[t].source = &src;
+        for (int rel = 0; rel < RELATIONS; rel++) {
+            workers[t].counts[rel] = (DES_CorrelationCounts *)calloc(1, sizeof(DES_CorrelationCounts));
+            if (!workers[t].counts[rel]) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        pthread_create(&workers[t].thread, NULL, correlation_worker, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++) pthread_join(workers[t].thread, NULL);
+    double elapsed = now_seconds() - start;
+    if (src.read_error) {
+        fprintf(stderr, "read error\n");
+        return 1;
+    }
 
-int main() {
-    uint64_t key = 0x133457799BBCDFF1;  // Example key
-    test_correlation(key);  // Run the correlation test with the given key
-    return 0;
+    // Merge every worker's counters into the first
+    for (int rel = 0; rel < RELATIONS; rel++) {
+        uint64_t *to = (uint64_t *)workers[0].counts[rel];
+        for (int t = 1; t < threads; t++) {
+            const uint64_t *from = (const uint64_t *)workers[t].counts[rel];
+            for (size_t i = 0; i < sizeof(DES_CorrelationCounts) / sizeof(uint64_t); i++) to[i] += from[i];
+        }
+    }
+
+    FILE *file = fopen("correlation_results.txt", "w");
+    if (!file) {
+        perror("correlation_results.txt");
+        return 1;
+    }
+    for (int rel = 0; rel < RELATIONS; rel++) {
+        report(stdout, workers[0].counts[rel], relation_names[rel]);
+        report(file, workers[0].counts[rel], relation_names[rel]);
+    }
+    fclose(file);
+
+    uint64_t bytes = workers[0].counts[PLAIN_CIPHER]->samples * 8;
+    printf("\nTime: %.2fs (%.1f MB/s)\n", elapsed, bytes / elapsed / 1e6);
+    int status = csv_path ? write_csv(csv_path, workers[0].counts) : 0;
+
+    for (int t = 0; t < threads; t++) {
+        for (int rel = 0; rel < RELATIONS; rel++) free(workers[t].counts[rel]);
+    }
+    if (src.plain_file) {
+        fclose(src.plain_file);
+        fclose(src.cipher_file);
+    }
+    return status != 0;
 }
@@ -1,94 +1,787 @@
+/*
+ * DES Ciphertext Randomness Battery
+ * Encrypts a long stream on the bulk kernels and runs statistical tests in the style of
+ * NIST SP 800-22 over it in one pass: frequency, block frequency, runs, longest run of
+ * ones, serial (two statistics), approximate entropy and cumulative sums (forward and
+ * reverse), plus the byte-level Shannon entropy the original test measured.
+ *
+ * Usage: des_entropy [--bytes N] [--sizes LIST] [--sequences N] [--mode cbc|ctr|ecb]
+ *                    [--plaintext zero|counter|random] [--record N] [--key HEX]
+ *                    [--threads N] [--seed N] [--csv FILE]
+ *
+ * The stream (--bytes, K/M/G suffixes, default 1G) is produced 1 MB chunk at a time by
+ * worker threads: CBC as --record-byte messages (default 2K) under random IVs through
+ * des_cbc_encrypt_streams, one CTR keystream, or ECB over counter blocks. Each row of the
+ * result is a sequence length: the stream is cut into sequences of that length and the
+ * battery runs on every one of them (at most --sequences, default 200, for lengths up to
+ * 1 MB; longer lengths must be whole megabytes and use every chunk). Rows report the
+ * average entropy, the share of sequences passing each test at alpha = 0.01 and a p-value:
+ * the test's own for a single sequence, otherwise the uniformity of the sequences' p-values
+ * (NIST's P-value_T, from 55 sequences). Tests whose minimum length is not met are blank.
+ *
+ * Workers keep order-independent partial statistics per row, and a summary per chunk
+ * (counts plus the edge bits needed to join chunks in order) from which sequences longer
+ * than a chunk are assembled at the end. Results are printed and written to
+ * des_cbc_entropy_results.csv, whose first two columns are the layout plot_entropy.py reads.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <time.h>
 #include "des.h"
+#include "des_tool.h"
+
+#define CHUNK_BYTES (1 << 20)
+#define MAX_ROWS 32
+#define ALPHA 0.01
+#define WINDOW_BITS 9           // Longest serial/approximate-entropy pattern counted
+#define PAIR_TABLE_MIN (64 * 1024)  // Sequences from this length count windows through byte pairs
+
+enum {
+    T_FREQUENCY, T_BLOCK_FREQUENCY, T_RUNS, T_LONGEST_RUN, T_SERIAL_1, T_SERIAL_2,
+    T_APPROXIMATE_ENTROPY, T_CUSUM_FORWARD, T_CUSUM_REVERSE, TEST_COUNT
+};
+static const char *const test_names[TEST_COUNT] = {
+    "Frequency", "Block Frequency", "Runs", "Longest Run", "Serial 1", "Serial 2",
+    "Approximate Entropy", "Cusum Forward", "Cusum Reverse"};
+static const char *const test_short[TEST_COUNT] = {
+    "freq", "block", "runs", "longest", "serial1", "serial2", "apen", "cusum-f", "cusum-r"};
+
+typedef enum { MODE_CBC, MODE_CTR, MODE_ECB } Mode;
+typedef enum { PLAIN_ZERO, PLAIN_COUNTER, PLAIN_RANDOM } Plaintext;
+
+// Test parameters for one sequence length (0 where a test does not apply)
+typedef struct {
+    size_t block_bytes;         // Block frequency block size
+    int longest_class;          // Longest-run table: 0 (8-bit), 1 (128-bit) or 2 (8192-bit blocks)
+    int serial_m;
+    int apen_m;
+} Params;
+
+// Longest run of ones: block size, first class bound, class count and probabilities
+typedef struct {
+    int block_bits;
+    int low;                    // Class 0 is "longest <= low", the last "longest >= low + classes - 1"
+    int classes;
+    double pi[7];
+} LongestRunTable;
+
+static LongestRunTable longest_tables[3] = {{8, 1, 4, {0}}, {128, 4, 6, {0}}, {8192, 10, 7, {0}}};
+
+// Statistics of a run of bytes that can be joined to the next run in order
+typedef struct {
+    uint64_t bits, ones, transitions;
+    int64_t walk, walk_max, walk_min;   // Cumulative sum (+1/-1 per bit) and its extremes, S_0 included
+    uint8_t first, last;
+    double block_sum;                   // Sum over blocks of (ones / M - 1/2)^2
+    uint64_t blocks;
+    uint64_t longest[7];                // Longest-run class counts
+    uint64_t windows[1 << WINDOW_BITS]; // 9-bit windows starting in every byte but the last
+    uint64_t bytes[256];
+} Segment;
+
+// Partial results of one row, merged by addition
+typedef struct {
+    uint64_t sequences;
+    double entropy;
+    uint64_t tested[TEST_COUNT], passed[TEST_COUNT];
+    uint64_t bins[TEST_COUNT][10];      // p-value deciles, for the uniformity test
+    double p_sum[TEST_COUNT];
+} RowStats;
+
+typedef struct {
+    size_t size;                // Sequence length in bytes
+    Params params;
+    uint64_t chunks_used;       // Chunks holding this row's sequences (short rows)
+    uint64_t sequences;         // Sequences tested
+    RowStats stats;
+} Row;
+
+typedef struct {
+    Mode mode;
+    Plaintext plaintext;
+    size_t record;
+    DES_RoundKeys round_keys;
+    uint64_t seed;
+    uint64_t chunks;
+    Row rows[MAX_ROWS];
+    int row_count;
+    Segment *chunk_segments;    // Per chunk, when a row spans chunks
+    Params chunk_params;
+    atomic_uint_fast64_t next_chunk;
+} Battery;
+
+typedef struct {
+    pthread_t thread;
+    Battery *battery;
+    RowStats stats[MAX_ROWS];
+} Worker;
+
+static uint8_t byte_ones[256], byte_transitions[256], lead_ones[256], trail_ones[256], max_ones[256];
+static int8_t walk_max[256], walk_min[256];
 
-#define ITERATIONS 10  // Number of tests for averaging
+// ================================
+//      Special Functions
+// ================================
 
-// Function to calculate entropy
-double calculate_entropy(const uint8_t *data, size_t length) {
-    int freq[256] = {0};
-    
-    for (size_t i = 0; i < length; i++) {
-        freq[data[i]]++;
+// Regularized upper incomplete gamma function Q(a, x)
+static double igamc(double a, double x) {
+    if (x <= 0) return 1.0;
+    double front = exp(-x + a * log(x) - lgamma(a));
+    if (x < a + 1) {
+        double term = 1.0 / a, sum = term;
+        for (int n = 1; n < 100000 && term > sum * 1e-16; n++) {
+            term *= x / (a + n);
+            sum += term;
+        }
+        return fmax(0.0, 1.0 - front * sum);
+    }
+    // Continued fraction (modified Lentz)
+    double b = x + 1 - a, c = 1e300, d = 1 / b, h = d;
+    for (int i = 1; i < 100000; i++) {
+        double an = -i * (i - a);
+        b += 2;
+        d = an * d + b;
+        if (fabs(d) < 1e-300) d = 1e-300;
+        c = b + an / c;
+        if (fabs(c) < 1e-300) c = 1e-300;
+        d = 1 / d;
+        h *= d * c;
+        if (fabs(d * c - 1) < 1e-16) break;
     }
-    
-    double entropy = 0.0;
-    for (int i = 0; i < 256; i++) {
-        if (freq[i] > 0) {
-            double p = (double)freq[i] / length;
-            entropy -= p * log2(p);
+    return front * h;
+}
+
+static double normal_cdf(double x) {
+    return 0.5 * erfc(-x / sqrt(2.0));
+}
+
+// Probability that the longest run of ones in `bits` random bits is at most r
+static double longest_run_at_most(int bits, int r) {
+    double *q = (double *)malloc((size_t)(bits + 1) * sizeof(double));
+    for (int n = 0; n <= bits; n++) {
+        if (n <= r) {
+            q[n] = 1.0;
+            continue;
         }
+        // The sequence starts with j ones (j <= r) and a zero, then any valid tail
+        q[n] = 0;
+        for (int j = 0; j <= r; j++) q[n] += ldexp(q[n - j - 1], -(j + 1));
     }
-    return entropy;
+    double result = q[bits];
+    free(q);
+    return result;
 }
 
-// Function to encrypt data with DES in CBC mode and calculate entropy
-double compute_des_cbc_entropy(size_t data_size, uint64_t key) {
-    uint8_t *data = (uint8_t *)malloc(data_size);
-    uint8_t iv[8];
-    double total_entropy = 0.0;
+static void init_tables(void) {
+    for (int t = 0; t < 3; t++) {
+        LongestRunTable *table = &longest_tables[t];
+        double below = 0;
+        for (int k = 0; k < table->classes - 1; k++) {
+            double at_most = longest_run_at_most(table->block_bits, table->low + k);
+            table->pi[k] = at_most - below;
+            below = at_most;
+        }
+        table->pi[table->classes - 1] = 1.0 - below;
+    }
 
-    if (!data) {
-        fprintf(stderr, "Memory allocation failed!\n");
-        exit(1);
+    // Per-byte run and walk tables, bits taken MSB first
+    for (int b = 0; b < 256; b++) {
+        int run = 0, best = 0, walk = 0, high = 0, low = 0;
+        lead_ones[b] = 0;
+        while (lead_ones[b] < 8 && ((b << lead_ones[b]) & 0x80)) lead_ones[b]++;
+        for (int i = 7; i >= 0; i--) {
+            int bit = (b >> i) & 1;
+            run = bit ? run + 1 : 0;
+            if (run > best) best = run;
+            walk += bit ? 1 : -1;
+            if (walk > high) high = walk;
+            if (walk < low) low = walk;
+        }
+        byte_ones[b] = (uint8_t)((walk + 8) / 2);
+        byte_transitions[b] = (uint8_t)__builtin_popcount((unsigned)(b ^ (b >> 1)) & 0x7F);
+        trail_ones[b] = (uint8_t)run;
+        max_ones[b] = (uint8_t)best;
+        walk_max[b] = (int8_t)high;
+        walk_min[b] = (int8_t)low;
+    }
+}
+
+// ================================
+//      Segments
+// ================================
+
+static Params params_for(size_t bytes) {
+    double n = 8.0 * (double)bytes;
+    Params p = {0, -1, 0, 0};
+    if (n >= 100) {
+        // M >= 20 bits and > n / 100, with fewer than 100 blocks
+        size_t block_bits = (size_t)ceil(n / 99.0);
+        if (block_bits < 20) block_bits = 20;
+        p.block_bytes = (block_bits + 7) / 8;
+    }
+    if (n >= 750000) p.longest_class = 2;
+    else if (n >= 6272) p.longest_class = 1;
+    else if (n >= 128) p.longest_class = 0;
+    // m < log2(n) - 2 for the serial test and m < log2(n) - 5 for approximate entropy
+    int log_n = (int)floor(log2(n));
+    p.serial_m = log_n - 3 < WINDOW_BITS ? log_n - 3 : WINDOW_BITS;
+    if (p.serial_m < 3) p.serial_m = 0;
+    p.apen_m = log_n - 6 < WINDOW_BITS - 1 ? log_n - 6 : WINDOW_BITS - 1;
+    if (p.apen_m < 1) p.apen_m = 0;
+    return p;
+}
+
+// Adds the windows that start in byte a and run into byte b
+static void add_pair_windows(uint64_t *windows, uint8_t a, uint8_t b, uint64_t count) {
+    unsigned pair = (unsigned)a << 8 | b;
+    for (int offset = 0; offset < 8; offset++) {
+        windows[(pair >> (7 - offset)) & ((1u << WINDOW_BITS) - 1)] += count;
     }
+}
+
+static void longest_run_classify(Segment *s, const LongestRunTable *table, int longest) {
+    int k = longest - table->low;
+    if (k < 0) k = 0;
+    if (k > table->classes - 1) k = table->classes - 1;
+    s->longest[k]++;
+}
+
+// Computes the segment of `length` bytes (at least 2). pairs is scratch for 65536 counts.
+static void analyze(const uint8_t *data, size_t length, const Params *params, Segment *s, uint32_t *pairs) {
+    memset(s, 0, sizeof(*s));
+    s->bits = 8 * (uint64_t)length;
+    s->first = data[0];
+    s->last = data[length - 1];
+
+    // The walk, sampled at block ends for block frequency (block ones = (steps + 8M) / 2)
+    int64_t walk = 0, high = 0, low = 0;
+    size_t block = params->block_bytes ? params->block_bytes : length;
+    for (size_t start = 0; start < length; start += block) {
+        size_t end = start + block < length ? start + block : length;
+        int64_t block_start = walk;
+        for (size_t i = start; i < end; i++) {
+            uint8_t b = data[i];
+            if (walk + walk_max[b] > high) high = walk + walk_max[b];
+            if (walk + walk_min[b] < low) low = walk + walk_min[b];
+            walk += 2 * byte_ones[b] - 8;
+        }
+        if (params->block_bytes && end - start == block) {
+            double pi = (double)(walk - block_start) / (16.0 * (double)block);
+            s->block_sum += pi * pi;
+            s->blocks++;
+        }
+    }
+    s->walk = walk;
+    s->walk_max = high;
+    s->walk_min = low;
+
+    // Bytes, ones, transitions and overlapping windows: byte by byte for short runs,
+    // from byte-pair counts for long ones
+    if (length < PAIR_TABLE_MIN || !pairs) {
+        for (size_t i = 0; i + 1 < length; i++) {
+            uint8_t a = data[i], b = data[i + 1];
+            s->bytes[a]++;
+            s->transitions += byte_transitions[a] + ((a & 1) ^ (b >> 7));
+            add_pair_windows(s->windows, a, b, 1);
+        }
+    } else {
+        memset(pairs, 0, 65536 * sizeof(uint32_t));
+        for (size_t i = 0; i + 1 < length; i++) pairs[(unsigned)data[i] << 8 | data[i + 1]]++;
+        for (unsigned pair = 0; pair < 65536; pair++) {
+            if (!pairs[pair]) continue;
+            uint8_t a = (uint8_t)(pair >> 8), b = (uint8_t)pair;
+            s->bytes[a] += pairs[pair];
+            s->transitions += (uint64_t)pairs[pair] * (byte_transitions[a] + ((a & 1) ^ (b >> 7)));
+            add_pair_windows(s->windows, a, b, pairs[pair]);
+        }
+    }
+    s->bytes[s->last]++;
+    s->transitions += byte_transitions[s->last];
+    for (int v = 0; v < 256; v++) s->ones += s->bytes[v] * byte_ones[v];
+
+    // Longest run of ones per whole block
+    if (params->longest_class >= 0) {
+        const LongestRunTable *table = &longest_tables[params->longest_class];
+        size_t block = (size_t)table->block_bits / 8;
+        for (size_t start = 0; start + block <= length; start += block) {
+            int best = 0, run = 0;
+            for (size_t i = start; i < start + block; i++) {
+                uint8_t b = data[i];
+                int through = run + lead_ones[b];
+                if (through > best) best = through;
+                if (max_ones[b] > best) best = max_ones[b];
+                run = b == 0xFF ? through : trail_ones[b];
+            }
+            longest_run_classify(s, table, best);
+        }
+    }
+}
+
+// Appends b to a (a stays the earlier part of the sequence)
+static void join(Segment *a, const Segment *b) {
+    a->transitions += b->transitions + ((a->last & 1) ^ (b->first >> 7));
+    add_pair_windows(a->windows, a->last, b->first, 1);
+    if (a->walk + b->walk_max > a->walk_max) a->walk_max = a->walk + b->walk_max;
+    if (a->walk + b->walk_min < a->walk_min) a->walk_min = a->walk + b->walk_min;
+    a->walk += b->walk;
+    a->bits += b->bits;
+    a->ones += b->ones;
+    a->block_sum += b->block_sum;
+    a->blocks += b->blocks;
+    for (int k = 0; k < 7; k++) a->longest[k] += b->longest[k];
+    for (int w = 0; w < (1 << WINDOW_BITS); w++) a->windows[w] += b->windows[w];
+    for (int v = 0; v < 256; v++) a->bytes[v] += b->bytes[v];
+    a->last = b->last;
+}
+
+// ================================
+//      Tests
+// ================================
+
+// Sum of (count - expected)^2 over the m-bit patterns, times 2^m / n (the serial psi^2)
+static long double psi_squared(const uint64_t *windows, int m, uint64_t n) {
+    if (m <= 0) return 0;
+    long double expected = (long double)n / (1 << m), sum = 0;
+    int shift = WINDOW_BITS - m;
+    for (int v = 0; v < (1 << m); v++) {
+        uint64_t count = 0;
+        for (int suffix = 0; suffix < (1 << shift); suffix++) count += windows[(v << shift) | suffix];
+        long double d = (long double)count - expected;
+        sum += d * d;
+    }
+    return sum / expected;
+}
 
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        // Generate random data for plaintext
-        for (size_t i = 0; i < data_size; i++) {
-            data[i] = (uint8_t)(rand() % 256);
+// phi_m of the approximate entropy test
+static long double apen_phi(const uint64_t *windows, int m, uint64_t n) {
+    long double phi = 0;
+    int shift = WINDOW_BITS - m;
+    for (int v = 0; v < (1 << m); v++) {
+        uint64_t count = 0;
+        for (int suffix = 0; suffix < (1 << shift); suffix++) count += windows[(v << shift) | suffix];
+        if (count) {
+            long double pi = (long double)count / n;
+            phi += pi * logl(pi);
         }
+    }
+    return phi;
+}
 
-        // Generate random IV
-        for (int i = 0; i < 8; i++) {
-            iv[i] = rand() & 0xFF;
+static double cusum_p_value(double n, double z) {
+    if (z <= 0) return 1.0;
+    double sqrt_n = sqrt(n), sum1 = 0, sum2 = 0;
+    // Terms beyond |(4k +- 1) z / sqrt(n)| > 40 vanish
+    double limit = floor(10.0 * sqrt_n / z) + 1;
+    double k_hi = floor((n / z - 1) / 4), k_lo1 = ceil((-n / z + 1) / 4), k_lo2 = ceil((-n / z - 3) / 4);
+    if (k_hi > limit) k_hi = limit;
+    if (k_lo1 < -limit) k_lo1 = -limit;
+    if (k_lo2 < -limit) k_lo2 = -limit;
+    for (double k = k_lo1; k <= k_hi; k++) {
+        sum1 += normal_cdf((4 * k + 1) * z / sqrt_n) - normal_cdf((4 * k - 1) * z / sqrt_n);
+    }
+    for (double k = k_lo2; k <= k_hi; k++) {
+        sum2 += normal_cdf((4 * k + 3) * z / sqrt_n) - normal_cdf((4 * k + 1) * z / sqrt_n);
+    }
+    double p = 1.0 - sum1 + sum2;
+    return p < 0 ? 0 : p > 1 ? 1 : p;
+}
+
+// Runs the battery on a complete sequence; p-values of tests that do not apply are NAN
+static void finish(const Segment *segment, const Params *params, double *p, double *entropy) {
+    double n = (double)segment->bits;
+    for (int t = 0; t < TEST_COUNT; t++) p[t] = NAN;
+
+    *entropy = 0;
+    for (int v = 0; v < 256; v++) {
+        if (segment->bytes[v]) {
+            double q = (double)segment->bytes[v] / (n / 8);
+            *entropy -= q * log2(q);
         }
+    }
+    if (n < 100) return;
 
-        // Encrypt using DES in CBC mode
-        des_cbc_encrypt(data, data_size, key, iv);
+    double s_obs = fabs(2.0 * (double)segment->ones - n) / sqrt(n);
+    p[T_FREQUENCY] = erfc(s_obs / sqrt(2.0));
 
-        // Compute entropy of the ciphertext
-        total_entropy += calculate_entropy(data, data_size);
+    if (segment->blocks > 0) {
+        double chi2 = 4.0 * 8.0 * (double)params->block_bytes * segment->block_sum;
+        p[T_BLOCK_FREQUENCY] = igamc((double)segment->blocks / 2, chi2 / 2);
     }
 
-    // Compute and return overall average entropy
-    double avg_entropy = total_entropy / ITERATIONS;
+    double pi = (double)segment->ones / n;
+    if (fabs(pi - 0.5) >= 2.0 / sqrt(n)) {
+        p[T_RUNS] = 0.0;    // Frequency prerequisite failed
+    } else {
+        double runs = (double)segment->transitions + 1;
+        p[T_RUNS] = erfc(fabs(runs - 2 * n * pi * (1 - pi)) / (2 * sqrt(2 * n) * pi * (1 - pi)));
+    }
+
+    if (params->longest_class >= 0) {
+        const LongestRunTable *table = &longest_tables[params->longest_class];
+        double blocks = 0, chi2 = 0;
+        for (int k = 0; k < table->classes; k++) blocks += (double)segment->longest[k];
+        for (int k = 0; k < table->classes; k++) {
+            double expected = blocks * table->pi[k];
+            chi2 += ((double)segment->longest[k] - expected) * ((double)segment->longest[k] - expected) / expected;
+        }
+        p[T_LONGEST_RUN] = igamc((table->classes - 1) / 2.0, chi2 / 2);
+    }
+
+    // The pattern tests treat the sequence as circular: close it with the first byte
+    if (params->serial_m || params->apen_m) {
+        uint64_t windows[1 << WINDOW_BITS];
+        memcpy(windows, segment->windows, sizeof(windows));
+        add_pair_windows(windows, segment->last, segment->first, 1);
+
+        int m = params->serial_m;
+        if (m) {
+            long double psi_m = psi_squared(windows, m, segment->bits);
+            long double psi_m1 = psi_squared(windows, m - 1, segment->bits);
+            long double psi_m2 = psi_squared(windows, m - 2, segment->bits);
+            p[T_SERIAL_1] = igamc(ldexp(1.0, m - 2), (double)(psi_m - psi_m1) / 2);
+            p[T_SERIAL_2] = igamc(ldexp(1.0, m - 3), (double)(psi_m - 2 * psi_m1 + psi_m2) / 2);
+        }
+        m = params->apen_m;
+        if (m) {
+            long double apen = apen_phi(windows, m, segment->bits) - apen_phi(windows, m + 1, segment->bits);
+            double chi2 = (double)(2.0L * segment->bits * (logl(2.0L) - apen));
+            p[T_APPROXIMATE_ENTROPY] = igamc(ldexp(1.0, m - 1), chi2 / 2);
+        }
+    }
+
+    double forward = fmax((double)segment->walk_max, (double)-segment->walk_min);
+    double reverse = fmax((double)(segment->walk - segment->walk_min), (double)(segment->walk_max - segment->walk));
+    p[T_CUSUM_FORWARD] = cusum_p_value(n, forward);
+    p[T_CUSUM_REVERSE] = cusum_p_value(n, reverse);
+}
+
+static void record(RowStats *stats, const double *p, double entropy) {
+    stats->sequences++;
+    stats->entropy += entropy;
+    for (int t = 0; t < TEST_COUNT; t++) {
+        if (isnan(p[t])) continue;
+        stats->tested[t]++;
+        stats->passed[t] += p[t] >= ALPHA;
+        stats->p_sum[t] += p[t];
+        int bin = (int)(p[t] * 10);
+        stats->bins[t][bin > 9 ? 9 : bin]++;
+    }
+}
+
+static void merge_stats(RowStats *to, const RowStats *from) {
+    to->sequences += from->sequences;
+    to->entropy += from->entropy;
+    for (int t = 0; t < TEST_COUNT; t++) {
+        to->tested[t] += from->tested[t];
+        to->passed[t] += from->passed[t];
+        to->p_sum[t] += from->p_sum[t];
+        for (int b = 0; b < 10; b++) to->bins[t][b] += from->bins[t][b];
+    }
+}
+
+// The row's p-value column: the sequence's own, or the uniformity of many
+static double row_p_value(const RowStats *stats, int t) {
+    if (stats->tested[t] == 1) return stats->p_sum[t];
+    if (stats->tested[t] < 55) return NAN;
+    double expected = (double)stats->tested[t] / 10, chi2 = 0;
+    for (int b = 0; b < 10; b++) {
+        chi2 += ((double)stats->bins[t][b] - expected) * ((double)stats->bins[t][b] - expected) / expected;
+    }
+    return igamc(4.5, chi2 / 2);
+}
+
+// ================================
+//      Stream Workers
+// ================================
+
+static void generate_chunk(Battery *b, uint64_t chunk, uint8_t *data, DES_CbcStream *streams) {
+    uint64_t state = b->seed ^ (chunk * 0xD1B54A32D192ED03ULL);
+    uint64_t first_block = chunk * (CHUNK_BYTES / 8);
+
+    for (size_t i = 0; i < CHUNK_BYTES / 8; i++) {
+        uint64_t word = b->plaintext == PLAIN_RANDOM ? splitmix64(&state)
+                        : b->plaintext == PLAIN_COUNTER ? first_block + i : 0;
+        if (b->mode == MODE_ECB && b->plaintext == PLAIN_ZERO) word = first_block + i;
+        des_uint64_to_be_bytes(word, data + 8 * i);
+    }
+
+    if (b->mode == MODE_CTR) {
+        uint8_t nonce[8];
+        des_uint64_to_be_bytes(b->seed << 32, nonce);
+        des_ctr_xcrypt(data, CHUNK_BYTES, &b->round_keys, nonce, chunk * CHUNK_BYTES);
+    } else if (b->mode == MODE_ECB) {
+        des_ecb_encrypt(data, CHUNK_BYTES, &b->round_keys);
+    } else {
+        size_t count = 0;
+        for (size_t start = 0; start < CHUNK_BYTES; start += b->record) {
+            DES_CbcStream *s = &streams[count++];
+            s->data = data + start;
+            s->length = CHUNK_BYTES - start < b->record ? CHUNK_BYTES - start : b->record;
+            s->round_keys = &b->round_keys;
+            des_uint64_to_be_bytes(splitmix64(&state), s->iv);
+        }
+        des_cbc_encrypt_streams(streams, count);
+    }
+}
+
+static void *battery_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Battery *b = w->battery;
+    uint8_t *data = (uint8_t *)malloc(CHUNK_BYTES);
+    DES_CbcStream *streams = (DES_CbcStream *)malloc((CHUNK_BYTES / 8) * sizeof(DES_CbcStream));
+    uint32_t *pairs = (uint32_t *)malloc(65536 * sizeof(uint32_t));
+    Segment *segment = (Segment *)malloc(sizeof(Segment));
+    if (!data || !streams || !pairs || !segment) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (;;) {
+        uint64_t chunk = atomic_fetch_add(&b->next_chunk, 1);
+        if (chunk >= b->chunks) break;
+        generate_chunk(b, chunk, data, streams);
+
+        if (b->chunk_segments) analyze(data, CHUNK_BYTES, &b->chunk_params, &b->chunk_segments[chunk], pairs);
+
+        // Short rows: the first sequences of the chunk, until the row has enough
+        for (int r = 0; r < b->row_count; r++) {
+            Row *row = &b->rows[r];
+            if (row->size > CHUNK_BYTES || chunk >= row->chunks_used) continue;
+            uint64_t per_chunk = CHUNK_BYTES / row->size;
+            uint64_t count = row->sequences - chunk * per_chunk < per_chunk ? row->sequences - chunk * per_chunk
+                                                                           : per_chunk;
+            for (uint64_t k = 0; k < count; k++) {
+                double p[TEST_COUNT], entropy;
+                analyze(data + k * row->size, row->size, &row->params, segment, pairs);
+                finish(segment, &row->params, p, &entropy);
+                record(&w->stats[r], p, entropy);
+            }
+        }
+    }
     free(data);
-    return avg_entropy;
+    free(streams);
+    free(pairs);
+    free(segment);
+    return NULL;
 }
 
-int main() {
-    srand(time(NULL));
-    uint64_t key = 0x133457799BBCDFF1;
+// Sequences longer than a chunk, joined from the chunk segments in order
+static void run_long_rows(Battery *b) {
+    Segment *sequence = (Segment *)malloc(sizeof(Segment));
+    if (!sequence) return;
+    for (int r = 0; r < b->row_count; r++) {
+        Row *row = &b->rows[r];
+        if (row->size <= CHUNK_BYTES) continue;
+        uint64_t span = row->size / CHUNK_BYTES;
+        for (uint64_t k = 0; k < row->sequences; k++) {
+            double p[TEST_COUNT], entropy;
+            *sequence = b->chunk_segments[k * span];
+            for (uint64_t c = 1; c < span; c++) join(sequence, &b->chunk_segments[k * span + c]);
+            finish(sequence, &row->params, p, &entropy);
+            record(&row->stats, p, entropy);
+        }
+    }
+    free(sequence);
+}
 
-    // Data sizes in bytes
-    size_t data_sizes[] = {8, 16, 50, 200, 500, 1024, 100 * 1024, 250 * 1024, 500 * 1024, 750 * 1024, 1024 * 1024};
-    const char *size_labels[] = {"8B", "16B", "50B", "200B", "500B", "1KB", "100KB", "250KB", "500KB", "750KB", "1MB"};
+// ================================
+//      Main
+// ================================
 
-    // Open the CSV file to write results
-    FILE *csv_file = fopen("des_cbc_entropy_results.csv", "w");
-    if (!csv_file) {
-        fprintf(stderr, "Failed to open CSV file for writing.\n");
-        return 1;
+static uint64_t parse_size(const char *text) {
+    char *end;
+    uint64_t value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    if (*end == 'M' || *end == 'm') value <<= 20;
+    if (*end == 'G' || *end == 'g') value <<= 30;
+    return value;
+}
+
+// Size label in the form plot_entropy.py parses (B, KB or MB)
+static void size_label(size_t size, char *label, size_t capacity) {
+    if (size >= (1 << 20) && size % (1 << 20) == 0) snprintf(label, capacity, "%zuMB", size >> 20);
+    else if (size >= 1024 && size % 1024 == 0) snprintf(label, capacity, "%zuKB", size >> 10);
+    else snprintf(label, capacity, "%zuB", size);
+}
+
+static int add_row(Battery *b, uint64_t size, uint64_t cap) {
+    uint64_t total = b->chunks * CHUNK_BYTES;
+    if (size < 8 || size > total) return 0;
+    if (size > CHUNK_BYTES) size -= size % CHUNK_BYTES;
+    for (int r = 0; r < b->row_count; r++) {
+        if (b->rows[r].size == size) return 0;
     }
+    if (b->row_count == MAX_ROWS) return -1;
 
-    // Write the header row
-    fprintf(csv_file, "Data Size (Bytes),Average Entropy (bits/byte)\n");
+    Row *row = &b->rows[b->row_count++];
+    memset(row, 0, sizeof(*row));
+    row->size = (size_t)size;
+    row->params = params_for(row->size);
+    if (size <= CHUNK_BYTES) {
+        uint64_t per_chunk = CHUNK_BYTES / size;
+        row->sequences = per_chunk * b->chunks < cap ? per_chunk * b->chunks : cap;
+        row->chunks_used = (row->sequences + per_chunk - 1) / per_chunk;
+    } else {
+        row->sequences = b->chunks / (size / CHUNK_BYTES);
+        // Chunk segments carry one block-frequency block and 8192-bit longest-run blocks
+        row->params.block_bytes = CHUNK_BYTES;
+        row->params.longest_class = 2;
+    }
+    return 0;
+}
 
-    // Loop through each data size and compute entropy, then write to CSV
-    for (int i = 0; i < sizeof(data_sizes) / sizeof(data_sizes[0]); i++) {
-        double avg_entropy = compute_des_cbc_entropy(data_sizes[i], key);
-        fprintf(csv_file, "%s,%.6f\n", size_labels[i], avg_entropy);
+static void usage(void) {
+    fprintf(stderr,
+            "usage: des_entropy [--bytes N] [--sizes LIST] [--sequences N] [--mode cbc|ctr|ecb]\n"
+            "                   [--plaintext zero|counter|random] [--record N] [--key HEX]\n"
+            "                   [--threads N] [--seed N] [--csv FILE]\n");
+}
+
+int main(int argc, char **argv) {
+    static Battery battery;
+    Battery *b = &battery;
+    uint64_t bytes = 1ULL << 30, cap = 200, key = 0x133457799BBCDFF1ULL;
+    const char *sizes = NULL, *mode = "cbc", *plaintext = "zero", *csv_path = "des_cbc_entropy_results.csv";
+    int threads = des_get_threads();
+
+    b->record = 2048;
+    b->seed = (uint64_t)time(NULL);
+    for (int i = 1; i < argc; i += 2) {
+        const char *arg = argv[i], *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage();
+            return 2;
+        }
+        if (strcmp(arg, "--bytes") == 0) bytes = parse_size(value);
+        else if (strcmp(arg, "--sizes") == 0) sizes = value;
+        else if (strcmp(arg, "--sequences") == 0) cap = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--mode") == 0) mode = value;
+        else if (strcmp(arg, "--plaintext") == 0) plaintext = value;
+        else if (strcmp(arg, "--record") == 0) b->record = (size_t)parse_size(value) & ~(size_t)7;
+        else if (strcmp(arg, "--key") == 0) key = strtoull(value, NULL, 16);
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) b->seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--csv") == 0) csv_path = value;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (strcmp(mode, "cbc") == 0) b->mode = MODE_CBC;
+    else if (strcmp(mode, "ctr") == 0) b->mode = MODE_CTR;
+    else if (strcmp(mode, "ecb") == 0) b->mode = MODE_ECB;
+    else mode = NULL;
+    if (strcmp(plaintext, "zero") == 0) b->plaintext = PLAIN_ZERO;
+    else if (strcmp(plaintext, "counter") == 0) b->plaintext = PLAIN_COUNTER;
+    else if (strcmp(plaintext, "random") == 0) b->plaintext = PLAIN_RANDOM;
+    else plaintext = NULL;
+    if (!mode || !plaintext || b->record < 8 || cap < 1) {
+        usage();
+        return 2;
     }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
 
-    // Close the CSV file
-    fclose(csv_file);
+    init_tables();
+    des_key_setup(key, &b->round_keys);
+    b->chunks = bytes / CHUNK_BYTES > 0 ? bytes / CHUNK_BYTES : 1;
+    b->chunk_params = params_for(CHUNK_BYTES);
+    b->chunk_params.block_bytes = CHUNK_BYTES;
 
-    printf("Entropy results have been written to des_cbc_entropy_results.csv\n");
+    // The original size sweep, then 16 MB, 256 MB and the whole stream
+    char default_sizes[] = "8,16,50,200,500,1K,100K,250K,500K,750K,1M,16M,256M";
+    char *list = sizes ? strdup(sizes) : default_sizes;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if (add_row(b, parse_size(item), cap) != 0) {
+            fprintf(stderr, "too many sizes (at most %d)\n", MAX_ROWS);
+            return 2;
+        }
+    }
+    if (!sizes) add_row(b, b->chunks * CHUNK_BYTES, cap);
+    for (int r = 0; r < b->row_count; r++) {
+        if (b->rows[r].size > CHUNK_BYTES && !b->chunk_segments) {
+            b->chunk_segments = (Segment *)malloc(b->chunks * sizeof(Segment));
+            if (!b->chunk_segments) {
+                fprintf(stderr, "out of memory for %llu chunk summaries\n", (unsigned long long)b->chunks);
+                return 1;
+            }
+        }
+    }
+
+    printf("DES randomness battery: %llu MB of %s ciphertext (%s plaintext), %d thread%s, seed %llu\n",
+           (unsigned long long)b->chunks, mode, plaintext, threads, threads == 1 ? "" : "s",
+           (unsigned long long)b->seed);
+
+    des_set_threads(1);
+    static Worker workers[MAX_THREADS];
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        workers[t].battery = b;
+        pthread_create(&workers[t].thread, NULL, battery_worker, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        for (int r = 0; r < b->row_count; r++) merge_stats(&b->rows[r].stats, &workers[t].stats[r]);
+    }
+    run_long_rows(b);
+    double elapsed = now_seconds() - start;
+
+    // Report: pass rates per row, then the CSV
+    printf("\n%-8s %6s %9s", "size", "seqs", "entropy");
+    for (int t = 0; t < TEST_COUNT; t++) printf(" %8s", test_short[t]);
+    printf("\n");
+    for (int r = 0; r < b->row_count; r++) {
+        const Row *row = &b->rows[r];
+        char label[32];
+        size_label(row->size, label, sizeof(label));
+        printf("%-8s %6llu %9.6f", label, (unsigned long long)row->stats.sequences,
+               row->stats.sequences ? row->stats.entropy / row->stats.sequences : 0.0);
+        for (int t = 0; t < TEST_COUNT; t++) {
+            if (row->stats.tested[t] == 0) printf(" %8s", "-");
+            else if (row->stats.tested[t] == 1) printf(" %8.4f", row->stats.p_sum[t]);
+            else printf(" %7.1f%%", 100.0 * row->stats.passed[t] / row->stats.tested[t]);
+        }
+        printf("\n");
+    }
+    printf("(single sequences show the p-value, several the share passing at alpha = %.2f)\n", ALPHA);
+    printf("Time: %.2fs (%.1f MB/s)\n", elapsed, b->chunks * (CHUNK_BYTES / 1e6) / elapsed);
+
+    FILE *csv = fopen(csv_path, "w");
+    if (!csv) {
+        perror(csv_path);
+        return 1;
+    }
+    fprintf(csv, "Data Size (Bytes),Average Entropy (bits/byte),Sequences");
+    for (int t = 0; t < TEST_COUNT; t++) fprintf(csv, ",%s Pass Rate,%s P-value", test_names[t], test_names[t]);
+    fprintf(csv, "\n");
+    for (int r = 0; r < b->row_count; r++) {
+        const Row *row = &b->rows[r];
+        char label[32];
+        size_label(row->size, label, sizeof(label));
+        fprintf(csv, "%s,%.6f,%llu", label, row->stats.sequences ? row->stats.entropy / row->stats.sequences : 0.0,
+                (unsigned long long)row->stats.sequences);
+        for (int t = 0; t < TEST_COUNT; t++) {
+            double p = row_p_value(&row->stats, t);
+            if (row->stats.tested[t] == 0) fprintf(csv, ",,");
+            else if (isnan(p)) fprintf(csv, ",%.4f,", (double)row->stats.passed[t] / row->stats.tested[t]);
+            else fprintf(csv, ",%.4f,%.6f", (double)row->stats.passed[t] / row->stats.tested[t], p);
+        }
+        fprintf(csv, "\n");
+    }
+    int failed = ferror(csv);
+    if (fclose(csv) != 0 || failed) {
+        perror(csv_path);
+        return 1;
+    }
+    printf("Results written to %s\n", csv_path);
 
+    if (sizes) free(list);
+    free(b->chunk_segments);
     return 0;
 }
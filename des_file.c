@@ -0,0 +1,705 @@
+/*
+ * Streaming File Encryption
+ * Encrypts or decrypts files of any size with DES or 3DES (EDE) in ECB, CBC or CTR
+ * mode. ECB and CBC use PKCS#7 padding; CTR output is as long as the input. For CBC
+ * and CTR the IV (or initial counter block) is stored as the first 8 bytes of the
+ * encrypted file: random unless --iv is given, and read back on decryption.
+ *
+ * The file is processed by three threads connected by a fixed ring of chunk
+ * buffers: the reader fills chunks from a sliding mmap window of the input (or from
+ * large reads into page-aligned buffers for pipes and with --no-mmap), the cipher
+ * thread runs them through the library (which spreads the batched modes over its
+ * own thread pool), and the writer writes them out in order. Memory use is
+ * depth * chunk bytes whatever the file size.
+ *
+ * Usage: des_file (-e | -d) --key HEX [--key2 HEX [--key3 HEX]] [--mode ecb|cbc|ctr]
+ *                 [--iv HEX] [--chunk KB] [--depth N] [--threads N] [--no-mmap]
+ *                 [--stats] INPUT OUTPUT
+ *        des_file --bench MB [--dir DIR] [--mode ...] [--chunk KB] [--depth N]
+ *
+ * --key2 selects 3DES (two-key when --key3 is omitted). INPUT and OUTPUT may be "-"
+ * for stdin and stdout. --bench writes an MB-sized file to DIR (default /tmp) and
+ * compares cat and dd against the encryption and decryption pipelines. POSIX only.
+ */
+
+#include "des.h"
+#include "des_tool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_CHUNK (4 << 20)     // Bytes per pipeline buffer
+#define DEFAULT_DEPTH 4             // Buffers in the ring
+#define CHUNK_ALIGN (64 * 1024)     // Chunk sizes are rounded to this (a page multiple)
+#define MAX_DEPTH 64
+
+typedef enum { MODE_ECB, MODE_CBC, MODE_CTR } CipherMode;
+
+static const char *const mode_names[] = {"ecb", "cbc", "ctr"};
+
+// Stages of the pipeline, in the order a chunk passes through them
+enum { STAGE_READ, STAGE_CIPHER, STAGE_WRITE, STAGE_COUNT };
+
+typedef struct {
+    uint8_t *data;          // Page-aligned, chunk + DES_BLOCK_SIZE bytes (room for padding)
+    size_t length;
+    int last;               // Final chunk of the stream
+} Slot;
+
+typedef struct {
+    // Options
+    int encrypt;
+    CipherMode mode;
+    int triple;
+    DES_RoundKeys keys;
+    DES3_RoundKeys keys3;
+    uint8_t iv[8];
+    int have_iv;
+    size_t chunk;
+    int depth;
+    int use_mmap;
+
+    // Files
+    int in_fd;
+    int out_fd;
+    uint64_t in_offset;     // Input byte the reader continues from
+    uint64_t in_size;       // Input size when it is a regular file
+    int mapped;             // Reader uses mmap windows
+
+    // Ring: chunk n lives in slots[n % depth]; done[s] counts chunks stage s has finished
+    Slot slots[MAX_DEPTH];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint64_t done[STAGE_COUNT];
+    int failed;
+    char error[256];
+
+    // Cipher state carried from chunk to chunk
+    uint8_t chain[8];       // CBC: previous ciphertext block; CTR: counter block
+    uint64_t stream_offset; // CTR keystream offset
+
+    // Writer state: when unpadding, the last plaintext block is held back
+    uint8_t carry[8];
+    int have_carry;
+
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} Pipeline;
+
+// Peak resident set size in MB
+static double peak_rss_mb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static int padded(const Pipeline *p) {
+    return p->mode != MODE_CTR;
+}
+
+// ================================
+//      Ring Buffer
+// ================================
+
+// Records the first error and wakes every stage so the pipeline drains
+static void pipeline_fail(Pipeline *p, const char *format, ...) {
+    va_list args;
+    pthread_mutex_lock(&p->lock);
+    if (!p->failed) {
+        va_start(args, format);
+        vsnprintf(p->error, sizeof(p->error), format, args);
+        va_end(args);
+        p->failed = 1;
+    }
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Blocks until chunk `seq` is ready for `stage`: the previous stage has finished it, or
+// for the reader, the writer has released the slot. Returns NULL once the pipeline failed.
+static Slot *stage_wait(Pipeline *p, int stage, uint64_t seq) {
+    Slot *slot = NULL;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        if (p->failed) break;
+        int ready = stage == STAGE_READ ? seq < p->done[STAGE_WRITE] + (uint64_t)p->depth
+                                        : seq < p->done[stage - 1];
+        if (ready) {
+            slot = &p->slots[seq % (uint64_t)p->depth];
+            break;
+        }
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return slot;
+}
+
+// Hands the stage's current chunk on to the next stage
+static void stage_done(Pipeline *p, int stage) {
+    pthread_mutex_lock(&p->lock);
+    p->done[stage]++;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// ================================
+//      File I/O
+// ================================
+
+static int read_full(int fd, uint8_t *buffer, size_t length, size_t *got) {
+    *got = 0;
+    while (*got < length) {
+        ssize_t n = read(fd, buffer + *got, length - *got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        *got += (size_t)n;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const uint8_t *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, buffer, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        buffer += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Copies input bytes [offset, offset + length) through a temporary mapping; the window
+// is unmapped straight away so resident memory does not grow with the file
+static int read_mapped(Pipeline *p, uint8_t *buffer, uint64_t offset, size_t length) {
+    static long page = 0;
+    if (!page) page = sysconf(_SC_PAGESIZE);
+    uint64_t base = offset - offset % (uint64_t)page;
+    size_t span = length + (size_t)(offset - base);
+
+    void *map = mmap(NULL, span, PROT_READ, MAP_PRIVATE, p->in_fd, (off_t)base);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, span, MADV_WILLNEED);
+    memcpy(buffer, (const uint8_t *)map + (offset - base), length);
+    munmap(map, span);
+    return 0;
+}
+
+// ================================
+//      Pipeline Stages
+// ================================
+
+static void *reader_main(void *arg) {
+    Pipeline *p = arg;
+
+    for (uint64_t seq = 0;; seq++) {
+        Slot *slot = stage_wait(p, STAGE_READ, seq);
+        if (!slot) break;
+
+        size_t length;
+        if (p->mapped) {
+            uint64_t left = p->in_size > p->in_offset ? p->in_size - p->in_offset : 0;
+            length = left < p->chunk ? (size_t)left : p->chunk;
+            if (length > 0 && read_mapped(p, slot->data, p->in_offset, length) != 0) {
+                pipeline_fail(p, "mmap: %s", strerror(errno));
+                break;
+            }
+            slot->last = p->in_offset + length >= p->in_size;
+        } else {
+            if (read_full(p->in_fd, slot->data, p->chunk, &length) != 0) {
+                pipeline_fail(p, "read: %s", strerror(errno));
+                break;
+            }
+            slot->last = length < p->chunk;
+        }
+        p->in_offset += length;
+        p->bytes_in += length;
+
+        // PKCS#7: 1-8 bytes, each holding the pad length
+        if (slot->last && p->encrypt && padded(p)) {
+            size_t pad = DES_BLOCK_SIZE - length % DES_BLOCK_SIZE;
+            memset(slot->data + length, (int)pad, pad);
+            length += pad;
+        }
+        slot->length = length;
+
+        int last = slot->last;
+        stage_done(p, STAGE_READ);
+        if (last) break;
+    }
+    return NULL;
+}
+
+static void crypt_chunk(Pipeline *p, uint8_t *data, size_t length) {
+    uint8_t saved[8];
+
+    switch (p->mode) {
+    case MODE_ECB:
+        if (p->triple) {
+            if (p->encrypt) des3_ecb_encrypt(data, length, &p->keys3);
+            else des3_ecb_decrypt(data, length, &p->keys3);
+        } else {
+            if (p->encrypt) des_ecb_encrypt(data, length, &p->keys);
+            else des_ecb_decrypt(data, length, &p->keys);
+        }
+        break;
+    case MODE_CBC:
+        if (length == 0) break;
+        if (p->encrypt) {
+            if (p->triple) des3_cbc_encrypt(data, length, &p->keys3, p->chain);
+            else des_cbc_encrypt_with_keys(data, length, &p->keys, p->chain);
+            memcpy(p->chain, data + length - 8, 8);
+        } else {
+            memcpy(saved, data + length - 8, 8);
+            if (p->triple) des3_cbc_decrypt(data, length, &p->keys3, p->chain);
+            else des_cbc_decrypt_with_keys(data, length, &p->keys, p->chain);
+            memcpy(p->chain, saved, 8);
+        }
+        break;
+    case MODE_CTR:
+        if (p->triple) des3_ctr_xcrypt(data, length, &p->keys3, p->chain, p->stream_offset);
+        else des_ctr_xcrypt(data, length, &p->keys, p->chain, p->stream_offset);
+        p->stream_offset += length;
+        break;
+    }
+}
+
+static void *cipher_main(void *arg) {
+    Pipeline *p = arg;
+
+    for (uint64_t seq = 0;; seq++) {
+        Slot *slot = stage_wait(p, STAGE_CIPHER, seq);
+        if (!slot) break;
+        if (padded(p) && slot->length % DES_BLOCK_SIZE != 0) {
+            pipeline_fail(p, "input is not a whole number of %d-byte blocks", DES_BLOCK_SIZE);
+            break;
+        }
+        crypt_chunk(p, slot->data, slot->length);
+
+        int last = slot->last;
+        stage_done(p, STAGE_CIPHER);
+        if (last) break;
+    }
+    return NULL;
+}
+
+static int write_out(Pipeline *p, const uint8_t *data, size_t length) {
+    if (write_full(p->out_fd, data, length) != 0) {
+        pipeline_fail(p, "write: %s", strerror(errno));
+        return -1;
+    }
+    p->bytes_out += length;
+    return 0;
+}
+
+// Writes a decrypted padded chunk. The final plaintext block may be the last block of a
+// full chunk (the chunk after it is then empty), so the last block of every chunk is
+// held back until the next one shows whether it carries the padding.
+static int write_unpadded(Pipeline *p, const Slot *slot) {
+    uint8_t *tail = slot->length > 0 ? slot->data + slot->length - 8 : p->carry;
+
+    if (!slot->last) {
+        if (p->have_carry && write_out(p, p->carry, 8) != 0) return -1;
+        if (write_out(p, slot->data, slot->length - 8) != 0) return -1;
+        memcpy(p->carry, tail, 8);
+        p->have_carry = 1;
+        return 0;
+    }
+
+    if (slot->length == 0 && !p->have_carry) {
+        pipeline_fail(p, "input is empty (no padding block)");
+        return -1;
+    }
+    int pad = tail[7];
+    int valid = pad >= 1 && pad <= 8;
+    for (int i = 8 - pad; valid && i < 8; i++) valid = tail[i] == pad;
+    if (!valid) {
+        pipeline_fail(p, "bad padding (wrong key or corrupt input)");
+        return -1;
+    }
+    if (slot->length == 0) return write_out(p, p->carry, (size_t)(8 - pad));
+    if (p->have_carry && write_out(p, p->carry, 8) != 0) return -1;
+    return write_out(p, slot->data, slot->length - (size_t)pad);
+}
+
+static void *writer_main(void *arg) {
+    Pipeline *p = arg;
+
+    for (uint64_t seq = 0;; seq++) {
+        Slot *slot = stage_wait(p, STAGE_WRITE, seq);
+        if (!slot) break;
+        int result = !p->encrypt && padded(p) ? write_unpadded(p, slot)
+                                               : write_out(p, slot->data, slot->length);
+        if (result != 0) break;
+
+        int last = slot->last;
+        stage_done(p, STAGE_WRITE);
+        if (last) break;
+    }
+    return NULL;
+}
+
+// ================================
+//      Driver
+// ================================
+
+static void fill_random(uint8_t *bytes, size_t length) {
+    int fd = open("/dev/urandom", O_RDONLY);
+    size_t got = 0;
+    if (fd >= 0) {
+        read_full(fd, bytes, length, &got);
+        close(fd);
+    }
+    if (got < length) {
+        uint64_t state = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+        for (size_t i = 0; i < length; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            bytes[i] = (uint8_t)(state >> 56);
+        }
+    }
+}
+
+// Encrypts or decrypts `input` into `output` ("-" for stdin/stdout). Returns 0 on
+// success; on failure prints the error and removes a partially written output file.
+static int run_pipeline(Pipeline *p, const char *input, const char *output) {
+    pthread_t threads[STAGE_COUNT];
+    void *(*stages[STAGE_COUNT])(void *) = {reader_main, cipher_main, writer_main};
+    struct stat st;
+    int to_stdout = strcmp(output, "-") == 0;
+    int status = 0;
+
+    p->in_fd = strcmp(input, "-") == 0 ? STDIN_FILENO : open(input, O_RDONLY);
+    if (p->in_fd < 0) {
+        fprintf(stderr, "%s: %s\n", input, strerror(errno));
+        return -1;
+    }
+    p->out_fd = to_stdout ? STDOUT_FILENO : open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (p->out_fd < 0) {
+        fprintf(stderr, "%s: %s\n", output, strerror(errno));
+        if (p->in_fd != STDIN_FILENO) close(p->in_fd);
+        return -1;
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->changed, NULL);
+    memset(p->done, 0, sizeof(p->done));
+    p->failed = 0;
+    p->have_carry = 0;
+    p->stream_offset = 0;
+    p->in_offset = 0;
+    p->bytes_in = p->bytes_out = 0;
+    p->mapped = p->use_mmap && fstat(p->in_fd, &st) == 0 && S_ISREG(st.st_mode);
+    p->in_size = p->mapped ? (uint64_t)st.st_size : 0;
+    posix_fadvise(p->in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // IV header: written in front of the ciphertext, read back before decrypting
+    if (p->mode != MODE_ECB) {
+        if (p->encrypt) {
+            if (!p->have_iv) fill_random(p->iv, 8);
+            if (write_full(p->out_fd, p->iv, 8) != 0) {
+                pipeline_fail(p, "write: %s", strerror(errno));
+            }
+        } else {
+            size_t got;
+            if (read_full(p->in_fd, p->iv, 8, &got) != 0 || got < 8) {
+                pipeline_fail(p, "input too short for the IV header");
+            }
+            p->in_offset = 8;
+        }
+        memcpy(p->chain, p->iv, 8);
+    }
+
+    for (int i = 0; i < p->depth && !p->failed; i++) {
+        if (posix_memalign((void **)&p->slots[i].data, 4096, p->chunk + DES_BLOCK_SIZE) != 0) {
+            p->slots[i].data = NULL;
+            pipeline_fail(p, "out of memory");
+        }
+    }
+
+    if (!p->failed) {
+        for (int s = 0; s < STAGE_COUNT; s++) pthread_create(&threads[s], NULL, stages[s], p);
+        for (int s = 0; s < STAGE_COUNT; s++) pthread_join(threads[s], NULL);
+    }
+
+    if (p->failed) {
+        fprintf(stderr, "des_file: %s\n", p->error);
+        status = -1;
+    }
+    for (int i = 0; i < p->depth; i++) {
+        free(p->slots[i].data);
+        p->slots[i].data = NULL;
+    }
+    if (p->in_fd != STDIN_FILENO) close(p->in_fd);
+    if (!to_stdout && close(p->out_fd) != 0 && status == 0) {
+        fprintf(stderr, "%s: %s\n", output, strerror(errno));
+        status = -1;
+    }
+    if (status != 0 && !to_stdout) unlink(output);
+    pthread_cond_destroy(&p->changed);
+    pthread_mutex_destroy(&p->lock);
+    return status;
+}
+
+// ================================
+//      Benchmark
+// ================================
+
+// Writes `bytes` of pseudo-random data, 1 MB at a time
+static int make_test_file(const char *path, uint64_t bytes) {
+    uint8_t *buffer = malloc(1 << 20);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int status = fd < 0 || !buffer ? -1 : 0;
+
+    for (uint64_t done = 0; status == 0 && done < bytes; done += 1 << 20) {
+        size_t length = bytes - done < (1 << 20) ? (size_t)(bytes - done) : (1 << 20);
+        for (size_t i = 0; i < length; i += 8) {
+            state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+            memcpy(buffer + i, &state, 8);
+        }
+        status = write_full(fd, buffer, length);
+    }
+    if (fd >= 0) close(fd);
+    free(buffer);
+    return status;
+}
+
+static int files_equal(const char *a, const char *b) {
+    uint8_t *x = malloc(1 << 20), *y = malloc(1 << 20);
+    int fa = open(a, O_RDONLY), fb = open(b, O_RDONLY);
+    int equal = x && y && fa >= 0 && fb >= 0;
+
+    while (equal) {
+        size_t na, nb;
+        if (read_full(fa, x, 1 << 20, &na) != 0 || read_full(fb, y, 1 << 20, &nb) != 0) equal = 0;
+        else if (na != nb || memcmp(x, y, na) != 0) equal = 0;
+        else if (na == 0) break;
+    }
+    if (fa >= 0) close(fa);
+    if (fb >= 0) close(fb);
+    free(x);
+    free(y);
+    return equal;
+}
+
+static void bench_row(const char *label, double seconds, uint64_t bytes, double baseline) {
+    double rate = bytes / seconds / 1e6;
+    printf("%-28s %8.2f s %9.1f MB/s", label, seconds, rate);
+    if (baseline > 0) printf("   %5.1f%% of cat", 100.0 * rate / baseline);
+    printf("\n");
+}
+
+static double bench_shell(const char *command) {
+    double start = now_seconds();
+    if (system(command) != 0) fprintf(stderr, "command failed: %s\n", command);
+    return now_seconds() - start;
+}
+
+static double bench_pipeline(Pipeline *p, int encrypt, int use_mmap, const char *input,
+                             const char *output) {
+    p->encrypt = encrypt;
+    p->use_mmap = use_mmap;
+    double start = now_seconds();
+    if (run_pipeline(p, input, output) != 0) exit(1);
+    return now_seconds() - start;
+}
+
+static int run_benchmark(Pipeline *p, uint64_t megabytes, const char *dir) {
+    char plain[512], cipher[512], copy[512], command[2048];
+    uint64_t bytes = megabytes << 20;
+    int ok = 1;
+
+    snprintf(plain, sizeof(plain), "%s/des_file_bench.%d.in", dir, (int)getpid());
+    snprintf(cipher, sizeof(cipher), "%s/des_file_bench.%d.enc", dir, (int)getpid());
+    snprintf(copy, sizeof(copy), "%s/des_file_bench.%d.out", dir, (int)getpid());
+    if (make_test_file(plain, bytes) != 0) {
+        fprintf(stderr, "%s: cannot create test file\n", plain);
+        return 1;
+    }
+
+    printf("%llu MB file in %s, mode %s, %d x %zu KB buffers, kernel %s, %d threads\n",
+           (unsigned long long)megabytes, dir, mode_names[p->mode], p->depth, p->chunk >> 10,
+           des_kernel_name(des_get_kernel()), des_get_threads());
+    printf("(the file is in the page cache for every run)\n\n");
+
+    snprintf(command, sizeof(command), "cat '%s' > '%s'", plain, copy);
+    bench_shell(command);   // Warms the page cache
+    double seconds = bench_shell(command);
+    double cat_rate = bytes / seconds / 1e6;
+    bench_row("cat", seconds, bytes, 0);
+    snprintf(command, sizeof(command), "dd if='%s' of='%s' bs=1M status=none", plain, copy);
+    bench_row("dd bs=1M", bench_shell(command), bytes, cat_rate);
+
+    for (int triple = 0; triple <= 1; triple++) {
+        char label[64];
+        const char *name = triple ? "3DES" : "DES";
+        p->triple = triple;
+
+        snprintf(label, sizeof(label), "%s encrypt (mmap)", name);
+        bench_row(label, bench_pipeline(p, 1, 1, plain, cipher), bytes, cat_rate);
+        snprintf(label, sizeof(label), "%s encrypt (read)", name);
+        bench_row(label, bench_pipeline(p, 1, 0, plain, cipher), bytes, cat_rate);
+        snprintf(label, sizeof(label), "%s decrypt (mmap)", name);
+        bench_row(label, bench_pipeline(p, 0, 1, cipher, copy), bytes, cat_rate);
+        if (!files_equal(plain, copy)) {
+            printf("%s round trip FAILED\n", name);
+            ok = 0;
+        }
+    }
+    printf("\nPeak RSS %.1f MB\n", peak_rss_mb());
+
+    unlink(plain);
+    unlink(cipher);
+    unlink(copy);
+    return ok ? 0 : 1;
+}
+
+// ================================
+//      Main
+// ================================
+
+static int parse_hex64(const char *text, uint64_t *value) {
+    char *end;
+    errno = 0;
+    *value = strtoull(text, &end, 16);
+    return errno == 0 && end != text && *end == '\0' ? 0 : -1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: des_file (-e | -d) --key HEX [--key2 HEX [--key3 HEX]] [--mode ecb|cbc|ctr]\n"
+            "                [--iv HEX] [--chunk KB] [--depth N] [--threads N] [--no-mmap]\n"
+            "                [--stats] INPUT OUTPUT\n"
+            "       des_file --bench MB [--dir DIR] [--mode ecb|cbc|ctr] [--chunk KB] [--depth N]\n");
+}
+
+int main(int argc, char **argv) {
+    static Pipeline pipeline;
+    Pipeline *p = &pipeline;
+    uint64_t keys[3] = {0x133457799BBCDFF1ULL, 0, 0};
+    int have_key[3] = {0, 0, 0};
+    const char *paths[2] = {NULL, NULL};
+    const char *dir = "/tmp";
+    uint64_t bench_mb = 0;
+    int path_count = 0;
+    int direction = -1;
+    int stats = 0;
+
+    p->mode = MODE_CBC;
+    p->chunk = DEFAULT_CHUNK;
+    p->depth = DEFAULT_DEPTH;
+    p->use_mmap = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-e") == 0) {
+            direction = 1;
+        } else if (strcmp(arg, "-d") == 0) {
+            direction = 0;
+        } else if (strcmp(arg, "--no-mmap") == 0) {
+            p->use_mmap = 0;
+        } else if (strcmp(arg, "--stats") == 0) {
+            stats = 1;
+        } else if (value && (strcmp(arg, "--key") == 0 || strcmp(arg, "--key2") == 0 ||
+                             strcmp(arg, "--key3") == 0)) {
+            int k = arg[5] ? arg[5] - '1' : 0;
+            if (parse_hex64(value, &keys[k]) != 0) {
+                fprintf(stderr, "bad key: %s\n", value);
+                return 1;
+            }
+            have_key[k] = 1;
+            i++;
+        } else if (value && strcmp(arg, "--iv") == 0) {
+            uint64_t iv;
+            if (parse_hex64(value, &iv) != 0) {
+                fprintf(stderr, "bad IV: %s\n", value);
+                return 1;
+            }
+            des_uint64_to_be_bytes(iv, p->iv);
+            p->have_iv = 1;
+            i++;
+        } else if (value && strcmp(arg, "--mode") == 0) {
+            int m = 0;
+            while (m < 3 && strcmp(value, mode_names[m]) != 0) m++;
+            if (m == 3) {
+                fprintf(stderr, "unknown mode: %s\n", value);
+                return 1;
+            }
+            p->mode = (CipherMode)m;
+            i++;
+        } else if (value && strcmp(arg, "--chunk") == 0) {
+            p->chunk = (size_t)strtoull(value, NULL, 10) << 10;
+            i++;
+        } else if (value && strcmp(arg, "--depth") == 0) {
+            p->depth = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--threads") == 0) {
+            des_set_threads(atoi(value));
+            i++;
+        } else if (value && strcmp(arg, "--bench") == 0) {
+            bench_mb = strtoull(value, NULL, 10);
+            i++;
+        } else if (value && strcmp(arg, "--dir") == 0) {
+            dir = value;
+            i++;
+        } else if (arg[0] != '-' || strcmp(arg, "-") == 0) {
+            if (path_count == 2) {
+                usage();
+                return 1;
+            }
+            paths[path_count++] = arg;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    p->chunk = (p->chunk + CHUNK_ALIGN - 1) / CHUNK_ALIGN * CHUNK_ALIGN;
+    if (p->chunk == 0) p->chunk = CHUNK_ALIGN;
+    if (p->depth < 2) p->depth = 2;
+    if (p->depth > MAX_DEPTH) p->depth = MAX_DEPTH;
+
+    if (bench_mb > 0) {
+        keys[1] = 0x23456789ABCDEF01ULL;
+        keys[2] = 0x456789ABCDEF0123ULL;
+        des_key_setup(keys[0], &p->keys);
+        des3_key_setup(keys[0], keys[1], keys[2], &p->keys3);
+        return run_benchmark(p, bench_mb, dir);
+    }
+
+    if (direction < 0 || !have_key[0] || path_count != 2 || (have_key[2] && !have_key[1])) {
+        usage();
+        return 1;
+    }
+    p->encrypt = direction;
+    p->triple = have_key[1];
+    if (p->triple) {
+        des3_key_setup(keys[0], keys[1], have_key[2] ? keys[2] : keys[0], &p->keys3);
+    } else {
+        des_key_setup(keys[0], &p->keys);
+    }
+
+    double start = now_seconds();
+    if (run_pipeline(p, paths[0], paths[1]) != 0) return 1;
+    double seconds = now_seconds() - start;
+
+    if (stats) {
+        fprintf(stderr, "%s %llu bytes -> %llu bytes in %.3f s (%.1f MB/s), %s input, "
+                "peak RSS %.1f MB\n",
+                p->encrypt ? "encrypted" : "decrypted", (unsigned long long)p->bytes_in,
+                (unsigned long long)p->bytes_out, seconds, p->bytes_in / seconds / 1e6,
+                p->mapped ? "mmap" : "read", peak_rss_mb());
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#ifndef DES_INTERNAL_H
+#define DES_INTERNAL_H
+
+// Declarations shared between the library sources (des.c, des_bitslice.c, ...).
+// Not part of the public API in des.h.
+
+#include "des.h"
+
+// ================================
+//      S-Box Contents
+// ================================
+
+// Shared by the DES_SBOXn definitions in des.c and the bitsliced core, which needs
+// them as compile-time constants to fold each S-box into a fixed gate network
+#define DES_SBOX1_VALUES { \
+    14,  4, 13,  1,  2, 15, 11,  8,  3, 10,  6, 12,  5,  9,  0,  7, \
+    0, 15,  7,  4, 14,  2, 13,  1, 10,  6, 12, 11,  9,  5,  3,  8, \
+    4,  1, 14,  8, 13,  6,  2, 11, 15, 12,  9,  7,  3, 10,  5,  0, \
+    15, 12,  8,  2,  4,  9,  1,  7,  5, 11,  3, 14, 10,  0,  6, 13 }
+
+#define DES_SBOX2_VALUES { \
+    15,  1,  8, 14,  6, 11,  3,  4,  9,  7,  2, 13, 12,  0,  5, 10, \
+    3, 13,  4,  7, 15,  2,  8, 14, 12,  0,  1, 10,  6,  9, 11,  5, \
+    0, 14,  7, 11, 10,  4, 13,  1,  5,  8, 12,  6,  9,  3,  2, 15, \
+    13,  8, 10,  1,  3, 15,  4,  2, 11,  6,  7, 12,  0,  5, 14,  9 }
+
+#define DES_SBOX3_VALUES { \
+    10,  0,  9, 14,  6,  3, 15,  5,  1, 13, 12,  7, 11,  4,  2,  8, \
+    13,  7,  0,  9,  3,  4,  6, 10,  2,  8,  5, 14, 12, 11, 15,  1, \
+    13,  6,  4,  9,  8, 15,  3,  0, 11,  1,  2, 12,  5, 10, 14,  7, \
+    1, 10, 13,  0,  6,  9,  8,  7,  4, 15, 14,  3, 11,  5,  2, 12 }
+
+#define DES_SBOX4_VALUES { \
+    7, 13, 14,  3,  0,  6,  9, 10,  1,  2,  8,  5, 11, 12,  4, 15, \
+    13,  8, 11,  5,  6, 15,  0,  3,  4,  7,  2, 12,  1, 10, 14,  9, \
+    10,  6,  9,  0, 12, 11,  7, 13, 15,  1,  3, 14,  5,  2,  8,  4, \
+    3, 15,  0,  6, 10,  1, 13,  8,  9,  4,  5, 11, 12,  7,  2, 14 }
+
+#define DES_SBOX5_VALUES { \
+    2, 12,  4,  1,  7, 10, 11,  6,  8,  5,  3, 15, 13,  0, 14,  9, \
+    14, 11,  2, 12,  4,  7, 13,  1,  5,  0, 15, 10,  3,  9,  8,  6, \
+    4,  2,  1, 11, 10, 13,  7,  8, 15,  9, 12,  5,  6,  3,  0, 14, \
+    11,  8, 12,  7,  1, 14,  2, 13,  6, 15,  0,  9, 10,  4,  5,  3 }
+
+#define DES_SBOX6_VALUES { \
+    12,  1, 10, 15,  9,  2,  6,  8,  0, 13,  3,  4, 14,  7,  5, 11, \
+    10, 15,  4,  2,  7, 12,  9,  5,  6,  1, 13, 14,  0, 11,  3,  8, \
+    9, 14, 15,  5,  2,  8, 12,  3,  7,  0,  4, 10,  1, 13, 11,  6, \
+    4,  3,  2, 12,  9,  5, 15, 10, 11, 14,  1,  7,  6,  0,  8, 13 }
+
+#define DES_SBOX7_VALUES { \
+    4, 11,  2, 14, 15,  0,  8, 13,  3, 12,  9,  7,  5, 10,  6,  1, \
+    13,  0, 11,  7,  4,  9,  1, 10, 14,  3,  5, 12,  2, 15,  8,  6, \
+    1,  4, 11, 13, 12,  3,  7, 14, 10, 15,  6,  8,  0,  5,  9,  2, \
+    6, 11, 13,  8,  1,  4, 10,  7,  9,  5,  0, 15, 14,  2,  3, 12 }
+
+#define DES_SBOX8_VALUES { \
+    13,  2,  8,  4,  6, 15, 11,  1, 10,  9,  3, 14,  5,  0, 12,  7, \
+    1, 15, 13,  8, 10,  3,  7,  4, 12,  5,  6, 11,  0, 14,  9,  2, \
+    7, 11,  4,  1,  9, 12, 14,  2,  0,  6, 10, 13, 15,  3,  5,  8, \
+    2,  1, 14,  7,  4, 10,  8, 13, 15, 12,  9,  0,  3,  5,  6, 11 }
+
+// ================================
+//      Bitslice Wiring (des_bitslice.c)
+// ================================
+
+// Key slice (0-based DES key bit) feeding bit i of the round r subkey
+extern uint8_t des_bs_key_index[16][48];
+
+// Position in the Feistel output that S-box output bit q lands on after P
+extern uint8_t des_bs_p_inverse[32];
+
+/**
+ * @brief Builds the wiring tables above; safe to call more than once.
+ */
+void des_bs_init_tables(void);
+
+/**
+ * @brief Transposes a 64x64 bit matrix in place: afterwards m[i] bit j is the old m[j] bit i.
+ * @param m 64 words.
+ */
+void des_bs_transpose64(uint64_t m[64]);
+
+
+// ================================
+//      Kernel Dispatch (des_simd.c)
+// ================================
+
+// Largest slice word (AVX-512) and the matching alignment for state buffers
+#define DES_KERNEL_MAX_LANES 512
+#define DES_KERNEL_ALIGN 64
+
+// Bitsliced kernel operations on opaque slice buffers of 64 words of `lanes` bits
+typedef struct {
+    DES_Kernel id;
+    const char *name;
+    int lanes;
+    void (*load)(void *slices, const uint64_t *values);       // `lanes` host-order values in
+    void (*store)(const void *slices, uint64_t *values);      // `lanes` host-order values out
+    void (*broadcast)(void *slices, uint64_t value);          // Same value in every lane
+    void (*crypt)(void *slices, const void *key_slices, int mode);
+    void (*match)(const void *slices, uint64_t value, uint64_t *masks);  // lanes / 64 lane masks
+    // Early-reject key trial (see DES_KeyTest): target_count * lanes / 64 survivor masks;
+    // NULL on kernels where crypt + match is faster
+    void (*key_filter)(const void *slices, const void *key_slices, const uint32_t *targets,
+                       int target_count, uint64_t *masks);
+    // Encryption with the first `rounds` rounds only; a non-NULL tap (rounds + 1 buffers of
+    // 64 slices) receives each state L_r || R_r, the first right after IP
+    void (*crypt_rounds)(void *slices, const void *key_slices, int rounds, void *tap);
+} DES_KernelOps;
+
+extern const DES_KernelOps des_bs64_ops;
+
+/**
+ * @brief Returns the operations of the active kernel, or NULL when it is the scalar path.
+ */
+const DES_KernelOps *des_kernel_ops(void);
+
+/**
+ * @brief Overwrites one lane of a slice buffer (cheaper than a full load for a single lane).
+ * @param ops Kernel the buffer belongs to.
+ * @param slices Slice buffer.
+ * @param lane Lane index below ops->lanes.
+ * @param value Host-order 64-bit value for that lane.
+ */
+void des_kernel_set_lane(const DES_KernelOps *ops, void *slices, int lane, uint64_t value);
+
+/**
+ * @brief Runs ECB over as many whole kernel passes as fit in `blocks`.
+ * @param keys Key of each stage: one for DES, K1 K2 K3 for EDE triple DES (stage s
+ *        runs in `mode` for even s and in the opposite direction for odd s).
+ * @param stages 1 or 3.
+ * @return Number of blocks processed; the caller finishes the remainder.
+ */
+size_t des_kernel_ecb(const uint8_t *input, uint8_t *output, size_t blocks,
+                      const uint64_t *keys, int stages, int mode);
+
+/**
+ * @brief Reduced-round form of des_kernel_ecb (encryption, one DES stage).
+ * @param rounds 1 to 16.
+ * @param states NULL, or blocks * (rounds + 1) values receiving the states as in
+ *        des_ecb_encrypt_rounds.
+ * @return Number of blocks processed; the caller finishes the remainder.
+ */
+size_t des_kernel_ecb_rounds(const uint8_t *input, uint8_t *output, size_t blocks,
+                             uint64_t key, int rounds, uint64_t *states);
+
+/**
+ * @brief Key-agile form of des_kernel_ecb: block i runs under keys[i] (one key per lane).
+ * @return Number of blocks processed; the caller finishes the remainder.
+ */
+size_t des_kernel_ecb_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output,
+                               size_t blocks, int mode);
+
+// ================================
+//      Block Helpers (des.c)
+// ================================
+
+/**
+ * @brief ECB over any number of blocks: whole passes on the active kernel, the rest on
+ *        the scalar path four blocks at a time. Single-threaded.
+ * @param input Pointer to blocks * 8 bytes.
+ * @param output Pointer to store blocks * 8 bytes (may alias input).
+ */
+void des_ecb_blocks(const uint8_t *input, uint8_t *output, size_t blocks,
+                    const DES_RoundKeys *round_keys, int mode);
+
+/**
+ * @brief Triple-DES form of des_ecb_blocks.
+ */
+void des3_ecb_blocks(const uint8_t *input, uint8_t *output, size_t blocks,
+                     const DES3_RoundKeys *round_keys, int mode);
+
+// ================================
+//      Thread Pool (des_threads.c)
+// ================================
+
+// Buffers smaller than this per thread are not worth splitting
+#define DES_PARALLEL_MIN_BYTES (64 * 1024)
+
+// Cap on the thread count: des_set_threads and the DES_THREADS/CPU-count default both
+// clamp to it, so arrays indexed by slice can be sized with it
+#define DES_MAX_THREADS 256
+
+typedef void (*des_task_fn)(void *arg, size_t task);
+
+/**
+ * @brief Runs fn(arg, 0..tasks-1) across the pool (the caller takes part) and waits.
+ *        Nested calls run serially on the calling thread.
+ */
+void des_parallel_for(size_t tasks, des_task_fn fn, void *arg);
+
+// ================================
+//      Profiling Hooks (des_profile.c)
+// ================================
+
+// Stages timed by DES_PROFILE_BEGIN/END; names in des_profile.c
+typedef enum {
+    DES_STAGE_KEY_SCHEDULE,
+    DES_STAGE_IP,
+    DES_STAGE_ROUNDS,
+    DES_STAGE_FP,
+    DES_STAGE_ECB,
+    DES_STAGE_KERNEL,
+    DES_STAGE_TRANSPOSE,
+    DES_STAGE_BITSLICE_ROUNDS,
+    DES_STAGE_CBC_ENCRYPT,
+    DES_STAGE_CBC_DECRYPT,
+    DES_STAGE_CBC_STREAMS,
+    DES_STAGE_CBC_UPDATE,
+    DES_STAGE_CTR,
+    DES_STAGE_KEY_TEST,
+    DES_STAGE_MULTIKEY,
+    DES_STAGE_THREAD_POOL,
+    DES_STAGE_COUNT
+} DES_Stage;
+
+// Compiled out unless the library is built with -DDES_PROFILE
+#ifdef DES_PROFILE
+void des_profile_begin(DES_Stage stage);
+void des_profile_end(DES_Stage stage);
+#define DES_PROFILE_BEGIN(stage) des_profile_begin(stage)
+#define DES_PROFILE_END(stage) des_profile_end(stage)
+#else
+#define DES_PROFILE_BEGIN(stage) ((void)0)
+#define DES_PROFILE_END(stage) ((void)0)
+#endif
+
+#endif // DES_INTERNAL_H
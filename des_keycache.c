@@ -0,0 +1,120 @@
+#include "des_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================================
+//      Key-Schedule Cache
+// ================================
+
+// Set-associative: a key hashes to one set of DES_KEY_CACHE_WAYS entries and replaces the
+// least recently used one there. Sets are interleaved over DES_KEY_CACHE_SHARDS locks, so
+// lookups of different keys rarely contend; a miss expands the key outside the lock.
+
+#define DES_KEY_CACHE_WAYS 8
+#define DES_KEY_CACHE_SHARDS 64
+
+// Parity bits do not reach the schedule, so keys differing only there share an entry
+#define DES_KEY_PARITY_BITS 0x0101010101010101ULL
+
+typedef struct {
+    uint64_t keys[DES_KEY_CACHE_WAYS];
+    uint64_t stamps[DES_KEY_CACHE_WAYS];    // Last use (shard tick), 0 = empty
+    DES_RoundKeys round_keys[DES_KEY_CACHE_WAYS];
+} DES_KeyCacheSet;
+
+typedef struct {
+    _Alignas(DES_KERNEL_ALIGN) pthread_mutex_t lock;
+    uint64_t tick;
+    uint64_t hits, misses, evictions, entries;
+} DES_KeyCacheShard;
+
+struct DES_KeyCache {
+    DES_KeyCacheShard shards[DES_KEY_CACHE_SHARDS];
+    DES_KeyCacheSet *sets;
+    size_t set_mask;
+};
+
+DES_KeyCache *des_key_cache_create(size_t capacity) {
+    size_t sets = 1;
+    while (sets * DES_KEY_CACHE_WAYS < capacity) sets <<= 1;
+
+    size_t size = (sizeof(DES_KeyCache) + DES_KERNEL_ALIGN - 1) / DES_KERNEL_ALIGN * DES_KERNEL_ALIGN;
+    DES_KeyCache *cache = (DES_KeyCache *)aligned_alloc(DES_KERNEL_ALIGN, size);
+    if (!cache) return NULL;
+    memset(cache, 0, sizeof(*cache));
+    cache->sets = (DES_KeyCacheSet *)calloc(sets, sizeof(DES_KeyCacheSet));
+    if (!cache->sets) {
+        free(cache);
+        return NULL;
+    }
+    cache->set_mask = sets - 1;
+    for (int s = 0; s < DES_KEY_CACHE_SHARDS; s++) pthread_mutex_init(&cache->shards[s].lock, NULL);
+    return cache;
+}
+
+void des_key_cache_destroy(DES_KeyCache *cache) {
+    if (!cache) return;
+    for (int s = 0; s < DES_KEY_CACHE_SHARDS; s++) pthread_mutex_destroy(&cache->shards[s].lock);
+    free(cache->sets);
+    free(cache);
+}
+
+// Way holding `key` in the set, or -1
+static inline int des_key_cache_find(const DES_KeyCacheSet *set, uint64_t key) {
+    for (int w = 0; w < DES_KEY_CACHE_WAYS; w++) {
+        if (set->stamps[w] && set->keys[w] == key) return w;
+    }
+    return -1;
+}
+
+void des_key_cache_setup(DES_KeyCache *cache, uint64_t key, DES_RoundKeys *round_keys) {
+    uint64_t tag = key & ~DES_KEY_PARITY_BITS;
+    size_t index = (size_t)((tag * 0x9E3779B97F4A7C15ULL) >> 32) & cache->set_mask;
+    DES_KeyCacheSet *set = &cache->sets[index];
+    DES_KeyCacheShard *shard = &cache->shards[index % DES_KEY_CACHE_SHARDS];
+
+    pthread_mutex_lock(&shard->lock);
+    int way = des_key_cache_find(set, tag);
+    if (way >= 0) {
+        set->stamps[way] = ++shard->tick;
+        *round_keys = set->round_keys[way];
+        shard->hits++;
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+    shard->misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    des_key_setup(key, round_keys);
+
+    pthread_mutex_lock(&shard->lock);
+    // Another thread may have inserted the key meanwhile
+    way = des_key_cache_find(set, tag);
+    if (way < 0) {
+        way = 0;
+        for (int w = 1; w < DES_KEY_CACHE_WAYS; w++) {
+            if (set->stamps[w] < set->stamps[way]) way = w;
+        }
+        if (set->stamps[way]) shard->evictions++;
+        else shard->entries++;
+        set->keys[way] = tag;
+        set->round_keys[way] = *round_keys;
+    }
+    set->stamps[way] = ++shard->tick;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void des_key_cache_stats(DES_KeyCache *cache, DES_KeyCacheStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->capacity = (cache->set_mask + 1) * DES_KEY_CACHE_WAYS;
+    for (int s = 0; s < DES_KEY_CACHE_SHARDS; s++) {
+        DES_KeyCacheShard *shard = &cache->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entries;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
@@ -0,0 +1,417 @@
+/*
+ * DES Linear Cryptanalysis Counters
+ * Matsui's algorithms 1 and 2 on reduced-round DES: known plaintext/ciphertext pairs are
+ * generated on the fly under one key, encrypted in batches on the bulk kernels
+ * (des_ecb_encrypt_rounds) across threads, and each thread counts how often a linear
+ * approximation holds; the counters are merged at the end.
+ *
+ * Usage: des_linear [--algorithm 1|2] [--rounds R] [--input-mask HEX] [--output-mask HEX]
+ *                   [--key-mask R:HEX[,R:HEX...]] [--pairs N] [--key HEX] [--top K]
+ *                   [--threads N] [--seed N] [--lat]
+ *
+ * The approximation covers rounds 1..R and is written on the state, L || R right after
+ * IP and after round R: parity(state_0 & input mask) ^ parity(state_R & output mask)
+ * = parity of the subkey bits in --key-mask (48-bit masks per round, bit 0 the last
+ * subkey bit, as in Matsui's numbering). The default is Matsui's 3-round approximation
+ * built from NS5(16, 15) = 12 on rounds 1 and 3, which holds with probability ~0.70.
+ *
+ * Algorithm 1 counts the approximation on R-round pairs (parities packed 64 pairs to a word
+ * and popcounted), estimates its bias and recovers the key parity. Algorithm 2 encrypts
+ * R + 1 rounds, and for every guess of the last-round subkey bits of the S-boxes feeding
+ * the output mask's left half (at most two, 4096 guesses) peels off the last round; each
+ * thread only histograms the S-box inputs and the remaining parity, so the per-guess
+ * counters are built once at the end. The guesses are ranked by bias and the rank of the
+ * true subkey is reported. N takes K/M/G/T suffixes or 2^E (default 16M).
+ *
+ * The linear approximation tables of the eight S-boxes come from des_sbox_lat (--lat prints
+ * them in full).
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "des.h"
+#include "des_tool.h"
+
+#define BATCH_PAIRS 4096
+#define MAX_BOXES 2  // Last-round S-boxes guessed by algorithm 2
+#define MAX_TOP 4096
+
+typedef struct {
+    int algorithm, rounds;
+    uint64_t pairs, key, seed;
+    uint64_t plain_mask;        // Block-domain mask of the plaintext side
+    uint64_t cipher_mask;       // Block-domain mask of the ciphertext side (peeled part for algorithm 2)
+    int boxes, box[MAX_BOXES];  // Algorithm 2: guessed S-boxes
+    uint8_t input_bits[MAX_BOXES][6];  // Ciphertext bit (0 = LSB) feeding each S-box input bit
+    atomic_uint_fast64_t next;  // First pair of the next unclaimed batch
+} Job;
+
+typedef struct {
+    pthread_t thread;
+    Job *job;
+    uint64_t pairs;
+    uint64_t zeros;             // Algorithm 1: pairs with even parity
+    uint64_t *histogram;        // Algorithm 2: [S-box inputs][remaining parity]
+} Worker;
+
+typedef struct {
+    uint32_t guess;
+    uint64_t count;
+    double bias;
+} Candidate;
+
+static inline uint64_t parity64(uint64_t x) {
+    x ^= x >> 32;
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    return (0x6996 >> (x & 0xF)) & 1;
+}
+
+// Block-domain mask of a state mask (IP and FP are bit permutations, so parities follow
+// the bits): state 0 is IP(P), the state after the last round is IP(C) with halves swapped
+static uint64_t state_to_block(uint64_t mask, int swap) {
+    uint64_t block;
+    if (swap) mask = (mask << 32) | (mask >> 32);
+    des_apply_permutation(&block, mask, DES_FINAL_MESSAGE_PERMUTATION, 64);
+    return block;
+}
+
+// S-box output for a 6-bit group as the Feistel function sees it
+static uint32_t sbox_output(int box, uint32_t group) {
+    uint32_t row = ((group >> 4) & 2) | (group & 1);
+    return DES_SBOXES[box][row * 16 + ((group >> 1) & 0xF)];
+}
+
+// ================================
+//      Workers
+// ================================
+
+static void *linear_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Job *job = w->job;
+    int cipher_rounds = job->rounds + (job->algorithm == 2);
+    uint8_t *blocks = (uint8_t *)malloc(BATCH_PAIRS * 8);
+    uint64_t plain[BATCH_PAIRS];
+    DES_RoundKeys round_keys;
+    if (!blocks) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    des_key_setup(job->key, &round_keys);
+
+    for (;;) {
+        uint64_t first = atomic_fetch_add(&job->next, BATCH_PAIRS);
+        if (first >= job->pairs) break;
+        size_t count = job->pairs - first < BATCH_PAIRS ? (size_t)(job->pairs - first) : BATCH_PAIRS;
+
+        uint64_t state = job->seed ^ (first * 0xD1B54A32D192ED03ULL);
+        for (size_t i = 0; i < count; i++) {
+            plain[i] = splitmix64(&state);
+            des_uint64_to_be_bytes(plain[i], blocks + 8 * i);
+        }
+        des_ecb_encrypt_rounds(blocks, 8 * count, &round_keys, cipher_rounds, NULL);
+
+        if (job->algorithm == 1) {
+            // One parity bit per pair, 64 pairs to a word
+            for (size_t i = 0; i < count; i += 64) {
+                size_t n = count - i < 64 ? count - i : 64;
+                uint64_t word = 0;
+                for (size_t j = 0; j < n; j++) {
+                    uint64_t c = des_be_bytes_to_uint64(blocks + 8 * (i + j));
+                    word |= parity64((plain[i + j] & job->plain_mask) ^ (c & job->cipher_mask)) << j;
+                }
+                w->zeros += n - (uint64_t)__builtin_popcountll(word);
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                uint64_t c = des_be_bytes_to_uint64(blocks + 8 * i);
+                uint32_t index = 0;
+                for (int b = 0; b < job->boxes; b++) {
+                    for (int k = 0; k < 6; k++) index = (index << 1) | ((c >> job->input_bits[b][k]) & 1);
+                }
+                uint64_t p = parity64((plain[i] & job->plain_mask) ^ (c & job->cipher_mask));
+                w->histogram[2 * index + p]++;
+            }
+        }
+        w->pairs += count;
+    }
+    free(blocks);
+    return NULL;
+}
+
+// ================================
+//      Reporting
+// ================================
+
+static void print_lat_summary(int full) {
+    printf("S-box linear approximation tables (des_sbox_lat, NS(a, b) - 32):\n");
+    for (int box = 0; box < 8; box++) {
+        int32_t lat[64][16];
+        int best_in = 1, best_out = 1;
+        des_sbox_lat(box, lat);
+        for (int a = 1; a < 64; a++) {
+            for (int b = 1; b < 16; b++) {
+                if (abs(lat[a][b]) > abs(lat[best_in][best_out])) best_in = a, best_out = b;
+            }
+        }
+        printf("  S%d: best %02X -> %X at %+d/64 (p = %.4f)\n", box + 1, best_in, best_out,
+               lat[best_in][best_out], 0.5 + lat[best_in][best_out] / 64.0);
+        if (!full) continue;
+        printf("       ");
+        for (int b = 0; b < 16; b++) printf(" %3X", b);
+        printf("\n");
+        for (int a = 0; a < 64; a++) {
+            printf("    %02X:", a);
+            for (int b = 0; b < 16; b++) printf(" %3d", lat[a][b]);
+            printf("\n");
+        }
+    }
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    const Candidate *x = (const Candidate *)a, *y = (const Candidate *)b;
+    if (fabs(x->bias) != fabs(y->bias)) return fabs(x->bias) < fabs(y->bias) ? 1 : -1;
+    return x->guess < y->guess ? -1 : x->guess > y->guess;
+}
+
+// Parses R:HEX[,R:HEX...] into per-round 48-bit subkey masks
+static int parse_key_mask(const char *text, uint64_t masks[16]) {
+    memset(masks, 0, 16 * sizeof(uint64_t));
+    while (*text) {
+        char *end;
+        long round = strtol(text, &end, 10);
+        if (*end != ':' || round < 1 || round > 16) return -1;
+        masks[round - 1] ^= strtoull(end + 1, &end, 16) & 0xFFFFFFFFFFFFULL;
+        if (*end == ',') end++;
+        else if (*end) return -1;
+        text = end;
+    }
+    return 0;
+}
+
+static uint64_t parse_count(const char *text) {
+    char *end;
+    if (text[0] == '2' && text[1] == '^') return 1ULL << strtoul(text + 2, NULL, 10);
+    uint64_t value = strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    if (*end == 'M' || *end == 'm') value <<= 20;
+    if (*end == 'G' || *end == 'g') value <<= 30;
+    if (*end == 'T' || *end == 't') value <<= 40;
+    return value;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: des_linear [--algorithm 1|2] [--rounds R] [--input-mask HEX] [--output-mask HEX]\n"
+            "                  [--key-mask R:HEX[,R:HEX...]] [--pairs N] [--key HEX] [--top K]\n"
+            "                  [--threads N] [--seed N] [--lat]\n");
+}
+
+int main(int argc, char **argv) {
+    static Job job;
+    static Worker workers[MAX_THREADS];
+    // Matsui: X[15] ^ F(X, K)[7, 18, 24, 29] = K[22] on rounds 1 and 3, round 2 passes
+    uint64_t input_mask = 0x2104008000008000ULL, output_mask = 0x0000800021040080ULL, key_masks[16];
+    const char *key_mask_text = "1:400000,3:400000";
+    int top = 10, threads = des_get_threads(), full_lat = 0, custom_masks = 0, explicit_key_mask = 0,
+        fixed_key = 0;
+
+    job.algorithm = 1;
+    job.rounds = 3;
+    job.pairs = 16ULL << 20;
+    job.seed = (uint64_t)time(NULL);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--lat") == 0) {
+            full_lat = 1;
+            continue;
+        }
+        const char *value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) {
+            usage();
+            return 2;
+        }
+        if (strcmp(arg, "--algorithm") == 0) job.algorithm = atoi(value);
+        else if (strcmp(arg, "--rounds") == 0) job.rounds = atoi(value);
+        else if (strcmp(arg, "--input-mask") == 0) input_mask = strtoull(value, NULL, 16), custom_masks = 1;
+        else if (strcmp(arg, "--output-mask") == 0) output_mask = strtoull(value, NULL, 16), custom_masks = 1;
+        else if (strcmp(arg, "--key-mask") == 0) key_mask_text = value, explicit_key_mask = 1;
+        else if (strcmp(arg, "--pairs") == 0) job.pairs = parse_count(value);
+        else if (strcmp(arg, "--key") == 0) job.key = strtoull(value, NULL, 16), fixed_key = 1;
+        else if (strcmp(arg, "--top") == 0) top = atoi(value);
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) job.seed = strtoull(value, NULL, 0);
+        else {
+            usage();
+            return 2;
+        }
+    }
+    // The default key mask only belongs to the default approximation
+    int have_key_mask = !custom_masks || explicit_key_mask;
+    if ((job.algorithm != 1 && job.algorithm != 2) || job.rounds < 1 || job.rounds > 16 - (job.algorithm == 2) ||
+        job.pairs < 1 || top < 1 || top > MAX_TOP || (input_mask == 0 && output_mask == 0) ||
+        parse_key_mask(key_mask_text, key_masks) != 0) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (!fixed_key) {
+        uint64_t state = job.seed;
+        job.key = splitmix64(&state);
+    }
+
+    job.plain_mask = state_to_block(input_mask, 0);
+    if (job.algorithm == 1) {
+        job.cipher_mask = state_to_block(output_mask, 1);
+    } else {
+        // With (L', R') the state after round R + 1: L_R = R' ^ F(L', K), R_R = L'.
+        // The R' and L' bits go in the peeled parity, the F bits pick the guessed S-boxes.
+        uint32_t left = (uint32_t)(output_mask >> 32), right = (uint32_t)output_mask;
+        job.cipher_mask = state_to_block(((uint64_t)right << 32) | left, 1);
+        for (int i = 0; i < 32; i++) {
+            if (!((left >> (31 - i)) & 1)) continue;
+            int box = (DES_RIGHT_SUB_MESSAGE_PERMUTATION[i] - 1) / 4, known = 0;
+            for (int b = 0; b < job.boxes; b++) known |= job.box[b] == box;
+            if (known) continue;
+            if (job.boxes == MAX_BOXES) {
+                fprintf(stderr, "the output mask's left half feeds more than %d S-boxes\n", MAX_BOXES);
+                return 2;
+            }
+            job.box[job.boxes++] = box;
+        }
+        if (job.boxes == 0) {
+            fprintf(stderr, "algorithm 2 needs output mask bits in the left half\n");
+            return 2;
+        }
+        // S-box j reads L' bits 4j .. 4j + 5 (1-based, cyclic), each one ciphertext bit
+        for (int b = 0; b < job.boxes; b++) {
+            for (int k = 0; k < 6; k++) {
+                int bit = (4 * job.box[b] + k + 31) % 32 + 1;
+                uint64_t c = state_to_block(1ULL << (64 - bit), 1);
+                job.input_bits[b][k] = (uint8_t)__builtin_ctzll(c);
+            }
+        }
+    }
+
+    print_lat_summary(full_lat);
+    printf("\nAlgorithm %d: %d-round approximation %016llX -> %016llX", job.algorithm, job.rounds,
+           (unsigned long long)input_mask, (unsigned long long)output_mask);
+    if (job.algorithm == 2) {
+        printf(", round %d S-box", job.rounds + 1);
+        for (int b = 0; b < job.boxes; b++) printf(" S%d", job.box[b] + 1);
+        printf(" guessed");
+    }
+    printf("\n%llu pairs, key %016llX, kernel %s, %d thread%s, seed %llu\n", (unsigned long long)job.pairs,
+           (unsigned long long)job.key, des_kernel_name(des_get_kernel()), threads, threads == 1 ? "" : "s",
+           (unsigned long long)job.seed);
+
+    size_t histogram_size = (size_t)2 << (6 * job.boxes);
+    des_set_threads(1);
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        workers[t].job = &job;
+        if (job.algorithm == 2) {
+            workers[t].histogram = (uint64_t *)calloc(histogram_size, sizeof(uint64_t));
+            if (!workers[t].histogram) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        pthread_create(&workers[t].thread, NULL, linear_worker, &workers[t]);
+    }
+    uint64_t zeros = 0, *histogram = (uint64_t *)calloc(histogram_size, sizeof(uint64_t));
+    if (!histogram) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        zeros += workers[t].zeros;
+        if (job.algorithm == 2) {
+            for (size_t i = 0; i < histogram_size; i++) histogram[i] += workers[t].histogram[i];
+            free(workers[t].histogram);
+        }
+    }
+    double elapsed = now_seconds() - start;
+    double n = (double)job.pairs, sigma = 0.5 / sqrt(n);
+    printf("\n%.2fs, %.1f M pairs/s\n", elapsed, n / elapsed / 1e6);
+
+    uint64_t subkeys[16];
+    int key_parity = 0;
+    des_generate_round_keys(job.key, subkeys);
+    for (int r = 0; r < 16; r++) key_parity ^= (int)parity64(subkeys[r] & key_masks[r]);
+
+    if (job.algorithm == 1) {
+        double bias = (double)zeros / n - 0.5;
+        printf("\nplaintext/ciphertext parity even in %llu of %llu pairs: bias %+.6f +- %.6f (%.1f sigma)\n",
+               (unsigned long long)zeros, (unsigned long long)job.pairs, bias, 1.96 * sigma, fabs(bias) / sigma);
+        if (have_key_mask) {
+            // The approximation holds when the parity equals the key parity; assuming it holds
+            // with probability above 1/2, the majority parity is the key parity
+            double p = key_parity ? 0.5 - bias : 0.5 + bias;
+            printf("approximation with key bits holds with p = %.6f (log2 |bias| %.2f)\n", p, log2(fabs(p - 0.5)));
+            printf("key parity guess %d, actual %d: %s\n", bias < 0, key_parity,
+                   (bias < 0) == key_parity ? "recovered" : "wrong");
+        }
+    } else {
+        size_t guesses = (size_t)1 << (6 * job.boxes);
+        uint32_t out_masks[MAX_BOXES] = {0}, true_guess = 0;
+        uint32_t left = (uint32_t)(output_mask >> 32);
+        // Output mask bits of each guessed S-box, pulled back through P
+        for (int i = 0; i < 32; i++) {
+            if (!((left >> (31 - i)) & 1)) continue;
+            int bit = DES_RIGHT_SUB_MESSAGE_PERMUTATION[i] - 1;
+            for (int b = 0; b < job.boxes; b++) {
+                if (job.box[b] == bit / 4) out_masks[b] |= 1u << (3 - bit % 4);
+            }
+        }
+        for (int b = 0; b < job.boxes; b++) {
+            true_guess = (true_guess << 6) | (uint32_t)((subkeys[job.rounds] >> (42 - 6 * job.box[b])) & 0x3F);
+        }
+
+        Candidate *candidates = (Candidate *)malloc(guesses * sizeof(Candidate));
+        if (!candidates) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (size_t g = 0; g < guesses; g++) {
+            uint64_t even = 0;
+            for (size_t index = 0; index < guesses; index++) {
+                uint32_t f = 0;
+                for (int b = 0; b < job.boxes; b++) {
+                    int shift = 6 * (job.boxes - 1 - b);
+                    uint32_t group = (uint32_t)((index ^ g) >> shift) & 0x3F;
+                    f ^= (uint32_t)parity64(sbox_output(job.box[b], group) & out_masks[b]);
+                }
+                even += histogram[2 * index + f];
+            }
+            candidates[g] = (Candidate){(uint32_t)g, even, (double)even / n - 0.5};
+        }
+        qsort(candidates, guesses, sizeof(Candidate), compare_candidates);
+        size_t rank = 0;
+        while (candidates[rank].guess != true_guess) rank++;
+        if ((size_t)top > guesses) top = (int)guesses;
+
+        printf("\n%4s  %-*s %12s %10s %8s\n", "rank", 3 * job.boxes + 2, "guess", "even", "bias", "sigma");
+        for (int r = 0; r < top; r++) {
+            printf("%4d  ", r + 1);
+            for (int b = 0; b < job.boxes; b++) {
+                printf("%02X ", (candidates[r].guess >> (6 * (job.boxes - 1 - b))) & 0x3F);
+            }
+            printf("%s %12llu %+10.6f %8.1f\n", candidates[r].guess == true_guess ? "*" : " ",
+                   (unsigned long long)candidates[r].count, candidates[r].bias, fabs(candidates[r].bias) / sigma);
+        }
+        printf("true round %d subkey bits (*) ranked %zu of %zu\n", job.rounds + 1, rank + 1, guesses);
+        free(candidates);
+    }
+    free(histogram);
+    return 0;
+}
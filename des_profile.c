@@ -0,0 +1,284 @@
+#include "des_internal.h"
+#include <stdio.h>
+
+// ================================
+//      Stage Profiler
+// ================================
+
+// Compiled in with -DDES_PROFILE. Each thread keeps its own table of stage totals and a
+// stack of open stages, so a stage's self time excludes the stages nested in it (the
+// ECB loop without its rounds, a CBC call without its block encryptions, ...). Cycles
+// come from the TSC; on Linux, perf_event_open adds instructions, cache misses and
+// branch misses, read in user space with rdpmc where the kernel allows it.
+
+#ifndef DES_PROFILE
+
+void des_profile_report(FILE *stream) {
+    fprintf(stream, "DES profile: not compiled in (build the library with -DDES_PROFILE)\n");
+}
+
+void des_profile_reset(void) {
+}
+
+#else
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DES_PROFILE_CLOCK "TSC cycles"
+static inline uint64_t des_profile_clock(void) { return __rdtsc(); }
+#else
+#define DES_PROFILE_CLOCK "nanoseconds"
+static inline uint64_t des_profile_clock(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define DES_PROFILE_PERF 1
+#endif
+
+#define DES_PROFILE_COUNTERS 3      // Instructions, cache misses, branch misses
+#define DES_PROFILE_VALUES (1 + DES_PROFILE_COUNTERS)
+#define DES_PROFILE_DEPTH 16
+
+static const char *const des_stage_names[DES_STAGE_COUNT] = {
+    "key schedule", "initial permutation", "rounds", "final permutation", "ecb loop",
+    "bulk kernel", "bitslice transpose", "bitslice rounds", "cbc encrypt", "cbc decrypt",
+    "cbc streams", "cbc update/final", "ctr", "key test", "multikey batch", "thread pool",
+};
+
+typedef struct {
+    uint64_t calls;
+    uint64_t total;                             // Inclusive clock
+    uint64_t self[DES_PROFILE_VALUES];          // Exclusive clock and counters
+} DES_StageStats;
+
+typedef struct DES_ProfileThread {
+    DES_StageStats stats[DES_STAGE_COUNT];
+    struct {
+        int stage;
+        uint64_t start[DES_PROFILE_VALUES];
+        uint64_t children[DES_PROFILE_VALUES];
+    } stack[DES_PROFILE_DEPTH];
+    int depth;
+    int counters;                               // Hardware counters open on this thread
+#ifdef DES_PROFILE_PERF
+    int fds[DES_PROFILE_COUNTERS];
+    struct perf_event_mmap_page *pages[DES_PROFILE_COUNTERS];
+#endif
+    struct DES_ProfileThread *next;
+} DES_ProfileThread;
+
+static __thread DES_ProfileThread *des_profile_self;
+static DES_ProfileThread *des_profile_threads;
+static pthread_mutex_t des_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t des_profile_requested = 0;
+static int des_profile_started = 0;
+
+#ifdef DES_PROFILE_PERF
+static void des_profile_open_counters(DES_ProfileThread *t) {
+    static const uint64_t configs[DES_PROFILE_COUNTERS] = {
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    const char *env = getenv("DES_PROFILE_COUNTERS");
+    if (env && strcmp(env, "0") == 0) return;
+
+    for (int i = 0; i < DES_PROFILE_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        t->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        t->pages[i] = NULL;
+        if (t->fds[i] < 0) {
+            while (i-- > 0) {
+                if (t->pages[i]) munmap(t->pages[i], (size_t)sysconf(_SC_PAGESIZE));
+                close(t->fds[i]);
+            }
+            return;
+        }
+        // The first page of the event's ring buffer tells whether rdpmc may be used
+        void *page = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, t->fds[i], 0);
+        if (page != MAP_FAILED) t->pages[i] = (struct perf_event_mmap_page *)page;
+    }
+    t->counters = 1;
+}
+
+static uint64_t des_profile_counter(const DES_ProfileThread *t, int i) {
+#if defined(__x86_64__) || defined(__i386__)
+    const volatile struct perf_event_mmap_page *page = t->pages[i];
+    if (page && page->cap_user_rdpmc) {
+        uint32_t sequence, index;
+        uint64_t count;
+        do {
+            sequence = page->lock;
+            __sync_synchronize();
+            index = page->index;
+            count = page->offset;
+            if (index) {
+                int width = page->pmc_width;
+                int64_t pmc = (int64_t)(__rdpmc((int)index - 1) << (64 - width)) >> (64 - width);
+                count += (uint64_t)pmc;
+            }
+            __sync_synchronize();
+        } while (page->lock != sequence);
+        if (index) return count;
+    }
+#endif
+    uint64_t value = 0;
+    if (read(t->fds[i], &value, sizeof(value)) != (ssize_t)sizeof(value)) value = 0;
+    return value;
+}
+#endif
+
+static void des_profile_sample(const DES_ProfileThread *t, uint64_t *values) {
+#ifdef DES_PROFILE_PERF
+    if (t->counters) {
+        for (int i = 0; i < DES_PROFILE_COUNTERS; i++) values[1 + i] = des_profile_counter(t, i);
+    } else
+#endif
+    {
+        for (int i = 0; i < DES_PROFILE_COUNTERS; i++) values[1 + i] = 0;
+    }
+    values[0] = des_profile_clock();
+}
+
+static void des_profile_request(int signo) {
+    (void)signo;
+    des_profile_requested = 1;
+}
+
+static void des_profile_exit(void) {
+    const char *path = getenv("DES_PROFILE_OUT");
+    FILE *stream = path ? fopen(path, "w") : NULL;
+    des_profile_report(stream ? stream : stderr);
+    if (stream) fclose(stream);
+}
+
+// First use on a thread: registers its table and opens its counters; the first thread
+// also arranges the report at exit and on SIGUSR1
+static DES_ProfileThread *des_profile_thread(void) {
+    DES_ProfileThread *t = des_profile_self;
+    if (t) return t;
+
+    t = (DES_ProfileThread *)calloc(1, sizeof(DES_ProfileThread));
+    if (!t) abort();
+#ifdef DES_PROFILE_PERF
+    des_profile_open_counters(t);
+#endif
+    pthread_mutex_lock(&des_profile_lock);
+    t->next = des_profile_threads;
+    des_profile_threads = t;
+    if (!des_profile_started) {
+        des_profile_started = 1;
+        atexit(des_profile_exit);
+#ifdef SIGUSR1
+        struct sigaction current;
+        if (sigaction(SIGUSR1, NULL, &current) == 0 && current.sa_handler == SIG_DFL) {
+            signal(SIGUSR1, des_profile_request);
+        }
+#endif
+    }
+    pthread_mutex_unlock(&des_profile_lock);
+    des_profile_self = t;
+    return t;
+}
+
+void des_profile_begin(DES_Stage stage) {
+    DES_ProfileThread *t = des_profile_thread();
+    if (t->depth++ >= DES_PROFILE_DEPTH) return;
+    t->stack[t->depth - 1].stage = stage;
+    memset(t->stack[t->depth - 1].children, 0, sizeof(t->stack[0].children));
+    des_profile_sample(t, t->stack[t->depth - 1].start);
+}
+
+void des_profile_end(DES_Stage stage) {
+    DES_ProfileThread *t = des_profile_self;
+    uint64_t now[DES_PROFILE_VALUES], delta[DES_PROFILE_VALUES];
+    (void)stage;
+    if (!t || t->depth == 0) return;
+    if (--t->depth >= DES_PROFILE_DEPTH) return;
+
+    des_profile_sample(t, now);
+    DES_StageStats *stats = &t->stats[t->stack[t->depth].stage];
+    for (int i = 0; i < DES_PROFILE_VALUES; i++) {
+        delta[i] = now[i] - t->stack[t->depth].start[i];
+        stats->self[i] += delta[i] - t->stack[t->depth].children[i];
+        if (t->depth > 0) t->stack[t->depth - 1].children[i] += delta[i];
+    }
+    stats->total += delta[0];
+    stats->calls++;
+
+    if (des_profile_requested && t->depth == 0) {
+        des_profile_requested = 0;
+        des_profile_report(stderr);
+    }
+}
+
+void des_profile_report(FILE *stream) {
+    DES_StageStats sum[DES_STAGE_COUNT];
+    uint64_t all = 0;
+    int threads = 0, counters = 0;
+
+    memset(sum, 0, sizeof(sum));
+    pthread_mutex_lock(&des_profile_lock);
+    for (DES_ProfileThread *t = des_profile_threads; t; t = t->next) {
+        threads++;
+        counters |= t->counters;
+        for (int s = 0; s < DES_STAGE_COUNT; s++) {
+            sum[s].calls += t->stats[s].calls;
+            sum[s].total += t->stats[s].total;
+            for (int i = 0; i < DES_PROFILE_VALUES; i++) sum[s].self[i] += t->stats[s].self[i];
+        }
+    }
+    pthread_mutex_unlock(&des_profile_lock);
+    for (int s = 0; s < DES_STAGE_COUNT; s++) all += sum[s].self[0];
+
+    fprintf(stream, "\n=== DES stage profile (%s, %d thread%s; self excludes nested stages) ===\n",
+            DES_PROFILE_CLOCK, threads, threads == 1 ? "" : "s");
+    fprintf(stream, "%-20s %12s %12s %12s %7s", "stage", "calls", "total/call", "self/call", "self%");
+    if (counters) fprintf(stream, " %11s %6s %11s %11s", "instr/call", "IPC", "cmiss/call", "bmiss/call");
+    fprintf(stream, "\n");
+
+    for (int s = 0; s < DES_STAGE_COUNT; s++) {
+        const DES_StageStats *st = &sum[s];
+        if (st->calls == 0) continue;
+        double calls = (double)st->calls;
+        fprintf(stream, "%-20s %12llu %12.1f %12.1f %6.1f%%", des_stage_names[s], (unsigned long long)st->calls,
+                st->total / calls, st->self[0] / calls, all ? 100.0 * st->self[0] / all : 0.0);
+        if (counters) {
+            fprintf(stream, " %11.1f %6.2f %11.3f %11.3f", st->self[1] / calls,
+                    st->self[0] ? (double)st->self[1] / st->self[0] : 0.0, st->self[2] / calls,
+                    st->self[3] / calls);
+        }
+        fprintf(stream, "\n");
+    }
+    if (!counters) {
+        fprintf(stream, "(hardware counters unavailable: perf_event_open failed or DES_PROFILE_COUNTERS=0)\n");
+    }
+    fflush(stream);
+}
+
+void des_profile_reset(void) {
+    pthread_mutex_lock(&des_profile_lock);
+    for (DES_ProfileThread *t = des_profile_threads; t; t = t->next) {
+        memset(t->stats, 0, sizeof(t->stats));
+    }
+    pthread_mutex_unlock(&des_profile_lock);
+}
+
+#endif // DES_PROFILE
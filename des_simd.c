@@ -0,0 +1,612 @@
+#include "des_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DES_HAVE_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// ================================
+//      Vector Kernels
+// ================================
+
+#ifdef DES_HAVE_X86_KERNELS
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+typedef uint64_t des_v2u64 __attribute__((vector_size(16)));
+#define BS_WORD des_v2u64
+#define BS_NAME(x) des_bs128_##x
+#define BS_GROUPS 2
+#define BS_KERNEL_ID DES_KERNEL_SSE2
+#define BS_KERNEL_NAME "sse2"
+#include "des_bitslice_core.h"
+#undef BS_WORD
+#undef BS_NAME
+#undef BS_GROUPS
+#undef BS_KERNEL_ID
+#undef BS_KERNEL_NAME
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+typedef uint64_t des_v4u64 __attribute__((vector_size(32)));
+#define BS_WORD des_v4u64
+#define BS_NAME(x) des_bs256_##x
+#define BS_GROUPS 4
+#define BS_KERNEL_ID DES_KERNEL_AVX2
+#define BS_KERNEL_NAME "avx2"
+#define BS_KEY_FILTER 0  // Full 16 rounds measured faster than the round-15 filter
+#include "des_bitslice_core.h"
+#undef BS_WORD
+#undef BS_NAME
+#undef BS_GROUPS
+#undef BS_KERNEL_ID
+#undef BS_KERNEL_NAME
+#undef BS_KEY_FILTER
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+typedef uint64_t des_v8u64 __attribute__((vector_size(64)));
+#define BS_WORD des_v8u64
+#define BS_NAME(x) des_bs512_##x
+#define BS_GROUPS 8
+#define BS_KERNEL_ID DES_KERNEL_AVX512
+#define BS_KERNEL_NAME "avx512"
+#define BS_KEY_FILTER 0  // Same as AVX2
+#include "des_bitslice_core.h"
+#undef BS_WORD
+#undef BS_NAME
+#undef BS_GROUPS
+#undef BS_KERNEL_ID
+#undef BS_KERNEL_NAME
+#undef BS_KEY_FILTER
+#pragma GCC pop_options
+
+#endif // DES_HAVE_X86_KERNELS
+
+// ================================
+//      CPU Feature Detection
+// ================================
+
+static const char *const des_kernel_names[DES_KERNEL_COUNT] = {"scalar", "bitslice64", "sse2", "avx2", "avx512"};
+
+static const DES_KernelOps *des_kernel_table[DES_KERNEL_COUNT];
+static int des_kernel_available[DES_KERNEL_COUNT];
+static volatile int des_active_kernel = -1;
+static int des_have_popcnt = 0;
+static int des_have_vpopcntdq = 0;
+
+#ifdef DES_HAVE_X86_KERNELS
+static uint64_t des_xgetbv(void) {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+static void des_detect_kernels(void) {
+    des_kernel_available[DES_KERNEL_SCALAR] = 1;
+    des_kernel_available[DES_KERNEL_BITSLICE64] = 1;
+    des_kernel_table[DES_KERNEL_BITSLICE64] = &des_bs64_ops;
+
+#ifdef DES_HAVE_X86_KERNELS
+    des_kernel_table[DES_KERNEL_SSE2] = &des_bs128_ops;
+    des_kernel_table[DES_KERNEL_AVX2] = &des_bs256_ops;
+    des_kernel_table[DES_KERNEL_AVX512] = &des_bs512_ops;
+
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return;
+    des_kernel_available[DES_KERNEL_SSE2] = (edx >> 26) & 1;
+    des_have_popcnt = (ecx >> 23) & 1;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0) before AVX2/AVX-512 can run
+    int osxsave = (ecx >> 27) & 1;
+    uint64_t xcr0 = osxsave ? des_xgetbv() : 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return;
+    des_kernel_available[DES_KERNEL_AVX2] = ((ebx >> 5) & 1) && (xcr0 & 0x6) == 0x6;
+    des_kernel_available[DES_KERNEL_AVX512] = ((ebx >> 16) & 1) && (xcr0 & 0xE6) == 0xE6;
+    des_have_vpopcntdq = des_kernel_available[DES_KERNEL_AVX512] && ((ecx >> 14) & 1);
+#endif
+}
+
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+static void des_select_kernel(void) {
+    if (des_active_kernel >= 0) return;
+    des_detect_kernels();
+
+    int best = DES_KERNEL_SCALAR;
+    for (int k = DES_KERNEL_BITSLICE64; k < DES_KERNEL_COUNT; k++) {
+        if (des_kernel_available[k]) best = k;
+    }
+
+    const char *forced = getenv("DES_KERNEL");
+    if (forced && *forced) {
+        int match = -1;
+        for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+            if (strcmp(forced, des_kernel_names[k]) == 0) match = k;
+        }
+        if (match < 0 || !des_kernel_available[match]) {
+            fprintf(stderr, "DES_KERNEL=%s is not available here; using %s\n", forced, des_kernel_names[best]);
+        } else {
+            best = match;
+        }
+    }
+    des_active_kernel = best;
+}
+
+// ================================
+//      Public API
+// ================================
+
+DES_Kernel des_get_kernel(void) {
+    if (des_active_kernel < 0) des_select_kernel();
+    return (DES_Kernel)des_active_kernel;
+}
+
+int des_set_kernel(DES_Kernel kernel) {
+    if (des_active_kernel < 0) des_select_kernel();
+    if (!des_kernel_supported(kernel)) return -1;
+    des_active_kernel = kernel;
+    return 0;
+}
+
+int des_kernel_supported(DES_Kernel kernel) {
+    if (des_active_kernel < 0) des_select_kernel();
+    return kernel >= 0 && kernel < DES_KERNEL_COUNT && des_kernel_available[kernel];
+}
+
+const char *des_kernel_name(DES_Kernel kernel) {
+    return kernel >= 0 && kernel < DES_KERNEL_COUNT ? des_kernel_names[kernel] : "unknown";
+}
+
+int des_kernel_lanes(DES_Kernel kernel) {
+    if (des_active_kernel < 0) des_select_kernel();
+    if (kernel < 0 || kernel >= DES_KERNEL_COUNT) return 0;
+    return des_kernel_table[kernel] ? des_kernel_table[kernel]->lanes : 1;
+}
+
+// ================================
+//      Bulk Helpers
+// ================================
+
+const DES_KernelOps *des_kernel_ops(void) {
+    return des_kernel_table[des_get_kernel()];
+}
+
+void des_kernel_set_lane(const DES_KernelOps *ops, void *slices, int lane, uint64_t value) {
+    // Slice k of lane 64 * g + j is bit j of 64-bit word k * (lanes / 64) + g
+    uint64_t *words = (uint64_t *)slices;
+    int groups = ops->lanes / 64;
+    uint64_t bit = 1ULL << (lane % 64);
+    for (int k = 0; k < 64; k++) {
+        uint64_t *word = &words[k * groups + lane / 64];
+        *word = ((value >> (63 - k)) & 1) ? (*word | bit) : (*word & ~bit);
+    }
+}
+
+size_t des_kernel_ecb(const uint8_t *input, uint8_t *output, size_t blocks,
+                      const uint64_t *keys, int stages, int mode) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    if (!ops || blocks < (size_t)ops->lanes) return 0;
+
+    _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[3][64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+    uint64_t values[DES_KERNEL_MAX_LANES];
+    size_t lanes = (size_t)ops->lanes;
+
+    // Decryption runs the stages in reverse; IP/FP are index renaming here, so the
+    // stages simply run back to back on the same slices
+    for (int s = 0; s < stages; s++) {
+        ops->broadcast(key_slices[s], keys[mode == DES_ENCRYPT ? s : stages - 1 - s]);
+    }
+
+    size_t done = 0;
+    DES_PROFILE_BEGIN(DES_STAGE_KERNEL);
+    for (; done + lanes <= blocks; done += lanes) {
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        for (size_t i = 0; i < lanes; i++) {
+            values[i] = des_be_bytes_to_uint64(input + 8 * (done + i));
+        }
+        ops->load(slices, values);
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+        DES_PROFILE_BEGIN(DES_STAGE_BITSLICE_ROUNDS);
+        for (int s = 0; s < stages; s++) {
+            ops->crypt(slices, key_slices[s], s % 2 == 0 ? mode : !mode);
+        }
+        DES_PROFILE_END(DES_STAGE_BITSLICE_ROUNDS);
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        ops->store(slices, values);
+        for (size_t i = 0; i < lanes; i++) {
+            des_uint64_to_be_bytes(values[i], output + 8 * (done + i));
+        }
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+    }
+    DES_PROFILE_END(DES_STAGE_KERNEL);
+    return done;
+}
+
+size_t des_kernel_ecb_rounds(const uint8_t *input, uint8_t *output, size_t blocks,
+                             uint64_t key, int rounds, uint64_t *states) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    if (!ops || blocks < (size_t)ops->lanes) return 0;
+
+    _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+    uint64_t values[DES_KERNEL_MAX_LANES];
+    size_t lanes = (size_t)ops->lanes, words = lanes, stride = (size_t)rounds + 1;
+    uint64_t *tap = NULL;
+
+    // The tap holds every state of a pass: (rounds + 1) * 64 slices
+    if (states) {
+        tap = (uint64_t *)aligned_alloc(DES_KERNEL_ALIGN, stride * words * sizeof(uint64_t));
+        if (!tap) return 0;
+    }
+    ops->broadcast(key_slices, key);
+
+    size_t done = 0;
+    DES_PROFILE_BEGIN(DES_STAGE_KERNEL);
+    for (; done + lanes <= blocks; done += lanes) {
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        for (size_t i = 0; i < lanes; i++) {
+            values[i] = des_be_bytes_to_uint64(input + 8 * (done + i));
+        }
+        ops->load(slices, values);
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+        DES_PROFILE_BEGIN(DES_STAGE_BITSLICE_ROUNDS);
+        ops->crypt_rounds(slices, key_slices, rounds, tap);
+        DES_PROFILE_END(DES_STAGE_BITSLICE_ROUNDS);
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        ops->store(slices, values);
+        for (size_t i = 0; i < lanes; i++) {
+            des_uint64_to_be_bytes(values[i], output + 8 * (done + i));
+        }
+        for (size_t r = 0; tap && r < stride; r++) {
+            ops->store(tap + r * words, values);
+            for (size_t i = 0; i < lanes; i++) states[(done + i) * stride + r] = values[i];
+        }
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+    }
+    DES_PROFILE_END(DES_STAGE_KERNEL);
+    free(tap);
+    return done;
+}
+
+size_t des_kernel_ecb_multikey(const uint64_t *keys, const uint8_t *input, uint8_t *output,
+                               size_t blocks, int mode) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    if (!ops || blocks < (size_t)ops->lanes) return 0;
+
+    _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+    uint64_t values[DES_KERNEL_MAX_LANES];
+    size_t lanes = (size_t)ops->lanes;
+
+    size_t done = 0;
+    DES_PROFILE_BEGIN(DES_STAGE_KERNEL);
+    for (; done + lanes <= blocks; done += lanes) {
+        // The transposed keys are the whole key schedule: each round reads its subkey
+        // bits straight from the key slices
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        ops->load(key_slices, keys + done);
+        for (size_t i = 0; i < lanes; i++) {
+            values[i] = des_be_bytes_to_uint64(input + 8 * (done + i));
+        }
+        ops->load(slices, values);
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+        DES_PROFILE_BEGIN(DES_STAGE_BITSLICE_ROUNDS);
+        ops->crypt(slices, key_slices, mode);
+        DES_PROFILE_END(DES_STAGE_BITSLICE_ROUNDS);
+        DES_PROFILE_BEGIN(DES_STAGE_TRANSPOSE);
+        ops->store(slices, values);
+        for (size_t i = 0; i < lanes; i++) {
+            des_uint64_to_be_bytes(values[i], output + 8 * (done + i));
+        }
+        DES_PROFILE_END(DES_STAGE_TRANSPOSE);
+    }
+    DES_PROFILE_END(DES_STAGE_KERNEL);
+    return done;
+}
+
+void des_key_trial(const uint64_t *keys, size_t count, const uint8_t plaintext[8],
+                   const uint8_t ciphertext[8], uint64_t *matches) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    uint64_t target = des_be_bytes_to_uint64(ciphertext);
+    size_t done = 0;
+
+    memset(matches, 0, ((count + 63) / 64) * sizeof(uint64_t));
+    if (ops) {
+        _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+        _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+        _Alignas(DES_KERNEL_ALIGN) uint64_t plain_slices[64 * DES_KERNEL_MAX_LANES / 64];
+        size_t lanes = (size_t)ops->lanes;
+
+        ops->broadcast(plain_slices, des_be_bytes_to_uint64(plaintext));
+        for (; done + lanes <= count; done += lanes) {
+            ops->load(key_slices, keys + done);
+            memcpy(slices, plain_slices, lanes * 8);
+            ops->crypt(slices, key_slices, DES_ENCRYPT);
+            ops->match(slices, target, matches + done / 64);
+        }
+    }
+
+    for (; done < count; done++) {
+        DES_RoundKeys round_keys;
+        uint8_t output[8];
+        des_key_setup(keys[done], &round_keys);
+        des_encrypt_block_with_keys(plaintext, output, &round_keys);
+        if (des_be_bytes_to_uint64(output) == target) {
+            matches[done / 64] |= 1ULL << (done % 64);
+        }
+    }
+}
+
+// Full check of one surviving candidate; appends the key and/or its complement
+static size_t des_key_test_candidate(const DES_KeyTest *test, uint64_t key, uint64_t *found,
+                                     size_t hits, size_t max_found) {
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    int result = des_key_test_schedule(test, &round_keys);
+    if (result & 1) {
+        if (hits < max_found) found[hits] = key;
+        hits++;
+    }
+    if (result & 2) {
+        if (hits < max_found) found[hits] = ~key;
+        hits++;
+    }
+    return hits;
+}
+
+size_t des_key_test_batch(const DES_KeyTest *test, const uint64_t *keys, size_t count,
+                          uint64_t *found, size_t max_found) {
+    const DES_KernelOps *ops = des_kernel_ops();
+    size_t hits = 0, done = 0;
+
+    if (ops) {
+        _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+        _Alignas(DES_KERNEL_ALIGN) uint64_t plain_slices[64 * DES_KERNEL_MAX_LANES / 64];
+        _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+        uint64_t masks[2 * DES_KERNEL_MAX_LANES / 64];
+        uint64_t complement_target = 0;
+        size_t lanes = (size_t)ops->lanes, groups = lanes / 64;
+
+        // Kernels without the filter encrypt in full; E_k(P) = ~C' flags k for the pair (~P, C')
+        for (size_t i = 1; i < test->pair_count; i++) {
+            if (test->plaintexts[i] == ~test->plaintexts[0]) {
+                complement_target = ~test->ciphertexts[i];
+                break;
+            }
+        }
+
+        ops->broadcast(plain_slices, des_be_bytes_to_uint64(test->plaintext));
+        for (; done + lanes <= count; done += lanes) {
+            DES_PROFILE_BEGIN(DES_STAGE_KEY_TEST);
+            ops->load(key_slices, keys + done);
+            if (ops->key_filter) {
+                ops->key_filter(plain_slices, key_slices, test->targets, test->target_count, masks);
+            } else {
+                memcpy(slices, plain_slices, lanes * 8);
+                ops->crypt(slices, key_slices, DES_ENCRYPT);
+                ops->match(slices, test->ciphertexts[0], masks);
+                if (test->target_count > 1) ops->match(slices, complement_target, masks + groups);
+            }
+            DES_PROFILE_END(DES_STAGE_KEY_TEST);
+            for (size_t g = 0; g < groups; g++) {
+                uint64_t survivors = masks[g] | (test->target_count > 1 ? masks[groups + g] : 0);
+                while (survivors) {
+                    size_t lane = 64 * g + (size_t)__builtin_ctzll(survivors);
+                    survivors &= survivors - 1;
+                    hits = des_key_test_candidate(test, keys[done + lane], found, hits, max_found);
+                }
+            }
+        }
+    }
+
+    for (; done < count; done++) {
+        hits = des_key_test_candidate(test, keys[done], found, hits, max_found);
+    }
+    return hits;
+}
+
+// ================================
+//      Avalanche Statistics
+// ================================
+
+// Adds one pass of ciphertext differences d (64 slices of `groups` words, invalid lanes
+// already masked off) to row `input` of counts
+DES_BS_INLINE void des_avalanche_count_body(const uint64_t *d, size_t groups, int bic, uint64_t flips[64],
+                                            uint64_t pairs[64][64]) {
+    for (int j = 0; j < 64; j++) {
+        const uint64_t *dj = d + j * groups;
+        uint64_t n = 0;
+        for (size_t g = 0; g < groups; g++) n += (uint64_t)__builtin_popcountll(dj[g]);
+        flips[j] += n;
+        if (!bic || n == 0) continue;
+        for (int k = j + 1; k < 64; k++) {
+            const uint64_t *dk = d + k * groups;
+            uint64_t both = 0;
+            for (size_t g = 0; g < groups; g++) both += (uint64_t)__builtin_popcountll(dj[g] & dk[g]);
+            pairs[j][k] += both;
+        }
+    }
+}
+
+static void des_avalanche_count(const uint64_t *d, size_t groups, int bic, uint64_t flips[64],
+                                uint64_t pairs[64][64]) {
+    des_avalanche_count_body(d, groups, bic, flips, pairs);
+}
+
+#ifdef DES_HAVE_X86_KERNELS
+// Same with the POPCNT instruction; the BIC pair counts are most of the work
+__attribute__((target("popcnt")))
+static void des_avalanche_count_popcnt(const uint64_t *d, size_t groups, int bic, uint64_t flips[64],
+                                       uint64_t pairs[64][64]) {
+    des_avalanche_count_body(d, groups, bic, flips, pairs);
+}
+#endif
+
+void des_avalanche_accumulate(const uint64_t *plaintexts, const uint64_t *keys, size_t count,
+                              int target, int bic, DES_AvalancheCounts *counts) {
+    des_avalanche_accumulate_rounds(plaintexts, keys, count, target, 16, bic, counts);
+}
+
+void des_avalanche_accumulate_rounds(const uint64_t *plaintexts, const uint64_t *keys, size_t count,
+                                     int target, int rounds, int bic, DES_AvalancheCounts *counts) {
+    if (rounds < 1 || rounds > 16) return;
+
+    // The scalar kernel has no slices; the portable 64-lane one stands in for it
+    const DES_KernelOps *ops = des_kernel_ops();
+    if (!ops) ops = &des_bs64_ops;
+
+    _Alignas(DES_KERNEL_ALIGN) uint64_t key_slices[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t plain_slices[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t base[64 * DES_KERNEL_MAX_LANES / 64];
+    _Alignas(DES_KERNEL_ALIGN) uint64_t slices[64 * DES_KERNEL_MAX_LANES / 64];
+    uint64_t values[DES_KERNEL_MAX_LANES], masks[DES_KERNEL_MAX_LANES / 64];
+    size_t lanes = (size_t)ops->lanes, groups = lanes / 64, words = 64 * groups;
+    int inputs = target == DES_AVALANCHE_KEY ? 56 : 64;
+    void (*count_fn)(const uint64_t *, size_t, int, uint64_t *, uint64_t (*)[64]) = des_avalanche_count;
+#ifdef DES_HAVE_X86_KERNELS
+    if (des_have_popcnt) count_fn = des_avalanche_count_popcnt;
+#endif
+
+    for (size_t done = 0; done < count; done += lanes) {
+        // A short final pass runs zero lanes, masked out of every count
+        size_t n = count - done < lanes ? count - done : lanes;
+        for (size_t g = 0; g < groups; g++) {
+            size_t valid = n > 64 * g ? n - 64 * g : 0;
+            masks[g] = valid >= 64 ? ~0ULL : (1ULL << valid) - 1;
+        }
+
+        memset(values, 0, sizeof(values));
+        memcpy(values, plaintexts + done, n * sizeof(uint64_t));
+        ops->load(plain_slices, values);
+        memcpy(values, keys + done, n * sizeof(uint64_t));
+        ops->load(key_slices, values);
+
+        memcpy(base, plain_slices, words * sizeof(uint64_t));
+        ops->crypt_rounds(base, key_slices, rounds, NULL);
+
+        for (int input = 0; input < inputs; input++) {
+            // Effective key bit i is slice i + i / 7 (slices 7, 15, ... hold parity)
+            uint64_t *flip = target == DES_AVALANCHE_KEY ? key_slices + (input + input / 7) * groups
+                                                         : plain_slices + input * groups;
+            for (size_t g = 0; g < groups; g++) flip[g] = ~flip[g];
+            memcpy(slices, plain_slices, words * sizeof(uint64_t));
+            ops->crypt_rounds(slices, key_slices, rounds, NULL);
+            for (size_t g = 0; g < groups; g++) flip[g] = ~flip[g];
+
+            for (size_t k = 0; k < 64; k++) {
+                for (size_t g = 0; g < groups; g++) {
+                    slices[k * groups + g] = (slices[k * groups + g] ^ base[k * groups + g]) & masks[g];
+                }
+            }
+            count_fn(slices, groups, bic, counts->flips[input], counts->pairs[input]);
+        }
+        counts->samples += n;
+    }
+}
+
+// ================================
+//      Bit Correlation Counts
+// ================================
+
+// Transposes up to 64 words (zero padded) so that slices[d] holds bit d, MSB first, of
+// every word; padding adds nothing to any count
+static void des_correlation_slices(const uint64_t *words, size_t n, uint64_t slices[64]) {
+    uint64_t m[64];
+    memcpy(m, words, n * sizeof(uint64_t));
+    memset(m + n, 0, (64 - n) * sizeof(uint64_t));
+    des_bs_transpose64(m);
+    for (int d = 0; d < 64; d++) slices[d] = m[63 - d];
+}
+
+// Slice batches transposed before each count call
+#define DES_CORRELATION_BATCHES 16
+
+DES_BS_INLINE void des_correlation_count_body(const uint64_t (*a)[64], const uint64_t (*b)[64], size_t batches,
+                                              DES_CorrelationCounts *counts) {
+    for (size_t t = 0; t < batches; t++) {
+        for (int i = 0; i < 64; i++) {
+            uint64_t x = a[t][i];
+            counts->ones_a[i] += (uint64_t)__builtin_popcountll(x);
+            counts->ones_b[i] += (uint64_t)__builtin_popcountll(b[t][i]);
+            if (!x) continue;
+            for (int j = 0; j < 64; j++) counts->both[i][j] += (uint64_t)__builtin_popcountll(x & b[t][j]);
+        }
+    }
+}
+
+static void des_correlation_count(const uint64_t (*a)[64], const uint64_t (*b)[64], size_t batches,
+                                  DES_CorrelationCounts *counts) {
+    des_correlation_count_body(a, b, batches, counts);
+}
+
+#ifdef DES_HAVE_X86_KERNELS
+__attribute__((target("popcnt")))
+static void des_correlation_count_popcnt(const uint64_t (*a)[64], const uint64_t (*b)[64], size_t batches,
+                                         DES_CorrelationCounts *counts) {
+    des_correlation_count_body(a, b, batches, counts);
+}
+
+// A row of 64 counts is eight vectors, kept in registers over all batches: AND with the
+// broadcast a slice, VPOPCNTQ, add
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void des_correlation_count_avx512(const uint64_t (*a)[64], const uint64_t (*b)[64], size_t batches,
+                                         DES_CorrelationCounts *counts) {
+    for (int v = 0; v < 8; v++) {
+        __m512i ones_a = _mm512_loadu_si512((const void *)(counts->ones_a + 8 * v));
+        __m512i ones_b = _mm512_loadu_si512((const void *)(counts->ones_b + 8 * v));
+        for (size_t t = 0; t < batches; t++) {
+            ones_a = _mm512_add_epi64(ones_a, _mm512_popcnt_epi64(_mm512_loadu_si512((const void *)(a[t] + 8 * v))));
+            ones_b = _mm512_add_epi64(ones_b, _mm512_popcnt_epi64(_mm512_loadu_si512((const void *)(b[t] + 8 * v))));
+        }
+        _mm512_storeu_si512((void *)(counts->ones_a + 8 * v), ones_a);
+        _mm512_storeu_si512((void *)(counts->ones_b + 8 * v), ones_b);
+    }
+    for (int i = 0; i < 64; i++) {
+        __m512i sum[8];
+        for (int v = 0; v < 8; v++) sum[v] = _mm512_loadu_si512((const void *)(counts->both[i] + 8 * v));
+        for (size_t t = 0; t < batches; t++) {
+            __m512i x = _mm512_set1_epi64((long long)a[t][i]);
+            for (int v = 0; v < 8; v++) {
+                __m512i y = _mm512_loadu_si512((const void *)(b[t] + 8 * v));
+                sum[v] = _mm512_add_epi64(sum[v], _mm512_popcnt_epi64(_mm512_and_si512(x, y)));
+            }
+        }
+        for (int v = 0; v < 8; v++) _mm512_storeu_si512((void *)(counts->both[i] + 8 * v), sum[v]);
+    }
+}
+#endif
+
+void des_correlation_accumulate(const uint64_t *a, const uint64_t *b, size_t count,
+                                DES_CorrelationCounts *counts) {
+    DES_Kernel kernel = des_get_kernel();  // Also runs CPU detection
+    void (*count_fn)(const uint64_t (*)[64], const uint64_t (*)[64], size_t, DES_CorrelationCounts *) =
+        des_correlation_count;
+#ifdef DES_HAVE_X86_KERNELS
+    if (des_have_popcnt) count_fn = des_correlation_count_popcnt;
+    if (des_have_vpopcntdq && kernel == DES_KERNEL_AVX512) count_fn = des_correlation_count_avx512;
+#else
+    (void)kernel;
+#endif
+    uint64_t sa[DES_CORRELATION_BATCHES][64], sb[DES_CORRELATION_BATCHES][64];
+
+    size_t done = 0;
+    while (done < count) {
+        size_t batches = 0;
+        for (; batches < DES_CORRELATION_BATCHES && done < count; batches++, done += 64) {
+            size_t n = count - done < 64 ? count - done : 64;
+            des_correlation_slices(a + done, n, sa[batches]);
+            des_correlation_slices(b + done, n, sb[batches]);
+        }
+        count_fn((const uint64_t (*)[64])sa, (const uint64_t (*)[64])sb, batches, counts);
+    }
+    counts->samples += count;
+}
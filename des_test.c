@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -19,6 +20,869 @@ void generate_random_iv(uint8_t iv[8]) {
     }
 }
 
+// Known-answer vectors from FIPS 46 / NBS SP 500-20
+void test_known_answers(FILE *fp) {
+    static const struct {
+        uint64_t key, plaintext, ciphertext;
+    } vectors[] = {
+        {0x133457799BBCDFF1ULL, 0x0123456789ABCDEFULL, 0x85E813540F0AB405ULL},
+        {0x0E329232EA6D0D73ULL, 0x8787878787878787ULL, 0x0000000000000000ULL},
+        {0x0101010101010101ULL, 0x95F8A5E5DD31D900ULL, 0x8000000000000000ULL},
+        {0x8001010101010101ULL, 0x0000000000000000ULL, 0x95A8D72813DAA94DULL},
+        {0x1C587F1C13924FEFULL, 0x305532286D6F295AULL, 0x63FAC0D034D9F793ULL},
+    };
+
+    fprintf(fp, "=== Known-Answer Tests ===\n");
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        uint8_t plaintext[8], ciphertext[8], expected[8], decrypted[8];
+        des_uint64_to_be_bytes(vectors[i].plaintext, plaintext);
+        des_uint64_to_be_bytes(vectors[i].ciphertext, expected);
+
+        des_encrypt_block(plaintext, ciphertext, vectors[i].key);
+        des_decrypt_block(ciphertext, decrypted, vectors[i].key);
+
+        print_hex(fp, "Ciphertext", ciphertext, 8);
+        int ok = memcmp(ciphertext, expected, 8) == 0 && memcmp(decrypted, plaintext, 8) == 0;
+        fprintf(fp, "Vector %zu: %s\n", i + 1, ok ? "SUCCESS" : "FAILURE");
+        if (!ok) {
+            printf("Known-answer vector %zu FAILED\n", i + 1);
+        }
+    }
+}
+
+// Lookup form of every DES permutation against the bit-at-a-time reference, on each
+// single input bit and on random inputs
+void test_permutations(FILE *fp) {
+    static const struct {
+        const char *name;
+        const uint8_t *table;
+        int n, input_bits;
+    } perms[] = {
+        {"IP", DES_INITIAL_MESSAGE_PERMUTATION, 64, 64},
+        {"FP", DES_FINAL_MESSAGE_PERMUTATION, 64, 64},
+        {"E", DES_MESSAGE_EXPANSION, 48, 32},
+        {"P", DES_RIGHT_SUB_MESSAGE_PERMUTATION, 32, 32},
+        {"PC-1", DES_INITIAL_KEY_PERMUTATION, 56, 64},
+        {"PC-2", DES_SUB_KEY_PERMUTATION, 48, 56},
+    };
+    static DES_PermutationLUT lut;
+
+    fprintf(fp, "=== Permutation Tables ===\n");
+    for (size_t p = 0; p < sizeof(perms) / sizeof(perms[0]); p++) {
+        int bits = perms[p].input_bits, ok = 1;
+        uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        des_permutation_lut_init(&lut, perms[p].table, perms[p].n, bits);
+        for (int i = 0; i < bits + 1000; i++) {
+            uint64_t x = i < bits ? 1ULL << i
+                                  : (((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand()) & mask;
+            uint64_t expected;
+            des_apply_permutation(&expected, x << (64 - bits), perms[p].table, perms[p].n);
+            ok = ok && des_permutation_lut_apply(&lut, x) == expected;
+        }
+        fprintf(fp, "%s lookup matches reference: %s\n", perms[p].name, ok ? "SUCCESS" : "FAILURE");
+        if (!ok) {
+            printf("Permutation %s FAILED\n", perms[p].name);
+        }
+    }
+}
+
+// Every supported bulk kernel must match the scalar path, over 1 MB plus a partial pass
+void test_kernels(FILE *fp) {
+    size_t size = 1024 * 1024 + 8 * 37;
+    uint8_t *reference = (uint8_t *)malloc(size), *expected = (uint8_t *)malloc(size);
+    uint8_t *data = (uint8_t *)malloc(size);
+    if (!reference || !expected || !data) {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < size; i++) reference[i] = rand() & 0xFF;
+
+    DES_RoundKeys round_keys;
+    des_key_setup(0x133457799BBCDFF1ULL, &round_keys);
+    DES_Kernel active = des_get_kernel();
+
+    des_set_kernel(DES_KERNEL_SCALAR);
+    memcpy(expected, reference, size);
+    des_ecb_encrypt(expected, size, &round_keys);
+
+    fprintf(fp, "=== Kernel Cross-Check (active: %s) ===\n", des_kernel_name(active));
+    for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+        if (des_set_kernel((DES_Kernel)k) != 0) continue;
+        memcpy(data, reference, size);
+        des_ecb_encrypt(data, size, &round_keys);
+        int ok = memcmp(data, expected, size) == 0;
+        des_ecb_decrypt(data, size, &round_keys);
+        ok = ok && memcmp(data, reference, size) == 0;
+        fprintf(fp, "Kernel %s: %s\n", des_kernel_name((DES_Kernel)k), ok ? "SUCCESS" : "FAILURE");
+        if (!ok) {
+            printf("Kernel %s FAILED\n", des_kernel_name((DES_Kernel)k));
+        }
+    }
+    des_set_kernel(active);
+    free(reference);
+    free(expected);
+    free(data);
+}
+
+// CTR round trip, plus decryption of an unaligned byte range on its own
+void test_ctr_mode(FILE *fp) {
+    uint8_t original[1000], data[1000];
+    uint8_t counter[8] = {0x01, 0x02, 0x03, 0x04, 0xFF, 0xFF, 0xFF, 0xFE};
+    for (size_t i = 0; i < sizeof(original); i++) original[i] = rand() & 0xFF;
+
+    DES_RoundKeys round_keys;
+    des_key_setup(0x133457799BBCDFF1ULL, &round_keys);
+
+    memcpy(data, original, sizeof(data));
+    des_ctr_xcrypt(data, sizeof(data), &round_keys, counter, 0);
+    int ok = memcmp(data, original, sizeof(data)) != 0;
+
+    // Keystream block 0 is E(counter)
+    uint8_t first[8];
+    des_encrypt_block_with_keys(counter, first, &round_keys);
+    for (int i = 0; i < 8; i++) ok = ok && (data[i] ^ original[i]) == first[i];
+
+    des_ctr_xcrypt(data + 13, 500, &round_keys, counter, 13);
+    ok = ok && memcmp(data + 13, original + 13, 500) == 0;
+
+    fprintf(fp, "=== CTR Mode ===\n");
+    fprintf(fp, "CTR round trip and random access: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("CTR mode FAILED\n");
+    }
+}
+
+void test_ctr_ranges(FILE *fp) {
+    // Byte range [3, size - 5) decrypted on its own at several sizes; the counter's low
+    // word wraps inside the 1 MB buffer, which is split across threads
+    static const size_t sizes[] = {8, 16, 1024, 1024 * 1024};
+    uint8_t counter[8] = {0xA5, 0x5A, 0x01, 0x02, 0xFF, 0xFF, 0xFF, 0xF0};
+    DES_RoundKeys round_keys;
+    des_key_setup(0x133457799BBCDFF1ULL, &round_keys);
+    int ok = 1;
+
+    des_set_threads(3);
+    for (size_t s = 0; ok && s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        uint8_t *original = (uint8_t *)malloc(size), *data = (uint8_t *)malloc(size);
+        ok = original && data;
+        if (ok) {
+            for (size_t i = 0; i < size; i++) original[i] = rand() & 0xFF;
+            memcpy(data, original, size);
+            des_ctr_xcrypt(data, size, &round_keys, counter, 0);
+            size_t begin = size > 3 ? 3 : 0, end = size > 5 ? size - 5 : size;
+            des_ctr_xcrypt(data + begin, end - begin, &round_keys, counter, begin);
+            ok = memcmp(data + begin, original + begin, end - begin) == 0;
+        }
+        free(original);
+        free(data);
+    }
+    des_set_threads(0);
+
+    fprintf(fp, "=== CTR Ranges ===\n");
+    fprintf(fp, "Offset ranges decrypt on their own at 8 B to 1 MB: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("CTR ranges FAILED\n");
+    }
+}
+
+void test_key_search(FILE *fp) {
+    uint64_t key = 0x133457799BBCDFF1ULL;
+    uint8_t plaintexts[16] = "HELLO123", ciphertexts[16];
+    for (int i = 0; i < 8; i++) plaintexts[8 + i] = (uint8_t)~plaintexts[i];
+    memcpy(ciphertexts, plaintexts, sizeof(ciphertexts));
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+    des_ecb_encrypt(ciphertexts, sizeof(ciphertexts), &round_keys);
+
+    DES_KeyTest test;
+    des_key_test_init(&test, plaintexts, ciphertexts, 2);
+    int ok = test.target_count == 2 && des_key_test_schedule(&test, &round_keys) == 1;
+
+    // Every kernel must find the key among 1024 candidates, and ~key through its complement
+    uint64_t keys[1024], found[4];
+    for (size_t i = 0; i < 1024; i++) keys[i] = des_key_from_index(des_key_to_index(key) ^ (i + 1));
+    keys[700] = key;
+    keys[900] = ~key;
+    DES_Kernel saved = des_get_kernel();
+    for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+        if (!des_kernel_supported((DES_Kernel)k)) continue;
+        des_set_kernel((DES_Kernel)k);
+        size_t hits = des_key_test_batch(&test, keys, 1024, found, 4);
+        ok = ok && hits == 2 && found[0] == key && found[1] == key;
+    }
+    des_set_kernel(saved);
+
+    fprintf(fp, "=== Key Search ===\n");
+    fprintf(fp, "Early-reject key test with complement: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Key search FAILED\n");
+    }
+}
+
+void test_key_enum(FILE *fp) {
+    // Walk 2^12 keys: each index once, one effective key bit flipped per step, and the
+    // patched round keys equal to a full des_key_setup every time
+    enum { BITS = 12 };
+    uint64_t base = des_key_to_index(0x133457799BBCDFF1ULL) >> BITS << BITS;
+    uint8_t seen[1 << BITS] = {0};
+    DES_KeyEnumerator enumerator;
+    DES_RoundKeys expected;
+    des_key_enum_init(&enumerator, base, BITS);
+    int ok = enumerator.count == (1 << BITS);
+    uint64_t visited = 0, previous = 0;
+    do {
+        uint64_t offset = enumerator.index - base;
+        ok = ok && enumerator.step == visited && offset < (1 << BITS) && !seen[offset];
+        if (!ok) break;
+        seen[offset] = 1;
+        ok = enumerator.key == des_key_from_index(enumerator.index) && enumerator.round_keys.key == enumerator.key;
+        des_key_setup(enumerator.key, &expected);
+        ok = ok && memcmp(expected.subkeys, enumerator.round_keys.subkeys, sizeof(expected.subkeys)) == 0;
+        if (visited) ok = ok && __builtin_popcountll((enumerator.key ^ previous) & ~0x0101010101010101ULL) == 1;
+        previous = enumerator.key;
+        visited++;
+    } while (ok && des_key_enum_next(&enumerator));
+    ok = ok && visited == (1 << BITS) && des_key_enum_next(&enumerator) == 0;
+
+    fprintf(fp, "=== Key Enumeration ===\n");
+    fprintf(fp, "Gray-code walk visits every key once with exact round keys: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Key enumeration FAILED\n");
+    }
+}
+
+void test_bitslice(FILE *fp) {
+    // A partial 64-lane pass (70 blocks) against the single-block routine
+    uint64_t key = 0x133457799BBCDFF1ULL;
+    uint8_t original[70 * 8], data[70 * 8], block[8];
+    for (size_t i = 0; i < sizeof(original); i++) original[i] = rand() & 0xFF;
+    DES_RoundKeys round_keys;
+    des_key_setup(key, &round_keys);
+
+    des_bitslice_encrypt(original, data, 70, &round_keys);
+    int ok = 1;
+    for (int i = 0; i < 70; i++) {
+        des_encrypt_block_with_keys(original + 8 * i, block, &round_keys);
+        ok = ok && memcmp(block, data + 8 * i, 8) == 0;
+    }
+    des_bitslice_decrypt(data, data, 70, &round_keys);
+    ok = ok && memcmp(data, original, sizeof(original)) == 0;
+
+    // Transpose round trip, with slice k holding bit k + 1 (MSB first) of every block
+    uint64_t slices[64], key_slices[64];
+    des_bitslice_transpose_in(original, slices);
+    ok = ok && ((slices[0] >> 5) & 1) == (uint64_t)(original[8 * 5] >> 7);
+    ok = ok && ((slices[63] >> 9) & 1) == (uint64_t)(original[8 * 9 + 7] & 1);
+    des_bitslice_transpose_out(slices, data);
+    ok = ok && memcmp(data, original, 64 * 8) == 0;
+
+    // One key per lane through the raw rounds
+    uint64_t keys[DES_BITSLICE_LANES];
+    uint8_t key_bytes[DES_BITSLICE_LANES * 8];
+    for (int i = 0; i < DES_BITSLICE_LANES; i++) {
+        keys[i] = key ^ ((uint64_t)(i + 1) << 41);
+        des_uint64_to_be_bytes(keys[i], key_bytes + 8 * i);
+    }
+    des_bitslice_transpose_in(key_bytes, key_slices);
+    des_bitslice_crypt(slices, key_slices, DES_ENCRYPT);
+    des_bitslice_transpose_out(slices, data);
+    for (int i = 0; i < DES_BITSLICE_LANES; i++) {
+        des_encrypt_block(original + 8 * i, block, keys[i]);
+        ok = ok && memcmp(block, data + 8 * i, 8) == 0;
+    }
+
+    // Key search must flag exactly the lane holding the key (bits 41-47 are effective
+    // key bits, so the candidates above are all distinct keys)
+    uint8_t ciphertext[8];
+    des_encrypt_block_with_keys(original, ciphertext, &round_keys);
+    keys[37] = key;
+    ok = ok && des_bitslice_key_search(keys, original, ciphertext) == (1ULL << 37);
+
+    // des_key_trial over a partial last word, on every kernel
+    enum { TRIALS = 200 };
+    uint64_t trial_keys[TRIALS], matches[(TRIALS + 63) / 64];
+    for (int i = 0; i < TRIALS; i++) trial_keys[i] = des_key_from_index(des_key_to_index(key) ^ (uint64_t)(i + 1));
+    trial_keys[133] = key;
+    DES_Kernel saved = des_get_kernel();
+    for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+        if (des_set_kernel((DES_Kernel)k) != 0) continue;
+        memset(matches, 0xFF, sizeof(matches));
+        des_key_trial(trial_keys, TRIALS, original, ciphertext, matches);
+        ok = ok && matches[0] == 0 && matches[1] == 0 && matches[2] == (1ULL << (133 % 64)) && matches[3] == 0;
+    }
+    des_set_kernel(saved);
+
+    fprintf(fp, "=== Bitsliced Engine ===\n");
+    fprintf(fp, "Bitsliced blocks, transposes and key trials match the scalar path: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Bitsliced engine FAILED\n");
+    }
+}
+
+void test_triple_des(FILE *fp) {
+    static const uint8_t plaintext[24] = "The qufck brown fox jump";
+    // Reference values from OpenSSL (des-ede3, des-ede, des-ede3-cbc)
+    static const uint8_t three_key[24] = {
+        0xA8, 0x26, 0xFD, 0x8C, 0xE5, 0x3B, 0x85, 0x5F, 0xCC, 0xE2, 0x1C, 0x81,
+        0x12, 0x25, 0x6F, 0xE6, 0x68, 0xD5, 0xC0, 0x5D, 0xD9, 0xB6, 0xB9, 0x00};
+    static const uint8_t two_key[24] = {
+        0xC4, 0x48, 0x62, 0xF7, 0x0C, 0xF2, 0xFB, 0xDC, 0x90, 0x77, 0xD0, 0x90,
+        0x9F, 0xA9, 0x1B, 0x88, 0x4C, 0xAB, 0xD6, 0x1F, 0xC5, 0x8E, 0x0C, 0xBB};
+    static const uint8_t three_key_cbc[24] = {
+        0xD9, 0xDA, 0x2D, 0x29, 0xB4, 0xB0, 0x7D, 0xC3, 0x68, 0x1C, 0x14, 0x6D,
+        0x28, 0x32, 0x20, 0xD4, 0xA5, 0xCD, 0x06, 0x96, 0xCE, 0x2B, 0x3D, 0x42};
+    uint8_t iv[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    uint8_t block[24];
+    DES3_RoundKeys three, two;
+    des3_key_setup(0x0123456789ABCDEFULL, 0x23456789ABCDEF01ULL, 0x456789ABCDEF0123ULL, &three);
+    des3_key_setup(0x0123456789ABCDEFULL, 0x23456789ABCDEF01ULL, 0x0123456789ABCDEFULL, &two);
+
+    memcpy(block, plaintext, 24);
+    des3_ecb_encrypt(block, 24, &three);
+    int ok = memcmp(block, three_key, 24) == 0;
+    des3_ecb_decrypt(block, 24, &three);
+    ok = ok && memcmp(block, plaintext, 24) == 0;
+    memcpy(block, plaintext, 24);
+    des3_ecb_encrypt(block, 24, &two);
+    ok = ok && memcmp(block, two_key, 24) == 0;
+    memcpy(block, plaintext, 24);
+    des3_cbc_encrypt(block, 24, &three, iv);
+    ok = ok && memcmp(block, three_key_cbc, 24) == 0;
+
+    // Bulk paths on every kernel: ECB, CBC and CTR against the single-block routine
+    size_t size = 64 * 1024 + 8 * 37;
+    uint8_t *original = (uint8_t *)malloc(size), *data = (uint8_t *)malloc(size);
+    for (size_t i = 0; i < size; i++) original[i] = rand() & 0xFF;
+    DES_Kernel saved = des_get_kernel();
+    for (int k = 0; k < DES_KERNEL_COUNT && original && data; k++) {
+        if (!des_kernel_supported((DES_Kernel)k)) continue;
+        des_set_kernel((DES_Kernel)k);
+        memcpy(data, original, size);
+        des3_ecb_encrypt(data, size, &three);
+        for (size_t i = 0; i < size; i += 8 * 501) {
+            des3_encrypt_block(original + i, block, &three);
+            ok = ok && memcmp(block, data + i, 8) == 0;
+        }
+        des3_ecb_decrypt(data, size, &three);
+        ok = ok && memcmp(data, original, size) == 0;
+        des3_cbc_encrypt(data, size, &three, iv);
+        des3_cbc_decrypt(data, size, &three, iv);
+        ok = ok && memcmp(data, original, size) == 0;
+        des3_ctr_xcrypt(data, size, &three, iv, 0);
+        des3_ctr_xcrypt(data, size, &three, iv, 0);
+        ok = ok && memcmp(data, original, size) == 0;
+    }
+    des_set_kernel(saved);
+    free(original);
+    free(data);
+
+    fprintf(fp, "=== Triple DES ===\n");
+    fprintf(fp, "3DES known answers and ECB/CBC/CTR round trips: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Triple DES FAILED\n");
+    }
+}
+
+void test_cbc_stream(FILE *fp) {
+    // Message fed in random-sized pieces must match the one-shot call on the padded data
+    size_t size = 200 * 1024 + 5;
+    size_t padded = size + 8 - size % 8;
+    uint8_t iv[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    uint8_t *original = (uint8_t *)malloc(padded), *expected = (uint8_t *)malloc(padded);
+    uint8_t *stream = (uint8_t *)malloc(padded + 8), *plain = (uint8_t *)malloc(padded + 8);
+    DES_RoundKeys keys;
+    DES3_RoundKeys keys3;
+    DES_CbcContext ctx;
+    int ok = original && expected && stream && plain;
+
+    des_key_setup(0x133457799BBCDFF1ULL, &keys);
+    des3_key_setup(0x0123456789ABCDEFULL, 0x23456789ABCDEF01ULL, 0x456789ABCDEF0123ULL, &keys3);
+    for (int triple = 0; triple <= 1 && ok; triple++) {
+        for (size_t i = 0; i < size; i++) original[i] = rand() & 0xFF;
+        memcpy(expected, original, size);
+        memset(expected + size, (int)(padded - size), padded - size);
+        if (triple) des3_cbc_encrypt(expected, padded, &keys3, iv);
+        else des_cbc_encrypt_with_keys(expected, padded, &keys, iv);
+
+        // Encrypt in pieces of 0-40 bytes, with the odd large one
+        size_t in = 0, out = 0, piece, n;
+        if (triple) des3_cbc_init(&ctx, &keys3, iv, DES_ENCRYPT);
+        else des_cbc_init(&ctx, &keys, iv, DES_ENCRYPT);
+        while (in < size) {
+            piece = rand() % 16 == 0 ? (size_t)(rand() % 70000) : (size_t)(rand() % 41);
+            if (piece > size - in) piece = size - in;
+            out += des_cbc_update(&ctx, original + in, piece, stream + out);
+            in += piece;
+        }
+        ok = ok && des_cbc_final(&ctx, stream + out, &n) == 0;
+        out += n;
+        ok = ok && out == padded && memcmp(stream, expected, padded) == 0;
+
+        // Decrypt in different pieces
+        in = out = 0;
+        if (triple) des3_cbc_init(&ctx, &keys3, iv, DES_DECRYPT);
+        else des_cbc_init(&ctx, &keys, iv, DES_DECRYPT);
+        while (in < padded) {
+            piece = rand() % 16 == 0 ? (size_t)(rand() % 70000) : (size_t)(rand() % 41);
+            if (piece > padded - in) piece = padded - in;
+            out += des_cbc_update(&ctx, expected + in, piece, plain + out);
+            in += piece;
+        }
+        ok = ok && des_cbc_final(&ctx, plain + out, &n) == 0;
+        out += n;
+        ok = ok && out == size && memcmp(plain, original, size) == 0;
+    }
+
+    // Truncated ciphertext and corrupt padding are rejected
+    size_t n;
+    des_cbc_init(&ctx, &keys, iv, DES_DECRYPT);
+    des_cbc_update(&ctx, expected, 12, plain);
+    ok = ok && des_cbc_final(&ctx, plain, &n) == -1;
+    des_cbc_init(&ctx, &keys, iv, DES_DECRYPT);
+    ok = ok && des_cbc_final(&ctx, plain, &n) == -1;
+    memset(stream, 0, 16);  // Unpadded: the last plaintext byte is 0
+    des_cbc_encrypt_with_keys(stream, 16, &keys, iv);
+    des_cbc_init(&ctx, &keys, iv, DES_DECRYPT);
+    des_cbc_update(&ctx, stream, 16, plain);
+    ok = ok && des_cbc_final(&ctx, plain, &n) == -1;
+
+    free(original);
+    free(expected);
+    free(stream);
+    free(plain);
+
+    fprintf(fp, "\n=== Incremental CBC ===\n");
+    fprintf(fp, "Pieced DES/3DES CBC matches one-shot and rejects bad padding: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Incremental CBC FAILED\n");
+    }
+}
+
+void test_cbc_decrypt_slices(FILE *fp) {
+    // Large enough to split into several slices, each seeded from the last ciphertext
+    // block of the slice before; ciphertext comes from the scalar kernel
+    size_t size = 5 * 64 * 1024 + 8 * 13;
+    uint8_t iv[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    uint8_t *original = (uint8_t *)malloc(size), *cipher = (uint8_t *)malloc(size);
+    uint8_t *data = (uint8_t *)malloc(size);
+    int ok = original && cipher && data;
+    DES_RoundKeys round_keys;
+    des_key_setup(0x133457799BBCDFF1ULL, &round_keys);
+
+    DES_Kernel saved = des_get_kernel();
+    if (ok) {
+        for (size_t i = 0; i < size; i++) original[i] = rand() & 0xFF;
+        memcpy(cipher, original, size);
+        des_set_kernel(DES_KERNEL_SCALAR);
+        des_cbc_encrypt_with_keys(cipher, size, &round_keys, iv);
+    }
+    static const int thread_counts[] = {1, 3, 6};
+    for (int k = 0; ok && k < DES_KERNEL_COUNT; k++) {
+        if (des_set_kernel((DES_Kernel)k) != 0) continue;
+        for (size_t t = 0; ok && t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+            des_set_threads(thread_counts[t]);
+            memcpy(data, cipher, size);
+            des_cbc_decrypt_with_keys(data, size, &round_keys, iv);
+            ok = memcmp(data, original, size) == 0;
+        }
+    }
+    des_set_threads(0);
+    des_set_kernel(saved);
+    free(original);
+    free(cipher);
+    free(data);
+
+    fprintf(fp, "=== Sliced CBC Decryption ===\n");
+    fprintf(fp, "1, 3 and 6 slices on every kernel match scalar CBC: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Sliced CBC decryption FAILED\n");
+    }
+}
+
+void test_cbc_streams(FILE *fp) {
+    // Ragged lengths (empty, short, and past 64 blocks without being a multiple), every
+    // other stream with its own key, each with its own IV, split over threads on every
+    // kernel: each stream must match des_cbc_encrypt_with_keys on its own
+    enum { STREAMS = 3000 };
+    DES_CbcStream *streams = (DES_CbcStream *)calloc(STREAMS, sizeof(DES_CbcStream));
+    DES_RoundKeys *keys = (DES_RoundKeys *)malloc(STREAMS * sizeof(DES_RoundKeys));
+    uint8_t **originals = (uint8_t **)calloc(STREAMS, sizeof(uint8_t *));
+    uint8_t **expected = (uint8_t **)calloc(STREAMS, sizeof(uint8_t *));
+    int ok = streams && keys && originals && expected;
+
+    for (int s = 0; ok && s < STREAMS; s++) {
+        size_t blocks = (size_t)(rand() % 64);
+        if (s % 11 == 0) blocks = 0;
+        else if (s % 5 == 0) blocks = 64 * (1 + rand() % 3) + 1 + rand() % 63;
+        streams[s].length = 8 * blocks;
+        streams[s].data = (uint8_t *)malloc(streams[s].length + 1);
+        originals[s] = (uint8_t *)malloc(streams[s].length + 1);
+        expected[s] = (uint8_t *)malloc(streams[s].length + 1);
+        ok = ok && streams[s].data && originals[s] && expected[s];
+        if (!ok) break;
+        for (size_t i = 0; i < streams[s].length; i++) originals[s][i] = rand() & 0xFF;
+        generate_random_iv(streams[s].iv);
+        des_key_setup(s % 2 ? ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand()
+                            : 0x133457799BBCDFF1ULL,
+                      &keys[s]);
+        streams[s].round_keys = &keys[s];
+        memcpy(expected[s], originals[s], streams[s].length);
+        des_cbc_encrypt_with_keys(expected[s], streams[s].length, &keys[s], streams[s].iv);
+    }
+
+    DES_Kernel saved = des_get_kernel();
+    des_set_threads(4);
+    for (int k = 0; ok && k < DES_KERNEL_COUNT; k++) {
+        if (des_set_kernel((DES_Kernel)k) != 0) continue;
+        for (int s = 0; s < STREAMS; s++) memcpy(streams[s].data, originals[s], streams[s].length);
+        des_cbc_encrypt_streams(streams, STREAMS);
+        for (int s = 0; ok && s < STREAMS; s++) {
+            ok = memcmp(streams[s].data, expected[s], streams[s].length) == 0;
+        }
+    }
+    des_set_threads(0);
+    des_set_kernel(saved);
+
+    for (int s = 0; streams && originals && expected && s < STREAMS; s++) {
+        free(streams[s].data);
+        free(originals[s]);
+        free(expected[s]);
+    }
+    free(streams);
+    free(keys);
+    free(originals);
+    free(expected);
+
+    fprintf(fp, "=== CBC Streams ===\n");
+    fprintf(fp, "Every stream matches des_cbc_encrypt_with_keys on every kernel: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("CBC streams FAILED\n");
+    }
+}
+
+void test_avalanche(FILE *fp) {
+    // Bulk counts on every kernel must match a block-at-a-time recount (100 samples
+    // leave a partial pass)
+    enum { SAMPLES = 100 };
+    uint64_t plaintexts[SAMPLES], keys[SAMPLES];
+    DES_AvalancheCounts *expected = (DES_AvalancheCounts *)calloc(1, sizeof(DES_AvalancheCounts));
+    DES_AvalancheCounts *counts = (DES_AvalancheCounts *)malloc(sizeof(DES_AvalancheCounts));
+    int ok = expected && counts;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        plaintexts[i] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        keys[i] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+    }
+    for (int target = DES_AVALANCHE_PLAINTEXT; target <= DES_AVALANCHE_KEY && ok; target++) {
+        memset(expected, 0, sizeof(DES_AvalancheCounts));
+        for (int i = 0; i < SAMPLES; i++) {
+            uint8_t block[8], base[8], changed[8];
+            DES_RoundKeys round_keys;
+            des_uint64_to_be_bytes(plaintexts[i], block);
+            des_key_setup(keys[i], &round_keys);
+            des_encrypt_block_with_keys(block, base, &round_keys);
+            for (int input = 0; input < (target == DES_AVALANCHE_KEY ? 56 : 64); input++) {
+                if (target == DES_AVALANCHE_KEY) {
+                    des_key_setup(keys[i] ^ (1ULL << (63 - (input + input / 7))), &round_keys);
+                    des_encrypt_block_with_keys(block, changed, &round_keys);
+                    des_key_setup(keys[i], &round_keys);
+                } else {
+                    uint8_t flipped[8];
+                    des_uint64_to_be_bytes(plaintexts[i] ^ (1ULL << (63 - input)), flipped);
+                    des_encrypt_block_with_keys(flipped, changed, &round_keys);
+                }
+                uint64_t d = des_be_bytes_to_uint64(base) ^ des_be_bytes_to_uint64(changed);
+                for (int j = 0; j < 64; j++) {
+                    if (!((d >> (63 - j)) & 1)) continue;
+                    expected->flips[input][j]++;
+                    for (int k = j + 1; k < 64; k++) expected->pairs[input][j][k] += (d >> (63 - k)) & 1;
+                }
+            }
+        }
+        expected->samples = SAMPLES;
+
+        DES_Kernel saved = des_get_kernel();
+        for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+            if (!des_kernel_supported((DES_Kernel)k)) continue;
+            des_set_kernel((DES_Kernel)k);
+            memset(counts, 0, sizeof(DES_AvalancheCounts));
+            des_avalanche_accumulate(plaintexts, keys, SAMPLES, target, 1, counts);
+            ok = ok && memcmp(counts, expected, sizeof(DES_AvalancheCounts)) == 0;
+        }
+        des_set_kernel(saved);
+    }
+    free(expected);
+    free(counts);
+
+    fprintf(fp, "=== Avalanche Statistics ===\n");
+    fprintf(fp, "Bulk SAC/BIC counts match block-at-a-time counts: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Avalanche statistics FAILED\n");
+    }
+}
+
+void test_reduced_rounds(FILE *fp) {
+    // Every round count on every kernel (1000 blocks end in a partial pass) must match a
+    // bit-at-a-time Feistel network, states included; 16 rounds must be plain DES
+    enum { BLOCKS = 1000 };
+    uint8_t *reference = (uint8_t *)malloc(8 * BLOCKS), *data = (uint8_t *)malloc(8 * BLOCKS);
+    uint64_t *expected = (uint64_t *)malloc(BLOCKS * 17 * sizeof(uint64_t));
+    uint64_t *states = (uint64_t *)malloc(BLOCKS * 17 * sizeof(uint64_t));
+    uint64_t subkeys[16];
+    DES_RoundKeys round_keys;
+    int ok = reference && data && expected && states;
+
+    des_key_setup(0x0E329232EA6D0D73ULL, &round_keys);
+    des_generate_round_keys(0x0E329232EA6D0D73ULL, subkeys);
+    for (int i = 0; ok && i < 8 * BLOCKS; i++) reference[i] = rand() & 0xFF;
+
+    DES_Kernel saved = des_get_kernel();
+    for (int rounds = 1; ok && rounds <= 16; rounds++) {
+        uint64_t last[BLOCKS];
+        for (int b = 0; b < BLOCKS; b++) {
+            uint64_t state, *s = expected + b * (rounds + 1);
+            des_apply_permutation(&state, des_be_bytes_to_uint64(reference + 8 * b), DES_INITIAL_MESSAGE_PERMUTATION, 64);
+            s[0] = state;
+            for (int r = 0; r < rounds; r++) {
+                uint32_t f, left = (uint32_t)(s[r] >> 32), right = (uint32_t)s[r];
+                des_feistel_function(right, subkeys[r], &f);
+                s[r + 1] = ((uint64_t)right << 32) | (left ^ f);
+            }
+            uint64_t swapped = (s[rounds] << 32) | (s[rounds] >> 32);
+            des_apply_permutation(&last[b], swapped, DES_FINAL_MESSAGE_PERMUTATION, 64);
+        }
+
+        for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+            if (des_set_kernel((DES_Kernel)k) != 0) continue;
+            memcpy(data, reference, 8 * BLOCKS);
+            ok = ok && des_ecb_encrypt_rounds(data, 8 * BLOCKS, &round_keys, rounds, states) == 0;
+            ok = ok && memcmp(states, expected, BLOCKS * (rounds + 1) * sizeof(uint64_t)) == 0;
+            for (int b = 0; b < BLOCKS; b++) ok = ok && des_be_bytes_to_uint64(data + 8 * b) == last[b];
+            // Without a tap the output must not change
+            memcpy(data, reference, 8 * BLOCKS);
+            des_ecb_encrypt_rounds(data, 8 * BLOCKS, &round_keys, rounds, NULL);
+            for (int b = 0; b < BLOCKS; b++) ok = ok && des_be_bytes_to_uint64(data + 8 * b) == last[b];
+        }
+        uint8_t block[8];
+        ok = ok && des_encrypt_block_rounds(reference, block, &round_keys, rounds, states) == 0;
+        ok = ok && des_be_bytes_to_uint64(block) == last[0] && memcmp(states, expected, (rounds + 1) * sizeof(uint64_t)) == 0;
+        if (rounds == 16) {
+            memcpy(data, reference, 8 * BLOCKS);
+            des_ecb_encrypt(data, 8 * BLOCKS, &round_keys);
+            for (int b = 0; b < BLOCKS; b++) ok = ok && des_be_bytes_to_uint64(data + 8 * b) == last[b];
+        }
+    }
+    des_set_kernel(saved);
+    ok = ok && des_encrypt_block_rounds(reference, data, &round_keys, 0, NULL) == -1 &&
+         des_ecb_encrypt_rounds(data, 8, &round_keys, 17, NULL) == -1;
+    free(reference);
+    free(data);
+    free(expected);
+    free(states);
+
+    fprintf(fp, "=== Reduced-Round Encryption ===\n");
+    fprintf(fp, "Rounds 1-16 with state taps match the reference Feistel network: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Reduced-round encryption FAILED\n");
+    }
+}
+
+void test_sbox_ddt(FILE *fp) {
+    // Rows hold all 64 inputs, zero difference only maps to zero, and entries are even;
+    // S1 34 -> 2 is the 16/64 entry from Biham and Shamir
+    uint32_t ddt[64][16];
+    int ok = 1;
+    for (int box = 0; box < 8; box++) {
+        des_sbox_ddt(box, ddt);
+        ok = ok && ddt[0][0] == 64;
+        for (int a = 0; a < 64; a++) {
+            uint32_t sum = 0;
+            for (int b = 0; b < 16; b++) {
+                sum += ddt[a][b];
+                ok = ok && ddt[a][b] % 2 == 0 && (a != 0 || b == 0 || ddt[a][b] == 0);
+            }
+            ok = ok && sum == 64;
+        }
+        if (box == 0) ok = ok && ddt[0x34][0x2] == 16;
+    }
+
+    fprintf(fp, "=== S-Box Difference Distribution ===\n");
+    fprintf(fp, "Difference distribution tables are consistent: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("S-box difference distribution FAILED\n");
+    }
+}
+
+void test_sbox_lat(FILE *fp) {
+    // Zero masks are unbiased, every nonzero output mask satisfies Parseval (the squared
+    // entries of a column sum to 1024), and S5 16 -> 15 is Matsui's NS5 = 12 entry
+    int32_t lat[64][16];
+    int ok = 1;
+    for (int box = 0; box < 8; box++) {
+        des_sbox_lat(box, lat);
+        ok = ok && lat[0][0] == 32;
+        for (int b = 1; b < 16; b++) {
+            int32_t energy = 0;
+            for (int a = 0; a < 64; a++) {
+                energy += lat[a][b] * lat[a][b];
+                ok = ok && lat[a][b] % 2 == 0 && (a != 0 || lat[a][b] == 0) && lat[a][0] == (a == 0 ? 32 : 0);
+            }
+            ok = ok && energy == 1024;
+        }
+        if (box == 4) ok = ok && lat[16][15] == -20;
+    }
+
+    fprintf(fp, "=== S-Box Linear Approximation ===\n");
+    fprintf(fp, "Linear approximation tables are consistent: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("S-box linear approximation FAILED\n");
+    }
+}
+
+void test_correlation_counts(FILE *fp) {
+    // Every kernel's counts must match a bit-by-bit recount (1000 pairs end in a partial batch)
+    enum { PAIRS = 1000 };
+    uint64_t a[PAIRS], b[PAIRS];
+    DES_CorrelationCounts *expected = (DES_CorrelationCounts *)calloc(1, sizeof(DES_CorrelationCounts));
+    DES_CorrelationCounts *counts = (DES_CorrelationCounts *)malloc(sizeof(DES_CorrelationCounts));
+    int ok = expected && counts;
+
+    for (int n = 0; n < PAIRS && ok; n++) {
+        a[n] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        b[n] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        for (int i = 0; i < 64; i++) {
+            int bit_a = (a[n] >> (63 - i)) & 1;
+            expected->ones_a[i] += bit_a;
+            expected->ones_b[i] += (b[n] >> (63 - i)) & 1;
+            for (int j = 0; j < 64; j++) expected->both[i][j] += bit_a & ((b[n] >> (63 - j)) & 1);
+        }
+    }
+    if (ok) expected->samples = PAIRS;
+
+    DES_Kernel saved = des_get_kernel();
+    for (int k = 0; k < DES_KERNEL_COUNT && ok; k++) {
+        if (!des_kernel_supported((DES_Kernel)k)) continue;
+        des_set_kernel((DES_Kernel)k);
+        memset(counts, 0, sizeof(DES_CorrelationCounts));
+        des_correlation_accumulate(a, b, 300, counts);
+        des_correlation_accumulate(a + 300, b + 300, PAIRS - 300, counts);
+        ok = memcmp(counts, expected, sizeof(DES_CorrelationCounts)) == 0;
+    }
+    des_set_kernel(saved);
+    free(expected);
+    free(counts);
+
+    fprintf(fp, "=== Correlation Counts ===\n");
+    fprintf(fp, "Bulk bit co-occurrence counts match bit-by-bit counts: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Correlation counts FAILED\n");
+    }
+}
+
+typedef struct {
+    DES_KeyCache *cache;
+    const uint64_t *keys;
+    const DES_RoundKeys *expected;
+    unsigned seed;
+    int ok;
+} KeyCacheThread;
+
+enum { KEY_CACHE_KEYS = 64, KEY_CACHE_LOOKUPS = 20000 };
+
+static void *key_cache_thread(void *arg) {
+    KeyCacheThread *t = (KeyCacheThread *)arg;
+    DES_RoundKeys round_keys;
+    t->ok = 1;
+    for (int i = 0; i < KEY_CACHE_LOOKUPS; i++) {
+        int k = rand_r(&t->seed) % KEY_CACHE_KEYS;
+        des_key_cache_setup(t->cache, t->keys[k], &round_keys);
+        t->ok = t->ok && memcmp(&round_keys, &t->expected[k], sizeof(round_keys)) == 0;
+    }
+    return NULL;
+}
+
+void test_key_cache(FILE *fp) {
+    // Hits must return exactly what des_key_setup does, with four threads churning a cache
+    // half the size of the key set; parity bits must not matter
+    uint64_t keys[KEY_CACHE_KEYS];
+    DES_RoundKeys expected[KEY_CACHE_KEYS], round_keys;
+    DES_KeyCacheStats stats;
+    KeyCacheThread threads[4];
+    pthread_t ids[4];
+
+    for (int k = 0; k < KEY_CACHE_KEYS; k++) {
+        keys[k] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        des_key_setup(keys[k], &expected[k]);
+    }
+    DES_KeyCache *cache = des_key_cache_create(KEY_CACHE_KEYS / 2);
+    int ok = cache != NULL;
+    for (int t = 0; ok && t < 4; t++) {
+        threads[t] = (KeyCacheThread){cache, keys, expected, (unsigned)(t + 1), 0};
+        pthread_create(&ids[t], NULL, key_cache_thread, &threads[t]);
+    }
+    for (int t = 0; ok && t < 4; t++) {
+        pthread_join(ids[t], NULL);
+        ok = ok && threads[t].ok;
+    }
+    if (ok) {
+        des_key_cache_stats(cache, &stats);
+        ok = stats.capacity == KEY_CACHE_KEYS / 2 && stats.hits + stats.misses == 4 * KEY_CACHE_LOOKUPS &&
+             stats.hits > 0 && stats.entries <= stats.capacity && stats.evictions + stats.entries <= stats.misses;
+        // The entry just used is the most recent in its set, so its parity twin hits
+        des_key_cache_setup(cache, keys[0], &round_keys);
+        des_key_cache_setup(cache, keys[0] ^ 0x0101010101010101ULL, &round_keys);
+        uint64_t hits = stats.hits;
+        des_key_cache_stats(cache, &stats);
+        ok = ok && stats.hits >= hits + 1 && memcmp(&round_keys, &expected[0], sizeof(round_keys)) == 0;
+    }
+    des_key_cache_destroy(cache);
+
+    fprintf(fp, "=== Key-Schedule Cache ===\n");
+    fprintf(fp, "Cached contexts match des_key_setup across threads: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Key-schedule cache FAILED\n");
+    }
+}
+
+void test_multikey(FILE *fp) {
+    // Every kernel, split over threads, with a partial pass at the end: block i must be
+    // des_encrypt_block under keys[i], and decryption must undo it in place
+    enum { PAIRS = 20000 };
+    uint64_t *keys = (uint64_t *)malloc(PAIRS * sizeof(uint64_t));
+    uint8_t *input = (uint8_t *)malloc(8 * PAIRS), *expected = (uint8_t *)malloc(8 * PAIRS);
+    uint8_t *output = (uint8_t *)malloc(8 * PAIRS);
+    int ok = keys && input && expected && output;
+
+    for (int i = 0; ok && i < PAIRS; i++) {
+        keys[i] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        for (int j = 0; j < 8; j++) input[8 * i + j] = rand() & 0xFF;
+        des_encrypt_block(input + 8 * i, expected + 8 * i, keys[i]);
+    }
+
+    DES_Kernel saved = des_get_kernel();
+    des_set_threads(4);
+    for (int k = 0; ok && k < DES_KERNEL_COUNT; k++) {
+        if (des_set_kernel((DES_Kernel)k) != 0) continue;
+        des_encrypt_blocks_multikey(keys, input, output, PAIRS);
+        ok = memcmp(output, expected, 8 * PAIRS) == 0;
+        des_decrypt_blocks_multikey(keys, output, output, PAIRS);
+        ok = ok && memcmp(output, input, 8 * PAIRS) == 0;
+    }
+    des_set_threads(0);
+    des_set_kernel(saved);
+    free(keys);
+    free(input);
+    free(expected);
+    free(output);
+
+    fprintf(fp, "=== Key-Agile Batches ===\n");
+    fprintf(fp, "One block per key matches des_encrypt_block on every kernel: %s\n", ok ? "SUCCESS" : "FAILURE");
+    if (!ok) {
+        printf("Key-agile batches FAILED\n");
+    }
+}
+
 void test_cbc_mode(size_t data_size, uint64_t key, FILE *fp, uint8_t *input_text) {
     fprintf(fp, "\n=== Testing CBC Mode for %zu Bytes ===\n", data_size);
 
@@ -72,6 +936,26 @@ int main() {
         return 1;
     }
 
+    test_known_answers(fp);
+    test_permutations(fp);
+    test_kernels(fp);
+    test_ctr_mode(fp);
+    test_ctr_ranges(fp);
+    test_key_search(fp);
+    test_key_enum(fp);
+    test_bitslice(fp);
+    test_triple_des(fp);
+    test_cbc_stream(fp);
+    test_cbc_decrypt_slices(fp);
+    test_cbc_streams(fp);
+    test_avalanche(fp);
+    test_reduced_rounds(fp);
+    test_sbox_ddt(fp);
+    test_sbox_lat(fp);
+    test_correlation_counts(fp);
+    test_key_cache(fp);
+    test_multikey(fp);
+
     uint64_t key = 0x133457799BBCDFF1;
     uint8_t input_text[16];
     
@@ -0,0 +1,147 @@
+#include "des_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// ================================
+//      Thread Pool
+// ================================
+
+// Workers are started on first use and kept for the life of the process. A job is a
+// range of task indices; the caller and the workers pull indices until none are left.
+
+static pthread_mutex_t des_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t des_pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t des_pool_done = PTHREAD_COND_INITIALIZER;
+
+static pthread_t des_pool_workers[DES_MAX_THREADS];
+static int des_pool_started = 0;    // Worker threads created so far
+static int des_thread_count = 0;    // Threads per job, including the caller (0 = not chosen yet)
+
+static struct {
+    des_task_fn fn;
+    void *arg;
+    size_t tasks;
+    size_t next;
+    size_t finished;
+    int participants;   // Workers with index below this take part
+    unsigned generation;
+    int active;
+} des_job;
+
+// Capped at DES_MAX_THREADS like des_set_threads, so every reader of the count is bounded
+static int des_default_threads(void) {
+    const char *env = getenv("DES_THREADS");
+    int threads;
+    if (env && atoi(env) > 0) {
+        threads = atoi(env);
+    } else {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threads = (int)info.dwNumberOfProcessors;
+#else
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+#endif
+    }
+    return threads > DES_MAX_THREADS ? DES_MAX_THREADS : threads;
+}
+
+// Pulls task indices of the current job until it is exhausted; called with the lock held
+static void des_pool_drain(void) {
+    while (des_job.next < des_job.tasks) {
+        size_t task = des_job.next++;
+        pthread_mutex_unlock(&des_pool_lock);
+        des_job.fn(des_job.arg, task);
+        pthread_mutex_lock(&des_pool_lock);
+        if (++des_job.finished == des_job.tasks) {
+            pthread_cond_broadcast(&des_pool_done);
+        }
+    }
+}
+
+static void *des_pool_worker(void *arg) {
+    int index = (int)(intptr_t)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&des_pool_lock);
+    for (;;) {
+        while (des_job.generation == seen) {
+            pthread_cond_wait(&des_pool_work, &des_pool_lock);
+        }
+        seen = des_job.generation;
+        if (index < des_job.participants) {
+            des_pool_drain();
+        }
+    }
+    return NULL;
+}
+
+void des_set_threads(int threads) {
+    pthread_mutex_lock(&des_pool_lock);
+    if (threads <= 0) threads = des_default_threads();
+    des_thread_count = threads > DES_MAX_THREADS ? DES_MAX_THREADS : threads;
+    pthread_mutex_unlock(&des_pool_lock);
+}
+
+int des_get_threads(void) {
+    pthread_mutex_lock(&des_pool_lock);
+    if (des_thread_count == 0) des_thread_count = des_default_threads();
+    int threads = des_thread_count;
+    pthread_mutex_unlock(&des_pool_lock);
+    return threads;
+}
+
+static void des_parallel_run(size_t tasks, des_task_fn fn, void *arg) {
+    int threads = des_get_threads();
+
+    pthread_mutex_lock(&des_pool_lock);
+    // Nested or concurrent jobs, single tasks and single-thread runs stay on the caller
+    if (des_job.active || tasks <= 1 || threads <= 1) {
+        pthread_mutex_unlock(&des_pool_lock);
+        for (size_t task = 0; task < tasks; task++) {
+            fn(arg, task);
+        }
+        return;
+    }
+
+    int workers = threads - 1;
+    if ((size_t)workers > tasks - 1) workers = (int)(tasks - 1);
+    while (des_pool_started < workers) {
+        if (pthread_create(&des_pool_workers[des_pool_started], NULL, des_pool_worker,
+                           (void *)(intptr_t)des_pool_started) != 0) {
+            break;
+        }
+        pthread_detach(des_pool_workers[des_pool_started]);
+        des_pool_started++;
+    }
+
+    des_job.fn = fn;
+    des_job.arg = arg;
+    des_job.tasks = tasks;
+    des_job.next = 0;
+    des_job.finished = 0;
+    des_job.participants = workers < des_pool_started ? workers : des_pool_started;
+    des_job.active = 1;
+    des_job.generation++;
+    pthread_cond_broadcast(&des_pool_work);
+
+    des_pool_drain();
+    while (des_job.finished < des_job.tasks) {
+        pthread_cond_wait(&des_pool_done, &des_pool_lock);
+    }
+    des_job.active = 0;
+    pthread_mutex_unlock(&des_pool_lock);
+}
+
+void des_parallel_for(size_t tasks, des_task_fn fn, void *arg) {
+    DES_PROFILE_BEGIN(DES_STAGE_THREAD_POOL);
+    des_parallel_run(tasks, fn, arg);
+    DES_PROFILE_END(DES_STAGE_THREAD_POOL);
+}
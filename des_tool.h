@@ -0,0 +1,27 @@
+#ifndef DES_TOOL_H
+#define DES_TOOL_H
+
+// Helpers shared by the command-line programs (brute_force.c, des_file.c, the analysis tools).
+// Not part of the library.
+
+#include <stdint.h>
+#include <time.h>
+
+#define MAX_THREADS 256  // Worker array size; the library caps its own count the same way
+
+static inline double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// SplitMix64: cheap, well mixed, and seekable, so chunks are reproducible for a seed
+// whatever thread runs them
+static inline uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+#endif
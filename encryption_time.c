@@ -1,3 +1,25 @@
+/*
+ * DES Benchmark Suite
+ * Measures every mode of the library (permutation tables, block API, ECB, CBC, incremental
+ * CBC, multi-stream CBC, CTR, 3DES, key setup and key trials) over a sweep of buffer sizes,
+ * bulk kernels and thread counts. Each point is warmed up, then timed over repeated trials;
+ * the median and 10th/90th percentile rates and the median cycles per byte (or per key, or
+ * per permutation) are reported.
+ * Inputs are generated once per buffer size, outside the timed loops.
+ *
+ * Usage: encryption_time [--cases LIST] [--sizes LIST] [--kernels LIST|all] [--threads LIST|all]
+ *                        [--trials N] [--warmup SEC] [--min-time SEC]
+ *                        [--json FILE] [--csv FILE] [--quiet] [--list]
+ *        encryption_time --compare BASE NEW [--threshold PCT]
+ *
+ * LISTs are comma separated; sizes take K and M suffixes. Cases that do not use the bulk
+ * kernels are run once (kernel "-"), and only cases the library parallelizes are swept
+ * over thread counts. --compare reads two result files (JSON or CSV from this program),
+ * prints the change of every common point and exits with status 1 when a median rate
+ * dropped by more than the threshold (default 5%) and the two runs' p10-p90 ranges do not
+ * overlap (so trial noise alone is not flagged).
+ */
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -15,6 +37,7 @@ double get_time() {
 }
 #else
 #include <sys/time.h>
+#include <unistd.h>
 double get_time() {
     struct timespec t;
     clock_gettime(CLOCK_MONOTONIC, &t);
@@ -22,94 +45,760 @@ double get_time() {
 }
 #endif
 
-#define ITERATIONS 5
-#define UNROLL_FACTOR 8  // Unrolling factor for optimization
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t get_cycles() { return __rdtsc(); }
+#define CYCLE_COUNTER "tsc"
+#else
+static inline uint64_t get_cycles() { return (uint64_t)(get_time() * 1e9); }  // Nanoseconds without a TSC
+#define CYCLE_COUNTER "ns"
+#endif
 
-void test_encryption_time(size_t data_size, uint64_t key) {
-    double total_enc_time = 0, total_dec_time = 0;
+#define MAX_TRIALS 101
+#define MAX_LIST 32
+#define STREAM_RECORD 256   // Record length of the multi-stream CBC case
+#define UPDATE_PIECE 64     // Piece length of the incremental CBC case
+#define TENANT_KEYS 4096    // Distinct keys of the keyed-record cases, drawn Zipf(1)
+#define KEY_CACHE_SIZE 1024 // Entries of their key-schedule cache
 
-    // Memory allocation
-    uint8_t *data;
-#ifdef _WIN32
-    printf("Allocating memory (malloc) for %zu Bytes...\n", data_size);
-    fflush(stdout);
-    data = (uint8_t *)malloc(data_size);
-#else
-    printf("Allocating memory (posix_memalign) for %zu Bytes...\n", data_size);
-    fflush(stdout);
-    if (posix_memalign((void **)&data, 16, data_size) != 0) {
-        data = NULL;
+// ================================
+//      Benchmark Cases
+// ================================
+
+// Inputs shared by every case at one buffer size
+typedef struct {
+    size_t size;
+    uint8_t *data;              // size bytes, transformed in place by the runs
+    uint8_t *scratch;           // size + 16 bytes of output space
+    DES_RoundKeys keys;
+    DES3_RoundKeys keys3;
+    uint8_t iv[8];
+    DES_CbcStream *streams;     // The buffer cut into STREAM_RECORD-byte records
+    size_t stream_count;
+    uint64_t *key_list;         // size / 8 candidate keys for the key cases
+    uint64_t *tenant_keys;      // size / 8 + 1 Zipf-distributed keys of the keyed-record cases
+    DES_KeyCache *key_cache;
+    uint64_t *matches;
+    DES_KeyTest key_test;
+    uint8_t plaintext[8];
+    uint8_t ciphertext[8];
+    volatile uint64_t sink;     // Keeps results of otherwise unused work alive
+} Bench;
+
+// What a case's rate counts: bytes, or one key (or permutation of each table) per 8 bytes
+enum { UNIT_BYTES, UNIT_KEYS, UNIT_PERMS };
+static const char *const unit_rates[] = {"MB/s", "Mkeys/s", "Mperm/s"};
+static const char *const unit_names[] = {"byte", "key", "perm"};
+
+typedef struct {
+    const char *name;
+    int unit;           // UNIT_BYTES, UNIT_KEYS or UNIT_PERMS
+    int kernel;         // Uses the bulk kernel: swept over kernels
+    int threaded;       // Parallelized by the library: swept over thread counts
+    void (*run)(Bench *b);
+    const char *description;
+} BenchCase;
+
+// One block through the bit-at-a-time reference round (des_feistel_function)
+static void reference_encrypt_block(const uint8_t *input, uint8_t *output, const DES_RoundKeys *round_keys) {
+    uint64_t permuted;
+    des_apply_permutation(&permuted, des_be_bytes_to_uint64(input), DES_INITIAL_MESSAGE_PERMUTATION, 64);
+    uint32_t left = permuted >> 32, right = (uint32_t)permuted;
+    for (int i = 0; i < 16; i++) {
+        uint32_t f;
+        des_feistel_function(right, round_keys->subkeys[i], &f);
+        uint32_t temp = right;
+        right = left ^ f;
+        left = temp;
     }
-#endif
+    uint64_t data;
+    des_apply_permutation(&data, ((uint64_t)right << 32) | left, DES_FINAL_MESSAGE_PERMUTATION, 64);
+    des_uint64_to_be_bytes(data, output);
+}
+
+static void run_reference(Bench *b) {
+    for (size_t i = 0; i + 8 <= b->size; i += 8) reference_encrypt_block(b->data + i, b->data + i, &b->keys);
+}
+
+static void run_block_rekey(Bench *b) {
+    for (size_t i = 0; i + 8 <= b->size; i += 8) des_encrypt_block(b->data + i, b->data + i, 0x133457799BBCDFF1ULL);
+}
+
+static void run_block(Bench *b) {
+    for (size_t i = 0; i + 8 <= b->size; i += 8) des_encrypt_block_with_keys(b->data + i, b->data + i, &b->keys);
+}
+
+static void run_ecb_encrypt(Bench *b) { des_ecb_encrypt(b->data, b->size, &b->keys); }
+static void run_ecb_decrypt(Bench *b) { des_ecb_decrypt(b->data, b->size, &b->keys); }
+static void run_cbc_encrypt(Bench *b) { des_cbc_encrypt_with_keys(b->data, b->size, &b->keys, b->iv); }
+static void run_cbc_decrypt(Bench *b) { des_cbc_decrypt_with_keys(b->data, b->size, &b->keys, b->iv); }
+static void run_ctr(Bench *b) { des_ctr_xcrypt(b->data, b->size, &b->keys, b->iv, 0); }
+static void run_cbc_streams(Bench *b) { des_cbc_encrypt_streams(b->streams, b->stream_count); }
+static void run_3des_ecb(Bench *b) { des3_ecb_encrypt(b->data, b->size, &b->keys3); }
+static void run_3des_cbc_encrypt(Bench *b) { des3_cbc_encrypt(b->data, b->size, &b->keys3, b->iv); }
+static void run_3des_cbc_decrypt(Bench *b) { des3_cbc_decrypt(b->data, b->size, &b->keys3, b->iv); }
+static void run_3des_ctr(Bench *b) { des3_ctr_xcrypt(b->data, b->size, &b->keys3, b->iv, 0); }
+
+static void run_cbc_update(Bench *b) {
+    DES_CbcContext ctx;
+    size_t written = 0, tail;
+    des_cbc_init(&ctx, &b->keys, b->iv, DES_ENCRYPT);
+    for (size_t at = 0; at < b->size; at += UPDATE_PIECE) {
+        size_t length = b->size - at < UPDATE_PIECE ? b->size - at : UPDATE_PIECE;
+        written += des_cbc_update(&ctx, b->data + at, length, b->scratch + written);
+    }
+    des_cbc_final(&ctx, b->scratch + written, &tail);
+}
+
+static void run_key_setup(Bench *b) {
+    DES_RoundKeys round_keys;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < b->size / 8; i++) {
+        des_key_setup(b->key_list[i], &round_keys);
+        sum += round_keys.subkeys[15];
+    }
+    b->sink += sum;
+}
+
+// One STREAM_RECORD-byte CBC record per tenant key, as a multi-tenant service sees them
+static void run_records_rekey(Bench *b) {
+    DES_RoundKeys round_keys;
+    for (size_t r = 0; r < b->stream_count; r++) {
+        des_key_setup(b->tenant_keys[r], &round_keys);
+        des_cbc_encrypt_with_keys(b->streams[r].data, b->streams[r].length, &round_keys, b->iv);
+    }
+}
+
+static void run_records_cache(Bench *b) {
+    DES_RoundKeys round_keys;
+    for (size_t r = 0; r < b->stream_count; r++) {
+        des_key_cache_setup(b->key_cache, b->tenant_keys[r], &round_keys);
+        des_cbc_encrypt_with_keys(b->streams[r].data, b->streams[r].length, &round_keys, b->iv);
+    }
+}
+
+static void run_key_cache(Bench *b) {
+    DES_RoundKeys round_keys;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < b->size / 8; i++) {
+        des_key_cache_setup(b->key_cache, b->tenant_keys[i], &round_keys);
+        sum += round_keys.subkeys[15];
+    }
+    b->sink += sum;
+}
+
+static void run_multikey(Bench *b) { des_encrypt_blocks_multikey(b->key_list, b->data, b->scratch, b->size / 8); }
+
+static void run_multikey_ref(Bench *b) {
+    DES_RoundKeys round_keys;
+    for (size_t i = 0; i < b->size / 8; i++) {
+        des_key_setup(b->key_list[i], &round_keys);
+        des_encrypt_block_with_keys(b->data + 8 * i, b->scratch + 8 * i, &round_keys);
+    }
+}
+
+static void run_key_trial(Bench *b) {
+    des_key_trial(b->key_list, b->size / 8, b->plaintext, b->ciphertext, b->matches);
+    b->sink += b->matches[0];
+}
+
+static void run_key_test(Bench *b) {
+    uint64_t found[4];
+    b->sink += des_key_test_batch(&b->key_test, b->key_list, b->size / 8, found, 4);
+}
+
+// The six DES permutations, applied in turn to every 8-byte word of the buffer
+static const struct {
+    const uint8_t *table;
+    int n, input_bits;
+} permutations[] = {
+    {DES_INITIAL_MESSAGE_PERMUTATION, 64, 64},
+    {DES_FINAL_MESSAGE_PERMUTATION, 64, 64},
+    {DES_MESSAGE_EXPANSION, 48, 32},
+    {DES_RIGHT_SUB_MESSAGE_PERMUTATION, 32, 32},
+    {DES_INITIAL_KEY_PERMUTATION, 56, 64},
+    {DES_SUB_KEY_PERMUTATION, 48, 56},
+};
+#define PERMUTATION_COUNT (sizeof(permutations) / sizeof(permutations[0]))
+static DES_PermutationLUT permutation_luts[PERMUTATION_COUNT];
+
+static void run_permutation_reference(Bench *b) {
+    uint64_t sum = 0, word, out;
+    for (size_t i = 0; i + 8 <= b->size; i += 8) {
+        memcpy(&word, b->data + i, 8);
+        for (size_t p = 0; p < PERMUTATION_COUNT; p++) {
+            des_apply_permutation(&out, word << (64 - permutations[p].input_bits), permutations[p].table,
+                                  permutations[p].n);
+            sum += out;
+        }
+    }
+    b->sink += sum;
+}
+
+static void run_permutation_lut(Bench *b) {
+    uint64_t sum = 0, word;
+    for (size_t i = 0; i + 8 <= b->size; i += 8) {
+        memcpy(&word, b->data + i, 8);
+        for (size_t p = 0; p < PERMUTATION_COUNT; p++) sum += des_permutation_lut_apply(&permutation_luts[p], word);
+    }
+    b->sink += sum;
+}
+
+static const BenchCase cases[] = {
+    {"perm-ref", UNIT_PERMS, 0, 0, run_permutation_reference, "des_apply_permutation, IP/FP/E/P/PC-1/PC-2 bit at a time"},
+    {"perm-lut", UNIT_PERMS, 0, 0, run_permutation_lut, "des_permutation_lut_apply on the same six tables"},
+    {"reference", UNIT_BYTES, 0, 0, run_reference, "bit-at-a-time reference rounds, one block at a time"},
+    {"block-rekey", UNIT_BYTES, 0, 0, run_block_rekey, "des_encrypt_block (key expanded for every block)"},
+    {"block", UNIT_BYTES, 0, 0, run_block, "des_encrypt_block_with_keys, one block at a time"},
+    {"ecb-enc", UNIT_BYTES, 1, 0, run_ecb_encrypt, "des_ecb_encrypt"},
+    {"ecb-dec", UNIT_BYTES, 1, 0, run_ecb_decrypt, "des_ecb_decrypt"},
+    {"cbc-enc", UNIT_BYTES, 0, 0, run_cbc_encrypt, "des_cbc_encrypt_with_keys"},
+    {"cbc-dec", UNIT_BYTES, 1, 1, run_cbc_decrypt, "des_cbc_decrypt_with_keys"},
+    {"cbc-update", UNIT_BYTES, 0, 0, run_cbc_update, "des_cbc_update in 64-byte pieces, then final"},
+    {"cbc-streams", UNIT_BYTES, 1, 1, run_cbc_streams, "des_cbc_encrypt_streams over 256-byte records"},
+    {"ctr", UNIT_BYTES, 1, 1, run_ctr, "des_ctr_xcrypt"},
+    {"3des-ecb", UNIT_BYTES, 1, 0, run_3des_ecb, "des3_ecb_encrypt"},
+    {"3des-cbc-enc", UNIT_BYTES, 0, 0, run_3des_cbc_encrypt, "des3_cbc_encrypt"},
+    {"3des-cbc-dec", UNIT_BYTES, 1, 1, run_3des_cbc_decrypt, "des3_cbc_decrypt"},
+    {"3des-ctr", UNIT_BYTES, 1, 1, run_3des_ctr, "des3_ctr_xcrypt"},
+    {"records-rekey", UNIT_BYTES, 0, 0, run_records_rekey, "256-byte CBC records, Zipf keys, des_key_setup per record"},
+    {"records-cache", UNIT_BYTES, 0, 0, run_records_cache, "256-byte CBC records, Zipf keys, des_key_cache_setup"},
+    {"key-setup", UNIT_KEYS, 0, 0, run_key_setup, "des_key_setup per key"},
+    {"key-cache", UNIT_KEYS, 0, 0, run_key_cache, "des_key_cache_setup per Zipf key (4096 keys, 1024 entries)"},
+    {"multikey", UNIT_KEYS, 1, 1, run_multikey, "des_encrypt_blocks_multikey (key setup + block per key, in lanes)"},
+    {"multikey-ref", UNIT_KEYS, 0, 0, run_multikey_ref, "des_key_setup + des_encrypt_block_with_keys per key"},
+    {"key-trial", UNIT_KEYS, 1, 0, run_key_trial, "des_key_trial (full 16 rounds per key)"},
+    {"key-test", UNIT_KEYS, 1, 0, run_key_test, "des_key_test_batch (two pairs; early reject where it pays)"},
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+// xorshift64 fill: fast, and the same input on every run of the suite
+static void fill_pattern(uint8_t *data, size_t length, uint64_t seed) {
+    for (size_t i = 0; i < length; i += 8) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        size_t n = length - i < 8 ? length - i : 8;
+        memcpy(data + i, &seed, n);
+    }
+}
+
+// Keys drawn from TENANT_KEYS distinct ones with P(rank k) proportional to 1 / k
+static void fill_zipf_keys(uint64_t *keys, size_t count, uint64_t seed) {
+    static double cdf[TENANT_KEYS];
+    double total = 0;
+    for (int k = 0; k < TENANT_KEYS; k++) cdf[k] = total += 1.0 / (k + 1);
+    for (size_t i = 0; i < count; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        double u = (double)(seed >> 11) / 9007199254740992.0 * total;
+        int low = 0, high = TENANT_KEYS - 1;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (cdf[mid] < u) low = mid + 1;
+            else high = mid;
+        }
+        keys[i] = 0x0123456789ABCDEFULL ^ ((uint64_t)low * 0x9E3779B97F4A7C15ULL);
+    }
+}
+
+static int bench_init(Bench *b, size_t size) {
+    static const uint8_t message[16] = "HELLO123GOODBYE!";
+    uint8_t ciphertexts[16];
+
+    memset(b, 0, sizeof(*b));
+    b->size = size;
+    b->data = (uint8_t *)malloc(size);
+    b->scratch = (uint8_t *)malloc(size + 16);
+    b->stream_count = size >= STREAM_RECORD ? size / STREAM_RECORD : 1;
+    b->streams = (DES_CbcStream *)malloc(b->stream_count * sizeof(DES_CbcStream));
+    b->key_list = (uint64_t *)malloc((size / 8 + 1) * sizeof(uint64_t));
+    b->matches = (uint64_t *)malloc((size / 512 + 1) * sizeof(uint64_t));
+    b->tenant_keys = (uint64_t *)malloc((size / 8 + 1) * sizeof(uint64_t));
+    b->key_cache = des_key_cache_create(KEY_CACHE_SIZE);
+    if (!b->data || !b->scratch || !b->streams || !b->key_list || !b->matches || !b->tenant_keys || !b->key_cache) {
+        return -1;
+    }
+
+    fill_pattern(b->data, size, 0x9E3779B97F4A7C15ULL ^ size);
+    for (size_t p = 0; p < PERMUTATION_COUNT; p++) {
+        des_permutation_lut_init(&permutation_luts[p], permutations[p].table, permutations[p].n,
+                                 permutations[p].input_bits);
+    }
+    des_key_setup(0x133457799BBCDFF1ULL, &b->keys);
+    des3_key_setup(0x133457799BBCDFF1ULL, 0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL, &b->keys3);
+    memcpy(b->iv, "\x11\x22\x33\x44\x55\x66\x77\x88", 8);
+    memcpy(b->plaintext, message, 8);
+
+    size_t record = size < STREAM_RECORD ? size : STREAM_RECORD;
+    for (size_t r = 0; r < b->stream_count; r++) {
+        b->streams[r].data = b->data + r * record;
+        b->streams[r].length = record;
+        b->streams[r].round_keys = &b->keys;
+        memcpy(b->streams[r].iv, b->iv, 8);
+        b->streams[r].iv[7] ^= (uint8_t)r;
+    }
+
+    // Candidate keys near (but not at) the demo key, as a key search would see them
+    uint64_t base = des_key_to_index(0x133457799BBCDFF1ULL) ^ 0x55;
+    for (size_t i = 0; i < size / 8 + 1; i++) b->key_list[i] = des_key_from_index(base + 1 + i);
+    memcpy(ciphertexts, message, 16);
+    des_cbc_encrypt_with_keys(ciphertexts, 16, &b->keys, b->iv);
+    des_encrypt_block_with_keys(b->plaintext, b->ciphertext, &b->keys);
+    uint8_t plaintexts[16];
+    memcpy(plaintexts, message, 16);
+    for (int j = 0; j < 8; j++) {
+        plaintexts[j] ^= b->iv[j];
+        plaintexts[8 + j] ^= ciphertexts[j];
+    }
+    des_key_test_init(&b->key_test, plaintexts, ciphertexts, 2);
+    fill_zipf_keys(b->tenant_keys, size / 8 + 1, 0x2545F4914F6CDD1DULL);
+    return 0;
+}
+
+static void bench_free(Bench *b) {
+    free(b->data);
+    free(b->scratch);
+    free(b->streams);
+    free(b->key_list);
+    free(b->matches);
+    free(b->tenant_keys);
+    des_key_cache_destroy(b->key_cache);
+}
+
+// ================================
+//      Measurement
+// ================================
+
+typedef struct {
+    char name[32];
+    char kernel[16];
+    int threads;
+    size_t size;
+    int unit;               // Rates in unit_rates[unit], cycles per unit_names[unit]
+    double median, p10, p90, min, max;
+    double cycles;          // Median cycles per byte (or key, or permutation)
+} Result;
+
+typedef struct {
+    int trials;
+    double warmup;          // Seconds of warmup per point
+    double min_time;        // Minimum seconds per trial (runs are repeated to reach it)
+} Options;
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between closest ranks of a sorted sample
+static double percentile(const double *sorted, int count, double p) {
+    double rank = p * (count - 1);
+    int low = (int)rank;
+    if (low >= count - 1) return sorted[count - 1];
+    return sorted[low] + (rank - low) * (sorted[low + 1] - sorted[low]);
+}
+
+static void measure(const BenchCase *c, Bench *b, const Options *options, Result *result) {
+    double rates[MAX_TRIALS], cycles[MAX_TRIALS];
+    double units = c->unit == UNIT_BYTES ? (double)b->size
+                 : (double)(b->size / 8) * (c->unit == UNIT_PERMS ? PERMUTATION_COUNT : 1);
+    double scale = c->unit == UNIT_BYTES ? 1024.0 * 1024.0 : 1e6;
+
+    // Warmup (caches, page faults, thread pool start) also sizes the trials
+    long runs = 0;
+    double start = get_time(), elapsed;
+    do {
+        c->run(b);
+        runs++;
+        elapsed = get_time() - start;
+    } while (elapsed < options->warmup);
+    long reps = (long)(options->min_time / (elapsed / runs)) + 1;
 
-    if (!data) {
-        fprintf(stderr, "Memory allocation failed for %zu Bytes!\n", data_size);
-        exit(1);
+    for (int t = 0; t < options->trials; t++) {
+        uint64_t cycles_start = get_cycles();
+        start = get_time();
+        for (long r = 0; r < reps; r++) c->run(b);
+        elapsed = get_time() - start;
+        cycles[t] = (double)(get_cycles() - cycles_start) / (units * reps);
+        rates[t] = units * reps / elapsed / scale;
     }
-    printf("Memory allocated successfully!\n");
+
+    qsort(rates, options->trials, sizeof(double), compare_doubles);
+    qsort(cycles, options->trials, sizeof(double), compare_doubles);
+    result->median = percentile(rates, options->trials, 0.5);
+    result->p10 = percentile(rates, options->trials, 0.1);
+    result->p90 = percentile(rates, options->trials, 0.9);
+    result->min = rates[0];
+    result->max = rates[options->trials - 1];
+    result->cycles = percentile(cycles, options->trials, 0.5);
+}
+
+// ================================
+//      Output
+// ================================
+
+static void cpu_name(char *name, size_t length) {
+    snprintf(name, length, "unknown");
+#ifdef __linux__
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    while (f && fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && colon) {
+            snprintf(name, length, "%s", colon + 2);
+            name[strcspn(name, "\n")] = '\0';
+            break;
+        }
+    }
+    if (f) fclose(f);
+#endif
+}
+
+static void print_result(const Result *r) {
+    printf("%-13s %-10s %3dt %9zu  %10.2f %-7s  [p10 %10.2f  p90 %10.2f]  %8.2f cycles/%s\n", r->name,
+           r->kernel, r->threads, r->size, r->median, unit_rates[r->unit], r->p10, r->p90, r->cycles,
+           unit_names[r->unit]);
     fflush(stdout);
+}
+
+static void write_json(FILE *f, const Result *results, size_t count, const Options *options) {
+    char cpu[128];
+    cpu_name(cpu, sizeof(cpu));
+    fprintf(f, "{\n  \"benchmark\": \"des\",\n  \"cpu\": \"%s\",\n  \"cycle_counter\": \"%s\",\n", cpu,
+            CYCLE_COUNTER);
+    fprintf(f, "  \"default_threads\": %d,\n  \"trials\": %d,\n  \"warmup\": %g,\n  \"min_time\": %g,\n",
+            des_get_threads(), options->trials, options->warmup, options->min_time);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < count; i++) {
+        const Result *r = &results[i];
+        fprintf(f, "    {\"case\": \"%s\", \"kernel\": \"%s\", \"threads\": %d, \"size\": %zu, "
+                "\"unit\": \"%s\", \"median\": %.4f, \"p10\": %.4f, \"p90\": %.4f, \"min\": %.4f, "
+                "\"max\": %.4f, \"cycles_per_%s\": %.4f}%s\n",
+                r->name, r->kernel, r->threads, r->size, unit_rates[r->unit], r->median, r->p10, r->p90,
+                r->min, r->max, unit_names[r->unit], r->cycles, i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static void write_csv(FILE *f, const Result *results, size_t count) {
+    fprintf(f, "case,kernel,threads,size,unit,median,p10,p90,min,max,cycles_per_unit\n");
+    for (size_t i = 0; i < count; i++) {
+        const Result *r = &results[i];
+        fprintf(f, "%s,%s,%d,%zu,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", r->name, r->kernel, r->threads,
+                r->size, unit_rates[r->unit], r->median, r->p10, r->p90, r->min, r->max, r->cycles);
+    }
+}
+
+// ================================
+//      Comparison
+// ================================
+
+// Value of "key" in a JSON result line written by write_json
+static int json_field(const char *line, const char *key, char *value, size_t length) {
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *at = strstr(line, pattern);
+    if (!at) return -1;
+    at += strlen(pattern);
+    if (*at == '"') at++;
+    size_t n = strcspn(at, "\",}");
+    if (n >= length) n = length - 1;
+    memcpy(value, at, n);
+    value[n] = '\0';
+    return 0;
+}
 
-    uint8_t iv[8], decrypt_iv[8];
-    for (int i = 0; i < 8; i++) iv[i] = rand() & 0xFF;
+static int unit_index(const char *rate) {
+    for (int u = 0; u < (int)(sizeof(unit_rates) / sizeof(unit_rates[0])); u++) {
+        if (strcmp(rate, unit_rates[u]) == 0) return u;
+    }
+    return UNIT_BYTES;
+}
 
-    for (int i = 0; i < ITERATIONS; i++) {
-        // Fill random data
-        for (size_t j = 0; j < data_size; j += 8) {
-            *(uint64_t *)(data + j) = rand();
+// Loads the results of a JSON or CSV file from this program
+static Result *load_results(const char *path, size_t *count) {
+    FILE *f = fopen(path, "r");
+    char line[1024], field[64];
+    size_t capacity = 0;
+    Result *results = NULL;
+
+    *count = 0;
+    if (!f) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        Result r;
+        memset(&r, 0, sizeof(r));
+        if (strstr(line, "\"case\": ")) {
+            json_field(line, "case", r.name, sizeof(r.name));
+            json_field(line, "kernel", r.kernel, sizeof(r.kernel));
+            json_field(line, "threads", field, sizeof(field));
+            r.threads = atoi(field);
+            json_field(line, "size", field, sizeof(field));
+            r.size = (size_t)strtoull(field, NULL, 10);
+            json_field(line, "median", field, sizeof(field));
+            r.median = atof(field);
+            json_field(line, "p10", field, sizeof(field));
+            r.p10 = atof(field);
+            json_field(line, "p90", field, sizeof(field));
+            r.p90 = atof(field);
+            json_field(line, "unit", field, sizeof(field));
+            r.unit = unit_index(field);
+        } else if (strchr(line, ',') && strncmp(line, "case,", 5) != 0) {
+            char unit[16];
+            if (sscanf(line, "%31[^,],%15[^,],%d,%zu,%15[^,],%lf,%lf,%lf", r.name, r.kernel, &r.threads,
+                       &r.size, unit, &r.median, &r.p10, &r.p90) != 8) continue;
+            r.unit = unit_index(unit);
+        } else {
+            continue;
         }
-        memcpy(decrypt_iv, iv, 8);
+        if (*count == capacity) {
+            capacity = capacity ? 2 * capacity : 256;
+            results = (Result *)realloc(results, capacity * sizeof(Result));
+        }
+        results[(*count)++] = r;
+    }
+    fclose(f);
+    return results;
+}
 
-        // **Unrolled Encryption**
-        printf("Encrypting %zu bytes (iteration %d)...\n", data_size, i + 1);
-        fflush(stdout);
-        double start_enc = get_time();
-        for (size_t j = 0; j + (UNROLL_FACTOR * 8) <= data_size; j += (UNROLL_FACTOR * 8)) {
-            for (int k = 0; k < UNROLL_FACTOR; k++) {
-                des_cbc_encrypt(data + j + (k * 8), 8, key, iv);
+static int compare_files(const char *base_path, const char *new_path, double threshold) {
+    size_t base_count, new_count, matched = 0;
+    int regressions = 0, improvements = 0;
+    Result *base = load_results(base_path, &base_count);
+    Result *current = load_results(new_path, &new_count);
+    if (!base || !current) return 2;
+
+    printf("%-13s %-10s %4s %9s  %10s %10s %8s\n", "case", "kernel", "thr", "size", "base", "new", "change");
+    for (size_t i = 0; i < new_count; i++) {
+        const Result *n = &current[i], *b = NULL;
+        for (size_t j = 0; j < base_count && !b; j++) {
+            if (strcmp(base[j].name, n->name) == 0 && strcmp(base[j].kernel, n->kernel) == 0 &&
+                base[j].threads == n->threads && base[j].size == n->size) {
+                b = &base[j];
             }
         }
-        double end_enc = get_time();
-        total_enc_time += (end_enc - start_enc);
-        printf("Encryption Done!\n");
-        fflush(stdout);
-
-        // **Unrolled Decryption**
-        printf("Decrypting %zu bytes (iteration %d)...\n", data_size, i + 1);
-        fflush(stdout);
-        double start_dec = get_time();
-        for (size_t j = 0; j + (UNROLL_FACTOR * 8) <= data_size; j += (UNROLL_FACTOR * 8)) {
-            for (int k = 0; k < UNROLL_FACTOR; k++) {
-                des_cbc_decrypt(data + j + (k * 8), 8, key, decrypt_iv);
-            }
+        if (!b || b->median <= 0) continue;
+        matched++;
+
+        // A change counts only beyond the threshold and when the p10-p90 ranges are disjoint
+        double change = 100.0 * (n->median - b->median) / b->median;
+        const char *flag = "";
+        if (change < -threshold && n->p90 < b->p10) {
+            flag = "  REGRESSION";
+            regressions++;
+        } else if (change > threshold && n->p10 > b->p90) {
+            flag = "  improved";
+            improvements++;
         }
-        double end_dec = get_time();
-        total_dec_time += (end_dec - start_dec);
-        printf("Decryption Done!\n");
-        fflush(stdout);
+        printf("%-13s %-10s %3dt %9zu  %10.2f %10.2f %+7.1f%%%s\n", n->name, n->kernel, n->threads, n->size,
+               b->median, n->median, change, flag);
     }
+    printf("\n%zu points compared (%zu only in base, %zu only in new): %d regressions, %d improvements "
+           "(threshold %.1f%%)\n", matched, base_count - matched, new_count - matched, regressions,
+           improvements, threshold);
+    free(base);
+    free(current);
+    return regressions ? 1 : 0;
+}
 
-    free(data);  // Free allocated memory
+// ================================
+//      Main
+// ================================
 
-    printf("Data Size: %zu Bytes\n", data_size);
-    printf("Average Encryption Time: %.9f seconds\n", total_enc_time / ITERATIONS);
-    printf("Average Decryption Time: %.9f seconds\n", total_dec_time / ITERATIONS);
-    printf("-----------------------------------------\n");
-    fflush(stdout);
+static size_t parse_size(const char *text) {
+    char *end;
+    size_t value = (size_t)strtoull(text, &end, 10);
+    if (*end == 'K' || *end == 'k') value <<= 10;
+    if (*end == 'M' || *end == 'm') value <<= 20;
+    return value;
 }
 
-int main() {
-    printf("Starting encryption test...\n");
-    fflush(stdout);
+// Splits a comma separated list in place
+static int split_list(char *text, char **items) {
+    int count = 0;
+    for (char *item = strtok(text, ","); item && count < MAX_LIST; item = strtok(NULL, ",")) {
+        items[count++] = item;
+    }
+    return count;
+}
 
-    srand(time(NULL));
-    uint64_t key = 0x133457799BBCDFF1;
+static void usage(void) {
+    fprintf(stderr,
+            "usage: encryption_time [--cases LIST] [--sizes LIST] [--kernels LIST|all] [--threads LIST|all]\n"
+            "                       [--trials N] [--warmup SEC] [--min-time SEC]\n"
+            "                       [--json FILE] [--csv FILE] [--quiet] [--list]\n"
+            "       encryption_time --compare BASE NEW [--threshold PCT]\n");
+}
 
-    test_encryption_time(8, key);
-    test_encryption_time(16, key);
-    test_encryption_time(1024, key);
-    test_encryption_time(1048576, key);
+int main(int argc, char **argv) {
+    Options options = {11, 0.05, 0.02};
+    char *case_list = NULL, *size_list = NULL, *kernel_list = NULL, *thread_list = NULL;
+    const char *json_path = NULL, *csv_path = NULL, *compare[2] = {NULL, NULL};
+    double threshold = 5.0;
+    int quiet = 0;
 
-    printf("Encryption test completed!\n");
-    fflush(stdout);
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--quiet") == 0) {
+            quiet = 1;
+            continue;
+        }
+        if (strcmp(arg, "--list") == 0) {
+            for (size_t c = 0; c < CASE_COUNT; c++) printf("%-13s %s\n", cases[c].name, cases[c].description);
+            return 0;
+        }
+        if (!value) {
+            usage();
+            return 2;
+        }
+        i++;
+        if (strcmp(arg, "--cases") == 0) case_list = value;
+        else if (strcmp(arg, "--sizes") == 0) size_list = value;
+        else if (strcmp(arg, "--kernels") == 0) kernel_list = value;
+        else if (strcmp(arg, "--threads") == 0) thread_list = value;
+        else if (strcmp(arg, "--trials") == 0) options.trials = atoi(value);
+        else if (strcmp(arg, "--warmup") == 0) options.warmup = atof(value);
+        else if (strcmp(arg, "--min-time") == 0) options.min_time = atof(value);
+        else if (strcmp(arg, "--json") == 0) json_path = value;
+        else if (strcmp(arg, "--csv") == 0) csv_path = value;
+        else if (strcmp(arg, "--threshold") == 0) threshold = atof(value);
+        else if (strcmp(arg, "--compare") == 0 && i + 1 < argc) {
+            compare[0] = value;
+            compare[1] = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (compare[0]) return compare_files(compare[0], compare[1], threshold);
+    if (options.trials < 1) options.trials = 1;
+    if (options.trials > MAX_TRIALS) options.trials = MAX_TRIALS;
+
+    // Sweep dimensions
+    char *items[MAX_LIST];
+    int selected[CASE_COUNT], kernels[DES_KERNEL_COUNT], threads[MAX_LIST];
+    size_t sizes[MAX_LIST];
+    int kernel_count = 0, thread_count = 0, size_count = 0;
+
+    for (size_t c = 0; c < CASE_COUNT; c++) selected[c] = case_list == NULL;
+    for (int n = case_list ? split_list(case_list, items) : 0, i = 0; i < n; i++) {
+        size_t c = 0;
+        while (c < CASE_COUNT && strcmp(cases[c].name, items[i]) != 0) c++;
+        if (c == CASE_COUNT) {
+            fprintf(stderr, "unknown case: %s (see --list)\n", items[i]);
+            return 2;
+        }
+        selected[c] = 1;
+    }
+
+    if (size_list) {
+        int n = split_list(size_list, items);
+        for (int i = 0; i < n; i++) {
+            if ((sizes[size_count] = parse_size(items[i]) & ~(size_t)7) >= 8) size_count++;
+        }
+    } else {
+        static const size_t defaults[] = {64, 1024, 16384, 262144, 4194304};
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) sizes[size_count++] = defaults[i];
+    }
+
+    DES_Kernel active = des_get_kernel();
+    if (kernel_list && strcmp(kernel_list, "all") != 0) {
+        int n = split_list(kernel_list, items);
+        for (int i = 0; i < n; i++) {
+            int k = 0;
+            while (k < DES_KERNEL_COUNT && strcmp(des_kernel_name((DES_Kernel)k), items[i]) != 0) k++;
+            if (k == DES_KERNEL_COUNT || !des_kernel_supported((DES_Kernel)k)) {
+                fprintf(stderr, "kernel not available: %s\n", items[i]);
+                return 2;
+            }
+            kernels[kernel_count++] = k;
+        }
+    } else {
+        for (int k = 0; k < DES_KERNEL_COUNT; k++) {
+            if (des_kernel_supported((DES_Kernel)k)) kernels[kernel_count++] = k;
+        }
+    }
+
+    int default_threads = des_get_threads();
+    if (thread_list && strcmp(thread_list, "all") != 0) {
+        int n = split_list(thread_list, items);
+        for (int i = 0; i < n; i++) {
+            if (atoi(items[i]) > 0) threads[thread_count++] = atoi(items[i]);
+        }
+    } else {
+        for (int t = 1; t < default_threads && thread_count < MAX_LIST - 1; t *= 2) threads[thread_count++] = t;
+        threads[thread_count++] = default_threads;
+    }
+
+    size_t capacity = CASE_COUNT * (size_t)size_count * kernel_count * thread_count;
+    Result *results = (Result *)malloc(capacity * sizeof(Result));
+    size_t result_count = 0;
+    if (!results) {
+        fprintf(stderr, "Memory allocation failed for %zu results!\n", capacity);
+        return 1;
+    }
+
+    if (!quiet) {
+        char cpu[128];
+        cpu_name(cpu, sizeof(cpu));
+        printf("CPU: %s, %d threads by default, cycles from %s\n", cpu, default_threads, CYCLE_COUNTER);
+        printf("%d trials per point (median, 10th and 90th percentile), warmup %.3f s, trials >= %.3f s\n\n",
+               options.trials, options.warmup, options.min_time);
+    }
+
+    for (int s = 0; s < size_count; s++) {
+        Bench bench;
+        if (bench_init(&bench, sizes[s]) != 0) {
+            fprintf(stderr, "Memory allocation failed for %zu Bytes!\n", sizes[s]);
+            return 1;
+        }
+        for (size_t c = 0; c < CASE_COUNT; c++) {
+            if (!selected[c]) continue;
+            const BenchCase *bc = &cases[c];
+            for (int k = 0; k < (bc->kernel ? kernel_count : 1); k++) {
+                des_set_kernel(bc->kernel ? (DES_Kernel)kernels[k] : active);
+                for (int t = 0; t < (bc->threaded ? thread_count : 1); t++) {
+                    Result *r = &results[result_count++];
+                    des_set_threads(bc->threaded ? threads[t] : 1);
+                    snprintf(r->name, sizeof(r->name), "%s", bc->name);
+                    snprintf(r->kernel, sizeof(r->kernel), "%s",
+                             bc->kernel ? des_kernel_name((DES_Kernel)kernels[k]) : "-");
+                    r->threads = bc->threaded ? threads[t] : 1;
+                    r->size = sizes[s];
+                    r->unit = bc->unit;
+                    measure(bc, &bench, &options, r);
+                    if (!quiet) print_result(r);
+                }
+            }
+        }
+        bench_free(&bench);
+    }
+    des_set_kernel(active);
+    des_set_threads(0);
+
+    if (json_path) {
+        FILE *f = fopen(json_path, "w");
+        if (!f) {
+            fprintf(stderr, "%s: cannot write\n", json_path);
+            return 1;
+        }
+        write_json(f, results, result_count, &options);
+        fclose(f);
+    }
+    if (csv_path) {
+        FILE *f = strcmp(csv_path, "-") == 0 ? stdout : fopen(csv_path, "w");
+        if (!f) {
+            fprintf(stderr, "%s: cannot write\n", csv_path);
+            return 1;
+        }
+        write_csv(f, results, result_count);
+        if (f != stdout) fclose(f);
+    }
+    free(results);
     return 0;
 }
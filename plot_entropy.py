@@ -20,7 +20,8 @@ data = pd.read_csv('des_cbc_entropy_results.csv')
 # Display the first few rows of the data to ensure it's loaded correctly
 print(data.head())
 
-# Convert the 'Data Size (Bytes)' to numeric values for proper plotting
+# Keep the size labels for the x-ticks, then convert the sizes to numeric values for plotting
+labels = list(data['Data Size (Bytes)'])
 data['Data Size (Bytes)'] = data['Data Size (Bytes)'].apply(convert_to_bytes)
 
 # Plot the entropy values
@@ -34,9 +35,8 @@ plt.ylabel('Average Entropy (bits/byte)')
 plt.grid(True)
 plt.xscale('log')  # Log scale for better visibility of larger data sizes
 
-# Set the x-ticks labels to display sizes like '8B', '16B', '1KB', etc.
-plt.xticks([8, 16, 50, 200, 500, 1024, 100*1024, 250*1024, 500*1024, 750*1024, 1024*1024], 
-           ['8B', '16B', '50B', '200B', '500B', '1KB', '100KB', '250KB', '500KB', '750KB', '1MB'])
+# Set the x-ticks labels to display the sizes in the file ('8B', '16B', '1KB', ..., '1024MB')
+plt.xticks(list(data['Data Size (Bytes)']), labels)
 
 # Rotate the x-axis labels for better visibility
 plt.xticks(rotation=45, ha='right')